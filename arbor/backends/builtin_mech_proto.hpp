@@ -16,7 +16,9 @@ inline const mechanism_info& builtin_stimulus_info() {
         {
             {"delay",     {spec::parameter, "ms", 0, 0}},
             {"duration",  {spec::parameter, "ms", 0, 0}},
-            {"amplitude", {spec::parameter, "nA", 0, 0}}
+            {"amplitude", {spec::parameter, "nA", 0, 0}},
+            {"frequency", {spec::parameter, "kHz", 0, 0}},
+            {"phase",     {spec::parameter, "rad", 0}}
         },
         // state
         {},
@@ -2,6 +2,7 @@
 
 #include <arbor/common_types.hpp>
 #include <arbor/fvm_types.hpp>
+#include <arbor/sampling.hpp>
 
 // Structures for the representation of event delivery targets and
 // staged events.
@@ -53,9 +54,20 @@ inline deliverable_event_data event_data(const deliverable_event& ev) {
 
 using probe_handle = const fvm_value_type*;
 
+// A sample event samples a contiguous range of the probe handles in the
+// sampling plan of the lowered cell: the value of handle `begin+k` is
+// stored at `offset+k*stride` in the sample arrays.
+//
+// Interpolated samples record the requested sample time, which is kept
+// with the event data for the interpolation at the end of the step.
+
 struct raw_probe_info {
-    probe_handle handle;      // where the to-be-probed value sits
-    sample_size_type offset;  // offset into array to store raw probed value
+    fvm_size_type begin;      // range of probe handles in the sampling plan
+    fvm_size_type end;
+    sample_size_type offset;  // offset into array to store raw probed value of first handle
+    sample_size_type stride;  // offset increment between successive handles
+    sampling_policy policy;
+    time_type time;           // requested sample time
 };
 
 struct sample_event {
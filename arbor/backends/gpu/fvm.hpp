@@ -28,6 +28,9 @@ struct backend {
     using index_type = fvm_index_type;
     using size_type  = fvm_size_type;
 
+    // Mechanism state is always stored in double precision on the GPU.
+    using state_type = fvm_value_type;
+
     using array  = arb::gpu::array;
     using iarray = arb::gpu::iarray;
 
@@ -132,6 +132,12 @@ struct matrix_state_flat {
                           cell_cv_divs.data(), num_matrices());
     }
 
+    // Assembly and solution are separate kernel launches.
+    void assemble_and_solve(const_view dt_cell, const_view voltage, const_view current) {
+        assemble(dt_cell, voltage, current);
+        solve();
+    }
+
     std::size_t size() const {
         return parent_index.size();
     }
@@ -284,6 +284,12 @@ struct matrix_state_interleaved {
              padded_matrix_size(), num_matrices());
     }
 
+    // Assembly and solution are separate kernel launches.
+    void assemble_and_solve(const_view dt_cell, const_view voltage, const_view current) {
+        assemble(dt_cell, voltage, current);
+        solve();
+    }
+
 private:
 
     // The number of matrices stored in the matrix state.
@@ -40,9 +40,13 @@ void set_dt_impl(
     const fvm_value_type* time_to, const fvm_value_type* time, const fvm_index_type* cv_to_cell);
 
 void take_samples_impl(
-    const multi_event_stream_state<raw_probe_info>& s,
+    const multi_event_stream_state<raw_probe_info>& s, const probe_handle* handles,
     const fvm_value_type* time, fvm_value_type* sample_time, fvm_value_type* sample_value);
 
+void interpolate_samples_impl(
+    const multi_event_stream_state<raw_probe_info>& s, const probe_handle* handles,
+    const fvm_value_type* time, const fvm_value_type* time_to, fvm_value_type* sample_value);
+
 // GPU-side minmax: consider CUDA kernel replacement.
 std::pair<fvm_value_type, fvm_value_type> minmax_value_impl(fvm_size_type n, const fvm_value_type* v) {
     auto v_copy = memory::on_host(memory::const_device_view<fvm_value_type>(v, n));
@@ -182,8 +186,16 @@ std::pair<fvm_value_type, fvm_value_type> shared_state::voltage_bounds() const {
     return minmax_value_impl(n_cv, voltage.data());
 }
 
+void shared_state::set_sample_handles(const std::vector<probe_handle>& handles) {
+    sample_handles = memory::device_vector<probe_handle>(memory::make_const_view(handles));
+}
+
 void shared_state::take_samples(const sample_event_stream::state& s, array& sample_time, array& sample_value) {
-    take_samples_impl(s, time.data(), sample_time.data(), sample_value.data());
+    take_samples_impl(s, sample_handles.data(), time.data(), sample_time.data(), sample_value.data());
+}
+
+void shared_state::interpolate_samples(const sample_event_stream::state& s, array& sample_time, array& sample_value) {
+    interpolate_samples_impl(s, sample_handles.data(), time.data(), time_to.data(), sample_value.data());
 }
 
 // Debug interface
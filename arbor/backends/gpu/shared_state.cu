@@ -61,7 +61,7 @@ __global__ void gather(unsigned n, T* x, const T* y, const I* index) {
 }
 
 __global__ void take_samples_impl(
-    multi_event_stream_state<raw_probe_info> s,
+    multi_event_stream_state<raw_probe_info> s, const probe_handle* handles,
     const fvm_value_type* time, fvm_value_type* sample_time, fvm_value_type* sample_value)
 {
     unsigned i = threadIdx.x+blockIdx.x*blockDim.x;
@@ -69,8 +69,34 @@ __global__ void take_samples_impl(
         auto begin = s.ev_data+s.begin_offset[i];
         auto end = s.ev_data+s.end_offset[i];
         for (auto p = begin; p!=end; ++p) {
-            sample_time[p->offset] = time[i];
-            sample_value[p->offset] = *p->handle;
+            auto offset = p->offset;
+            auto t = p->policy==sampling_policy::interpolated? p->time: time[i];
+            for (auto k = p->begin; k!=p->end; ++k) {
+                sample_time[offset] = t;
+                sample_value[offset] = *handles[k];
+                offset += p->stride;
+            }
+        }
+    }
+}
+
+__global__ void interpolate_samples_impl(
+    multi_event_stream_state<raw_probe_info> s, const probe_handle* handles,
+    const fvm_value_type* time, const fvm_value_type* time_to, fvm_value_type* sample_value)
+{
+    unsigned i = threadIdx.x+blockIdx.x*blockDim.x;
+    if (i<s.n && time_to[i]>time[i]) {
+        auto begin = s.ev_data+s.begin_offset[i];
+        auto end = s.ev_data+s.end_offset[i];
+        for (auto p = begin; p!=end; ++p) {
+            if (p->policy!=sampling_policy::interpolated) continue;
+
+            auto offset = p->offset;
+            auto a = (p->time-time[i])/(time_to[i]-time[i]);
+            for (auto k = p->begin; k!=p->end; ++k) {
+                sample_value[offset] += a*(*handles[k]-sample_value[offset]);
+                offset += p->stride;
+            }
         }
     }
 }
@@ -127,14 +153,25 @@ void set_dt_impl(
 }
 
 void take_samples_impl(
-    const multi_event_stream_state<raw_probe_info>& s,
+    const multi_event_stream_state<raw_probe_info>& s, const probe_handle* handles,
     const fvm_value_type* time, fvm_value_type* sample_time, fvm_value_type* sample_value)
 {
     if (!s.n_streams()) return;
 
     constexpr int block_dim = 128;
     const int nblock = block_count(s.n_streams(), block_dim);
-    kernel::take_samples_impl<<<nblock, block_dim>>>(s, time, sample_time, sample_value);
+    kernel::take_samples_impl<<<nblock, block_dim>>>(s, handles, time, sample_time, sample_value);
+}
+
+void interpolate_samples_impl(
+    const multi_event_stream_state<raw_probe_info>& s, const probe_handle* handles,
+    const fvm_value_type* time, const fvm_value_type* time_to, fvm_value_type* sample_value)
+{
+    if (!s.n_streams()) return;
+
+    constexpr int block_dim = 128;
+    const int nblock = block_count(s.n_streams(), block_dim);
+    kernel::interpolate_samples_impl<<<nblock, block_dim>>>(s, handles, time, time_to, sample_value);
 }
 
 } // namespace gpu
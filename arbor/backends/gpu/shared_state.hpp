@@ -76,6 +76,7 @@ struct shared_state {
     array  voltage;           // Maps CV index to membrane voltage [mV].
     array  current_density;   // Maps CV index to current density [A/m²].
     array  temperature_degC;  // Global temperature [°C] (length 1 array).
+    memory::device_vector<probe_handle> sample_handles; // Probe handles of the sampling plan.
 
     std::unordered_map<ionKind, ion_state> ion_data;
 
@@ -114,12 +115,22 @@ struct shared_state {
     // (Used for solution bounds checking.)
     std::pair<fvm_value_type, fvm_value_type> voltage_bounds() const;
 
+    // Set the probe handles sampled by sample events.
+    void set_sample_handles(const std::vector<probe_handle>& handles);
+
     // Take samples according to marked events in a sample_event_stream.
     void take_samples(
         const sample_event_stream::state& s,
         array& sample_time,
         array& sample_value);
 
+    // Complete interpolated samples taken by take_samples() at the start of
+    // the step, from the state at the end of the step.
+    void interpolate_samples(
+        const sample_event_stream::state& s,
+        array& sample_time,
+        array& sample_value);
+
     void reset(fvm_value_type initial_voltage, fvm_value_type temperature_K);
 };
 
@@ -37,7 +37,9 @@ protected:
         return {
             {"delay", &pp_.delay},
             {"duration", &pp_.duration},
-            {"amplitude", &pp_.amplitude}
+            {"amplitude", &pp_.amplitude},
+            {"frequency", &pp_.frequency},
+            {"phase", &pp_.phase}
         };
     }
 
@@ -45,7 +47,9 @@ protected:
         return {
             {"delay", 0},
             {"duration", 0},
-            {"amplitude", 0}
+            {"amplitude", 0},
+            {"frequency", 0},
+            {"phase", 0}
         };
     }
 
@@ -1,4 +1,5 @@
 #include <arbor/fvm_types.hpp>
+#include <arbor/math.hpp>
 
 #include "cuda_atomic.hpp"
 #include "cuda_common.hpp"
@@ -14,9 +15,13 @@ namespace kernel {
         if (i<n) {
             auto t = pp.vec_t_[pp.vec_ci_[i]];
             if (t>=pp.delay[i] && t<pp.delay[i]+pp.duration[i]) {
+                fvm_value_type a = pp.amplitude[i];
+                if (pp.frequency[i]) {
+                    a *= sin(2*math::pi<fvm_value_type>*pp.frequency[i]*(t-pp.delay[i]) + pp.phase[i]);
+                }
                 // use subtraction because the electrode currents are specified
                 // in terms of current into the compartment
-                cuda_atomic_add(pp.vec_i_+pp.node_index_[i], -pp.weight_[i]*pp.amplitude[i]);
+                cuda_atomic_add(pp.vec_i_+pp.node_index_[i], -pp.weight_[i]*a);
             }
         }
     }
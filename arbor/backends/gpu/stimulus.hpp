@@ -9,6 +9,8 @@ struct stimulus_pp: mechanism_ppack_base {
     fvm_value_type* delay;
     fvm_value_type* duration;
     fvm_value_type* amplitude;
+    fvm_value_type* frequency;
+    fvm_value_type* phase;
 };
 
 void stimulus_current_impl(int n, const stimulus_pp&);
@@ -1,11 +1,14 @@
 #pragma once
 
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <arbor/execution_context.hpp>
+#include <arbor/simd/simd.hpp>
 
 #include "backends/event.hpp"
 #include "backends/multicore/matrix_state.hpp"
+#include "backends/multicore/matrix_state_interleaved.hpp"
 #include "backends/multicore/multi_event_stream.hpp"
 #include "backends/multicore/multicore_common.hpp"
 #include "backends/multicore/shared_state.hpp"
@@ -25,6 +28,9 @@ struct backend {
     using index_type = fvm_index_type;
     using size_type  = fvm_size_type;
 
+    // Storage type of mechanism state and ion concentrations.
+    using state_type = fvm_state_type;
+
     using array  = arb::multicore::array;
     using iarray = arb::multicore::iarray;
 
@@ -36,7 +42,12 @@ struct backend {
         return util::range_pointer_view(v);
     }
 
-    using matrix_state = arb::multicore::matrix_state<value_type, index_type>;
+    // Solve the cell matrices in SIMD lanes when the target has native
+    // vector support for value_type.
+    using matrix_state = std::conditional_t<
+        (simd::simd_abi::native_width<value_type>::value>1),
+        arb::multicore::matrix_state_interleaved<value_type, index_type>,
+        arb::multicore::matrix_state<value_type, index_type>>;
     using threshold_watcher = arb::multicore::threshold_watcher;
 
     using deliverable_event_stream = arb::multicore::deliverable_event_stream;
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <vector>
+
+#include <arbor/simd/simd.hpp>
+
 #include <util/partition.hpp>
 #include <util/span.hpp>
 
@@ -18,9 +22,25 @@ public:
     using const_view = const array&;
 
     using iarray = padded_vector<index_type>;
+
+    static constexpr unsigned width = simd::simd_abi::native_width<value_type>::value;
+    using simd_value = simd::simd<value_type, width>;
+    using simd_index = simd::simd<index_type, width>;
+
+    // Target number of CVs assembled and solved together by
+    // assemble_and_solve(), chosen so that the matrix data of a chunk
+    // remains in L1 cache between assembly and solution.
+    static constexpr index_type chunk_size = 256;
+
     iarray parent_index;
     iarray cell_cv_divs;
 
+    // Cell index of each CV, used to expand dt per cell to dt per CV.
+    iarray cv_to_cell;
+
+    // Partition of cells into chunks for assemble_and_solve().
+    std::vector<index_type> chunk_divs;
+
     array d;     // [μS]
     array u;     // [μS]
     array rhs;   // [nA]
@@ -59,6 +79,27 @@ public:
             invariant_d[i] += gij;
             invariant_d[p[i]] += gij;
         }
+
+        const index_type ncells = cell_cv_divs.size()-1;
+        cv_to_cell = iarray(n);
+        for (auto c: util::make_span(ncells)) {
+            for (auto i: util::make_span(cell_cv_divs[c], cell_cv_divs[c+1])) {
+                cv_to_cell[i] = c;
+            }
+        }
+
+        // Chunks comprise whole cells; a cell larger than chunk_size
+        // makes a chunk of its own.
+        chunk_divs.push_back(0);
+        for (auto c: util::make_span(ncells)) {
+            auto first = cell_cv_divs[chunk_divs.back()];
+            if (c>chunk_divs.back() && cell_cv_divs[c+1]-first>chunk_size) {
+                chunk_divs.push_back(c);
+            }
+        }
+        if (ncells>0) {
+            chunk_divs.push_back(ncells);
+        }
     }
 
     const_view solution() const {
@@ -74,37 +115,71 @@ public:
     //   voltage         [mV]     (per compartment)
     //   current density [A.m^-2] (per compartment)
     void assemble(const_view dt_cell, const_view voltage, const_view current) {
-        auto cell_cv_part = util::partition_view(cell_cv_divs);
-        const index_type ncells = cell_cv_part.size();
+        assemble_cvs(0, size(), dt_cell, voltage, current);
+    }
 
-        // loop over submatrices
-        for (auto m: util::make_span(0, ncells)) {
-            auto dt = dt_cell[m];
+    void solve() {
+        solve_cells(0, cell_cv_divs.size()-1);
+    }
 
-            if (dt>0) {
-                value_type factor = 1e-3/dt;
-                for (auto i: util::make_span(cell_cv_part[m])) {
-                    auto gi = factor*cv_capacitance[i];
+    // Equivalent to assemble() followed by solve(), but interleaves the
+    // two over chunks of cells so that the diagonal and RHS of a chunk are
+    // solved while still in cache.
+    void assemble_and_solve(const_view dt_cell, const_view voltage, const_view current) {
+        for (auto chunk: util::partition_view(chunk_divs)) {
+            assemble_cvs(cell_cv_divs[chunk.first], cell_cv_divs[chunk.second], dt_cell, voltage, current);
+            solve_cells(chunk.first, chunk.second);
+        }
+    }
 
-                    d[i] = gi + invariant_d[i];
-                    // convert current to units nA
-                    rhs[i] = gi*voltage[i] - 1e-3*cv_area[i]*current[i];
-                }
+private:
+
+    // Assemble rows [first, last).
+    //
+    // The dt of each CV is gathered from dt_cell, so that a single loop
+    // without branches covers CVs of all cells. Rows of cells with a zero
+    // dt have a zero diagonal, and the voltage on the right hand side.
+    void assemble_cvs(index_type first, index_type last, const_view dt_cell, const_view voltage, const_view current) {
+        constexpr index_type w = width;
+        index_type i = first;
+
+        for (; i+w<=last; i += w) {
+            simd_index cell(cv_to_cell.data()+i);
+            simd_value dt(simd::indirect(dt_cell.data(), cell));
+            simd_value v(voltage.data()+i);
+
+            simd_value gi = value_type(1e-3)/dt*simd_value(cv_capacitance.data()+i);
+            simd_value di = gi + simd_value(invariant_d.data()+i);
+            // convert current to units nA
+            simd_value ri = gi*v - value_type(1e-3)*simd_value(cv_area.data()+i)*simd_value(current.data()+i);
+
+            auto frozen = dt<=value_type(0);
+            simd::where(frozen, di) = value_type(0);
+            simd::where(frozen, ri) = v;
+
+            di.copy_to(d.data()+i);
+            ri.copy_to(rhs.data()+i);
+        }
+
+        for (; i<last; ++i) {
+            auto dt = dt_cell[cv_to_cell[i]];
+            if (dt>0) {
+                auto gi = value_type(1e-3)/dt*cv_capacitance[i];
+                d[i] = gi + invariant_d[i];
+                rhs[i] = gi*voltage[i] - value_type(1e-3)*cv_area[i]*current[i];
             }
             else {
-                for (auto i: util::make_span(cell_cv_part[m])) {
-                    d[i] = 0;
-                    rhs[i] = voltage[i];
-                }
+                d[i] = 0;
+                rhs[i] = voltage[i];
             }
         }
     }
 
-    void solve() {
-        // loop over submatrices
-        for (auto cv_span: util::partition_view(cell_cv_divs)) {
-            auto first = cv_span.first;
-            auto last = cv_span.second; // one past the end
+    // Solve matrices of cells [first_cell, last_cell).
+    void solve_cells(index_type first_cell, index_type last_cell) {
+        for (auto c: util::make_span(first_cell, last_cell)) {
+            auto first = cell_cv_divs[c];
+            auto last = cell_cv_divs[c+1]; // one past the end
 
             if (d[first]!=0) {
                 // backward sweep
@@ -124,8 +199,6 @@ public:
         }
     }
 
-private:
-
     std::size_t size() const {
         return parent_index.size();
     }
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include <arbor/assert.hpp>
+#include <arbor/simd/simd.hpp>
+
+#include "util/partition.hpp"
+#include "util/span.hpp"
+
+#include "multicore_common.hpp"
+
+namespace arb {
+namespace multicore {
+
+// Matrix state that solves the Hines matrices of independent cells
+// simultaneously, one cell per SIMD lane.
+//
+// Cells are ordered by decreasing size, and cells of the same size by their
+// tree structure, then packed into blocks of `width` cells. The rows of the
+// cells in a block are interleaved: row r of the cell in lane l of block b is
+// stored at block_offset[b] + r*width + l. Each block is padded to the size of
+// its largest cell.
+//
+// When all cells in a block share a tree structure, the parents of a row are
+// contiguous in the interleaved storage, and the solver uses plain vector
+// loads and stores; otherwise it uses gather and scatter for that row.
+//
+// As with the GPU back end, the solution is copied back to flat (per-CV)
+// storage after each solve.
+//
+// The block width W defaults to the native SIMD width of T; other widths
+// use the generic SIMD implementation, and are used for testing.
+template <typename T, typename I, unsigned W = simd::simd_abi::native_width<T>::value>
+struct matrix_state_interleaved {
+public:
+    using value_type = T;
+    using index_type = I;
+
+    using array = padded_vector<value_type>;
+    using const_view = const array&;
+
+    using iarray = padded_vector<index_type>;
+
+    static constexpr unsigned width = W;
+    using simd_value = simd::simd<value_type, width>;
+    using simd_index = simd::simd<index_type, width>;
+
+    // Offset of each block in interleaved storage [num_blocks+1].
+    iarray block_offset;
+    // Cell index of each lane of each block; unused lanes refer to the
+    // cell in lane 0 of the block [num_blocks*width].
+    iarray lane_cell;
+    // Flat CV index of each interleaved entry; padding refers to the
+    // first CV of the cell in the lane.
+    iarray cv_index;
+    // Interleaved index of the parent of each interleaved entry.
+    iarray parent_index;
+
+    // Per interleaved row: number of occupied lanes (a prefix of the block,
+    // as cells are sorted by size), and constraint on the parent indices.
+    std::vector<index_type> row_lanes;
+    std::vector<simd::index_constraint> row_constraint;
+
+    array d;     // [μS]
+    array u;     // [μS]
+    array rhs;   // [nA]
+
+    array cv_capacitance;      // [pF]
+    array cv_area;             // [μm^2]
+
+    // the invariant part of the matrix diagonal; one on padding, so that
+    // padded rows are trivially solved.
+    array invariant_d;         // [μS]
+
+    // Solution in flat storage.
+    array solution_;
+
+    matrix_state_interleaved() = default;
+
+    matrix_state_interleaved(const std::vector<index_type>& p,
+                 const std::vector<index_type>& cell_cv_divs,
+                 const std::vector<value_type>& cap,
+                 const std::vector<value_type>& cond,
+                 const std::vector<value_type>& area)
+    {
+        using util::make_span;
+
+        const auto n = p.size();
+        arb_assert(cap.size() == n);
+        arb_assert(cond.size() == n);
+        arb_assert(cell_cv_divs.back() == (index_type)n);
+
+        const index_type num_cells = cell_cv_divs.size()-1;
+        auto size_of = [&](index_type c) { return cell_cv_divs[c+1]-cell_cv_divs[c]; };
+        auto rel_parent = [&](index_type c, index_type r) {
+            auto first = cell_cv_divs[c];
+            return p[first+r]-first;
+        };
+
+        // Invariant part of the diagonal and upper diagonal in flat storage,
+        // computed as for the flat matrix_state.
+        std::vector<value_type> invariant_d_flat(n, 0);
+        std::vector<value_type> u_flat(n, 0);
+        for (auto i: make_span(1u, n)) {
+            auto gij = cond[i];
+
+            u_flat[i] = -gij;
+            invariant_d_flat[i] += gij;
+            invariant_d_flat[p[i]] += gij;
+        }
+
+        // Order cells by decreasing size, then by structure.
+        std::vector<index_type> perm(num_cells);
+        std::iota(perm.begin(), perm.end(), 0);
+        std::stable_sort(perm.begin(), perm.end(),
+            [&](index_type a, index_type b) {
+                auto na = size_of(a), nb = size_of(b);
+                if (na!=nb) return na>nb;
+                for (auto r: make_span(na)) {
+                    auto pa = rel_parent(a, r), pb = rel_parent(b, r);
+                    if (pa!=pb) return pa<pb;
+                }
+                return false;
+            });
+
+        const index_type num_blocks = (num_cells+width-1)/width;
+        block_offset.assign(num_blocks+1, 0);
+        for (auto b: make_span(num_blocks)) {
+            block_offset[b+1] = block_offset[b] + width*size_of(perm[b*width]);
+        }
+
+        const auto total = block_offset.back();
+        lane_cell.assign(num_blocks*width, 0);
+        cv_index.assign(total, 0);
+        parent_index.assign(total, 0);
+        row_lanes.assign(total/width, 0);
+        row_constraint.assign(total/width, simd::index_constraint::contiguous);
+
+        d = array(total, 0);
+        u = array(total, 0);
+        rhs = array(total, 0);
+        cv_capacitance = array(total, 0);
+        cv_area = array(total, 0);
+        invariant_d = array(total, 1);
+        solution_ = array(n, 0);
+
+        for (auto b: make_span(num_blocks)) {
+            const auto offset = block_offset[b];
+            const auto cell0 = perm[b*width];
+            const auto len = size_of(cell0);
+
+            for (auto l: make_span(width)) {
+                const bool occupied = b*width+l < (unsigned)num_cells;
+                const auto c = occupied? perm[b*width+l]: cell0;
+                const auto first = cell_cv_divs[c];
+                const auto lane_len = occupied? size_of(c): 0;
+
+                lane_cell[b*width+l] = c;
+                for (auto r: make_span(len)) {
+                    const auto pos = offset + r*width + l;
+                    const auto row = pos/width;
+
+                    if (r<lane_len) {
+                        const auto cv = first+r;
+                        cv_index[pos] = cv;
+                        parent_index[pos] = offset + rel_parent(c, r)*width + l;
+                        cv_capacitance[pos] = cap[cv];
+                        cv_area[pos] = area[cv];
+                        u[pos] = u_flat[cv];
+                        invariant_d[pos] = invariant_d_flat[cv];
+                        ++row_lanes[row];
+
+                        if (rel_parent(c, r)!=rel_parent(cell0, r)) {
+                            row_constraint[row] = simd::index_constraint::independent;
+                        }
+                    }
+                    else {
+                        // Padding: take the parent of lane 0 so that the
+                        // parent indices of the row remain contiguous.
+                        cv_index[pos] = first;
+                        parent_index[pos] = offset + rel_parent(cell0, r)*width + l;
+                    }
+                }
+            }
+        }
+    }
+
+    const_view solution() const {
+        return solution_;
+    }
+
+    // Assemble the matrix
+    // Afterwards the diagonal and RHS will have been set given dt, voltage and current.
+    //   dt_cell         [ms]     (per cell)
+    //   voltage         [mV]     (per compartment)
+    //   current density [A.m^-2] (per compartment)
+    void assemble(const_view dt_cell, const_view voltage, const_view current) {
+        for (auto b: util::make_span(num_blocks())) {
+            assemble_block(b, dt_cell, voltage, current);
+        }
+    }
+
+    void solve() {
+        for (auto b: util::make_span(num_blocks())) {
+            solve_block(b);
+        }
+        copy_solution();
+    }
+
+    // Equivalent to assemble() followed by solve(), but solves each block
+    // directly after its assembly, while the diagonal and RHS are in cache.
+    void assemble_and_solve(const_view dt_cell, const_view voltage, const_view current) {
+        for (auto b: util::make_span(num_blocks())) {
+            assemble_block(b, dt_cell, voltage, current);
+            solve_block(b);
+        }
+        copy_solution();
+    }
+
+private:
+    index_type num_blocks() const {
+        return block_offset.empty()? 0: block_offset.size()-1;
+    }
+
+    void assemble_block(index_type b, const_view dt_cell, const_view voltage, const_view current) {
+        simd_index cell(lane_cell.data()+b*width);
+        simd_value dt(simd::indirect(dt_cell.data(), cell));
+        simd_value factor = value_type(1e-3)/dt;
+        auto frozen = dt<=value_type(0);
+
+        for (auto pos = block_offset[b]; pos<block_offset[b+1]; pos += width) {
+            simd_index cv(cv_index.data()+pos);
+            simd_value v(simd::indirect(voltage.data(), cv));
+            simd_value i(simd::indirect(current.data(), cv));
+
+            simd_value gi = factor*simd_value(cv_capacitance.data()+pos);
+            simd_value di = gi + simd_value(invariant_d.data()+pos);
+            // convert current to units nA
+            simd_value ri = gi*v - value_type(1e-3)*simd_value(cv_area.data()+pos)*i;
+
+            simd::where(frozen, di) = value_type(0);
+            simd::where(frozen, ri) = v;
+
+            di.copy_to(d.data()+pos);
+            ri.copy_to(rhs.data()+pos);
+        }
+    }
+
+    void solve_block(index_type b) {
+        const index_type w = width;
+        const auto first = block_offset[b];
+        const auto last = block_offset[b+1];
+
+        // Lanes with a zero diagonal at the root are left as-is.
+        simd_value d0(d.data()+first);
+        auto frozen = d0==value_type(0);
+
+        // backward sweep
+        for (auto pos = last-w; pos>first; pos -= w) {
+            const auto c = row_constraint[pos/w];
+            simd_index pi(parent_index.data()+pos);
+            simd_value ui(u.data()+pos);
+            simd_value di(d.data()+pos);
+            simd_value ri(rhs.data()+pos);
+
+            simd_value factor = ui/di;
+            simd::where(frozen, factor) = value_type(0);
+
+            simd::indirect(d.data(), pi, c) -= factor*ui;
+            simd::indirect(rhs.data(), pi, c) -= factor*ri;
+        }
+
+        simd_value r0(rhs.data()+first);
+        d0.copy_from(d.data()+first);
+        simd::where(frozen, d0) = value_type(1);
+        r0 = r0/d0;
+        r0.copy_to(rhs.data()+first);
+
+        // forward sweep
+        for (auto pos = first+w; pos<last; pos += w) {
+            const auto c = row_constraint[pos/w];
+            simd_index pi(parent_index.data()+pos);
+            simd_value ui(u.data()+pos);
+            simd_value di(d.data()+pos);
+            simd_value ri(rhs.data()+pos);
+            simd_value rp(simd::indirect(rhs.data(), pi, c));
+
+            simd::where(frozen, di) = value_type(1);
+            simd::where(frozen, ui) = value_type(0);
+            ri = (ri - ui*rp)/di;
+            ri.copy_to(rhs.data()+pos);
+        }
+    }
+
+    // Copy the solution from interleaved to flat storage.
+    void copy_solution() {
+        const index_type w = width;
+        for (auto row: util::make_span(row_lanes.size())) {
+            const auto pos = row*w;
+            const auto k = row_lanes[row];
+            if (k==w) {
+                simd_index cv(cv_index.data()+pos);
+                simd_value x(rhs.data()+pos);
+                x.copy_to(simd::indirect(solution_.data(), cv));
+            }
+            else {
+                for (auto l: util::make_span(k)) {
+                    solution_[cv_index[pos+l]] = rhs[pos+l];
+                }
+            }
+        }
+    }
+};
+
+} // namespace multicore
+} // namespace arb
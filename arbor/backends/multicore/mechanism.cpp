@@ -110,12 +110,12 @@ void mechanism::instantiate(unsigned id, backend::shared_state& shared, const la
     auto fields = field_table();
     std::size_t n_field = fields.size();
 
-    // (First sub-array of data_ is used for width_, below.)
-    data_ = array((1+n_field)*width_padded_, NAN, pad);
+    data_ = array(width_padded_, NAN, pad);
+    state_data_ = state_array(n_field*width_padded_, NAN, pad);
     for (std::size_t i = 0; i<n_field; ++i) {
         // Take reference to corresponding derived (generated) mechanism value pointer member.
-        fvm_value_type*& field_ptr = *(fields[i].second);
-        field_ptr = data_.data()+(i+1)*width_padded_;
+        fvm_state_type*& field_ptr = *(fields[i].second);
+        field_ptr = state_data_.data()+i*width_padded_;
 
         if (auto opt_value = value_by_key(field_default_table(), fields[i].first)) {
             std::fill(field_ptr, field_ptr+width_padded_, *opt_value);
@@ -161,8 +161,8 @@ void mechanism::set_parameter(const std::string& key, const std::vector<fvm_valu
 
         if (width_>0) {
             // Retrieve corresponding derived (generated) mechanism value pointer member.
-            value_type* field_ptr = *opt_ptr.value();
-            util::range<value_type*> field(field_ptr, field_ptr+width_padded_);
+            state_type* field_ptr = *opt_ptr.value();
+            util::range<state_type*> field(field_ptr, field_ptr+width_padded_);
 
             copy_extend(values, field, values.back());
         }
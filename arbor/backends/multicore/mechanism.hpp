@@ -24,6 +24,7 @@ namespace multicore {
 class mechanism: public arb::concrete_mechanism<arb::multicore::backend> {
 public:
     using value_type = fvm_value_type;
+    using state_type = fvm_state_type;
     using index_type = fvm_index_type;
     using size_type = fvm_size_type;
 
@@ -33,12 +34,13 @@ protected:
 
     using array  = arb::multicore::array;
     using iarray = arb::multicore::iarray;
+    using state_array = arb::multicore::state_array;
 
     struct ion_state_view {
         value_type* current_density;
         value_type* reversal_potential;
-        value_type* internal_concentration;
-        value_type* external_concentration;
+        state_type* internal_concentration;
+        state_type* external_concentration;
     };
 
 public:
@@ -50,6 +52,7 @@ public:
         std::size_t s = object_sizeof();
 
         s += sizeof(value_type) * data_.size();
+        s += sizeof(state_type) * state_data_.size();
         s += sizeof(size_type) * width_padded_ * (n_ion_ + 1); // node and ion indices.
         return s;
     }
@@ -65,6 +68,13 @@ public:
 
     void set_global(const std::string& key, fvm_value_type value) override;
 
+    // Partition of the SIMD chunks of the instance by the constraint on their
+    // node indices: the size of each class gives the number of chunks that
+    // the generated kernels process with the corresponding specialized loop.
+    const constraint_partition& index_constraints() const {
+        return index_constraints_;
+    }
+
 protected:
     size_type width_ = 0;        // Instance width (number of CVs/sites)
     size_type width_padded_ = 0; // Width rounded up to multiple of pad/alignment.
@@ -85,11 +95,13 @@ protected:
 
     iarray node_index_;
     constraint_partition index_constraints_;
-    const value_type* weight_;    // Points within data_ after instantiation.
+    const value_type* weight_;    // Points to data_ after instantiation.
 
-    // Bulk storage for state and parameter variables.
+    // Storage for the weights, and bulk storage for state and parameter
+    // variables.
 
     array data_;
+    state_array state_data_;
 
     // Generated mechanism field, global and ion table lookup types.
     // First component is name, second is pointer to corresponing member in 
@@ -99,7 +111,7 @@ protected:
     using global_table_entry = std::pair<const char*, value_type*>;
     using mechanism_global_table = std::vector<global_table_entry>;
 
-    using field_table_entry = std::pair<const char*, value_type**>;
+    using field_table_entry = std::pair<const char*, state_type**>;
     using mechanism_field_table = std::vector<field_table_entry>;
 
     using field_default_entry = std::pair<const char*, value_type>;
@@ -52,44 +52,27 @@ public:
         util::fill(mark_, 0);
     }
 
-    // Initialize event streams from a vector of events, sorted by time.
-    void init(std::vector<Event> staged) {
+    // Initialize event streams from a vector of events, either grouped by
+    // index and sorted by time within each index, or sorted by time.
+    void init(const std::vector<Event>& staged) {
         using ::arb::event_time;
         using ::arb::event_index;
-        using ::arb::event_data;
 
         if (staged.size()>std::numeric_limits<size_type>::max()) {
             throw arbor_internal_error("multicore/multi_event_stream: too many events for size type");
         }
 
-        // Sort by index (staged events should already be time-sorted).
-        arb_assert(util::is_sorted_by(staged, [](const Event& ev) { return event_time(ev); }));
-        util::stable_sort_by(staged, [](const Event& ev) { return event_index(ev); });
-
-        std::size_t n_ev = staged.size();
-        util::assign_by(ev_data_, staged, [](const Event& ev) { return event_data(ev); });
-        util::assign_by(ev_time_, staged, [](const Event& ev) { return event_time(ev); });
-
-        // Determine divisions by `event_index` in ev list.
-        arb_assert(n_streams() == span_begin_.size());
-        arb_assert(n_streams() == span_end_.size());
-        arb_assert(n_streams() == mark_.size());
-
-        index_type ev_begin_i = 0;
-        index_type ev_i = 0;
-        for (size_type s = 0; s<n_streams(); ++s) {
-            while ((size_type)ev_i<n_ev && (size_type)(event_index(staged[ev_i]))<s+1) ++ev_i;
-
-            // Within a subrange of events with the same index, events should
-            // be sorted by time.
-            arb_assert(std::is_sorted(&ev_time_[ev_begin_i], &ev_time_[ev_i]));
-            mark_[s] = ev_begin_i;
-            span_begin_[s] = ev_begin_i;
-            span_end_[s] = ev_i;
-            ev_begin_i = ev_i;
+        // Events staged by the cell groups are already grouped by index.
+        if (util::is_sorted_by(staged, [](const Event& ev) { return event_index(ev); })) {
+            init_grouped(staged);
         }
+        else {
+            arb_assert(util::is_sorted_by(staged, [](const Event& ev) { return event_time(ev); }));
 
-        remaining_ = n_ev;
+            auto grouped = staged;
+            util::stable_sort_by(grouped, [](const Event& ev) { return event_index(ev); });
+            init_grouped(grouped);
+        }
     }
 
     // Designate for processing events `ev` at head of each event stream `i`
@@ -198,6 +181,38 @@ public:
     }
 
 private:
+    // Initialize from events grouped by index, sorted by time within each index.
+    void init_grouped(const std::vector<Event>& staged) {
+        using ::arb::event_time;
+        using ::arb::event_index;
+        using ::arb::event_data;
+
+        std::size_t n_ev = staged.size();
+        util::assign_by(ev_data_, staged, [](const Event& ev) { return event_data(ev); });
+        util::assign_by(ev_time_, staged, [](const Event& ev) { return event_time(ev); });
+
+        // Determine divisions by `event_index` in ev list.
+        arb_assert(n_streams() == span_begin_.size());
+        arb_assert(n_streams() == span_end_.size());
+        arb_assert(n_streams() == mark_.size());
+
+        index_type ev_begin_i = 0;
+        index_type ev_i = 0;
+        for (size_type s = 0; s<n_streams(); ++s) {
+            while ((size_type)ev_i<n_ev && (size_type)(event_index(staged[ev_i]))<s+1) ++ev_i;
+
+            // Within a subrange of events with the same index, events should
+            // be sorted by time.
+            arb_assert(std::is_sorted(&ev_time_[ev_begin_i], &ev_time_[ev_i]));
+            mark_[s] = ev_begin_i;
+            span_begin_[s] = ev_begin_i;
+            span_end_[s] = ev_i;
+            ev_begin_i = ev_i;
+        }
+
+        remaining_ = n_ev;
+    }
+
     std::vector<event_time_type> ev_time_;
     std::vector<index_type> span_begin_;
     std::vector<index_type> span_end_;
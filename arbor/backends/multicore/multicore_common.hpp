@@ -3,7 +3,8 @@
 // Storage classes and other common types across
 // multicore back end implementations.
 //
-// Defines array, iarray, and specialized multi-event stream classes.
+// Defines array, iarray, state_array, and specialized multi-event stream
+// classes.
 
 #include <utility>
 #include <vector>
@@ -24,6 +25,9 @@ using padded_vector = std::vector<V, util::padded_allocator<V>>;
 using array  = padded_vector<fvm_value_type>;
 using iarray = padded_vector<fvm_index_type>;
 
+// Storage for mechanism state and ion concentrations.
+using state_array = padded_vector<fvm_state_type>;
+
 using deliverable_event_stream = arb::multicore::multi_event_stream<deliverable_event>;
 using sample_event_stream = arb::multicore::multi_event_stream<sample_event>;
 
@@ -2,6 +2,7 @@
 #include <cmath>
 #include <iostream>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -30,6 +31,13 @@ constexpr unsigned simd_width = simd::simd_abi::native_width<fvm_value_type>::va
 using simd_value_type = simd::simd<fvm_value_type, simd_width>;
 using simd_index_type = simd::simd<fvm_index_type, simd_width>;
 
+// Ion concentrations are loaded and stored through simd_state_type, and
+// converted to and from simd_value_type for arithmetic.
+using simd_state_type = std::conditional_t<
+    std::is_same<fvm_state_type, fvm_value_type>::value,
+    simd_value_type,
+    simd::simd<fvm_state_type, simd_width>>;
+
 // Pick alignment compatible with native SIMD width for explicitly
 // vectorized operations below.
 //
@@ -86,8 +94,8 @@ void ion_state::nernst(fvm_value_type temperature_K) {
 
     simd_value_type factor = RF*temperature_K/charge;
     for (std::size_t i=0; i<Xi_.size(); i+=simd_width) {
-        simd_value_type xi(Xi_.data()+i);
-        simd_value_type xo(Xo_.data()+i);
+        simd_value_type xi(simd_state_type(Xi_.data()+i));
+        simd_value_type xo(simd_state_type(Xo_.data()+i));
 
         auto ex = factor*log(xo/xi);
         ex.copy_to(eX_.data()+i);
@@ -100,10 +108,10 @@ void ion_state::init_concentration() {
         simd_value_type weight_xo(weight_Xo_.data()+i);
 
         auto xi = default_int_concentration*weight_xi;
-        xi.copy_to(Xi_.data()+i);
+        simd_state_type(xi).copy_to(Xi_.data()+i);
 
         auto xo = default_ext_concentration*weight_xo;
-        xo.copy_to(Xo_.data()+i);
+        simd_state_type(xo).copy_to(Xo_.data()+i);
     }
 }
 
@@ -216,19 +224,66 @@ std::pair<fvm_value_type, fvm_value_type> shared_state::voltage_bounds() const {
     return util::minmax_value(voltage);
 }
 
+void shared_state::set_sample_handles(const std::vector<probe_handle>& handles) {
+    sample_handles = handles;
+}
+
 void shared_state::take_samples(
     const sample_event_stream::state& s,
     array& sample_time,
     array& sample_value)
 {
+    const probe_handle* handles = sample_handles.data();
+
     for (fvm_size_type i = 0; i<s.n_streams(); ++i) {
         auto begin = s.begin_marked(i);
         auto end = s.end_marked(i);
+        const fvm_value_type t = time[i];
 
-        // (Note: probably not worth explicitly vectorizing this.)
+        // Each event gathers the values of a run of probe handles.
         for (auto p = begin; p<end; ++p) {
-            sample_time[p->offset] = time[i];
-            sample_value[p->offset] = *p->handle;
+            const auto n = p->end-p->begin;
+            const auto stride = p->stride;
+            const probe_handle* h = handles+p->begin;
+            fvm_value_type* st = sample_time.data()+p->offset;
+            fvm_value_type* sv = sample_value.data()+p->offset;
+            const fvm_value_type ts = p->policy==sampling_policy::interpolated? p->time: t;
+
+            for (fvm_size_type k = 0; k<n; ++k) {
+                st[k*stride] = ts;
+                sv[k*stride] = *h[k];
+            }
+        }
+    }
+}
+
+void shared_state::interpolate_samples(
+    const sample_event_stream::state& s,
+    array& sample_time,
+    array& sample_value)
+{
+    const probe_handle* handles = sample_handles.data();
+
+    for (fvm_size_type i = 0; i<s.n_streams(); ++i) {
+        auto begin = s.begin_marked(i);
+        auto end = s.end_marked(i);
+        const fvm_value_type t0 = time[i];
+        const fvm_value_type t1 = time_to[i];
+
+        if (!(t1>t0)) continue;
+
+        for (auto p = begin; p<end; ++p) {
+            if (p->policy!=sampling_policy::interpolated) continue;
+
+            const auto n = p->end-p->begin;
+            const auto stride = p->stride;
+            const probe_handle* h = handles+p->begin;
+            fvm_value_type* sv = sample_value.data()+p->offset;
+            const fvm_value_type a = (p->time-t0)/(t1-t0);
+
+            for (fvm_size_type k = 0; k<n; ++k) {
+                sv[k*stride] += a*(*h[k]-sv[k*stride]);
+            }
         }
     }
 }
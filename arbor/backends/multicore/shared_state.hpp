@@ -45,8 +45,8 @@ struct ion_state {
     iarray node_index_; // Instance to CV map.
     array iX_;          // (nA) current
     array eX_;          // (mV) reversal potential
-    array Xi_;          // (mM) internal concentration
-    array Xo_;          // (mM) external concentration
+    state_array Xi_;    // (mM) internal concentration
+    state_array Xo_;    // (mM) external concentration
     array weight_Xi_;   // (1) concentration weight internal
     array weight_Xo_;   // (1) concentration weight external
 
@@ -95,6 +95,7 @@ struct shared_state {
     array  voltage;           // Maps CV index to membrane voltage [mV].
     array  current_density;   // Maps CV index to current density [A/m²].
     fvm_value_type temperature_degC;  // Global temperature [°C].
+    std::vector<probe_handle> sample_handles; // Probe handles of the sampling plan.
 
     std::unordered_map<ionKind, ion_state> ion_data;
 
@@ -133,12 +134,22 @@ struct shared_state {
     // (Used for solution bounds checking.)
     std::pair<fvm_value_type, fvm_value_type> voltage_bounds() const;
 
+    // Set the probe handles sampled by sample events.
+    void set_sample_handles(const std::vector<probe_handle>& handles);
+
     // Take samples according to marked events in a sample_event_stream.
     void take_samples(
         const sample_event_stream::state& s,
         array& sample_time,
         array& sample_value);
 
+    // Complete interpolated samples taken by take_samples() at the start of
+    // the step, from the state at the end of the step.
+    void interpolate_samples(
+        const sample_event_stream::state& s,
+        array& sample_time,
+        array& sample_value);
+
     void reset(fvm_value_type initial_voltage, fvm_value_type temperature_K);
 };
 
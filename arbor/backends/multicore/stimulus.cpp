@@ -1,13 +1,28 @@
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 #include <arbor/fvm_types.hpp>
+#include <arbor/math.hpp>
 
 #include "backends/builtin_mech_proto.hpp"
 #include "backends/multicore/mechanism.hpp"
+#include "util/rangeutil.hpp"
+#include "util/span.hpp"
 
 namespace arb {
 
 namespace multicore {
+
+// The stimuli are idle on almost every step, so rather than testing the
+// window of every stimulus on every step, the stimuli of each cell are kept
+// in two lists, ordered by onset and by offset time, with a cursor into each
+// that is advanced with the cell time. Only the stimuli between the two, which
+// are kept in a compact list of active stimuli, contribute a current.
+//
+// The schedule is built by nrn_init(), and assumes that the time of each cell
+// does not decrease between calls to nrn_init().
+
 class stimulus: public arb::multicore::mechanism {
 public:
     const mechanism_fingerprint& fingerprint() const override {
@@ -18,20 +33,82 @@ public:
     mechanismKind kind() const override { return ::arb::mechanismKind::point; }
     mechanism_ptr clone() const override { return mechanism_ptr(new stimulus()); }
 
-    void nrn_init() override {}
-    void nrn_state() override {}
-    void nrn_current() override {
+    void nrn_init() override {
+        using util::make_span;
+
         size_type n = size();
+        t_on_.resize(n);
+        t_off_.resize(n);
         for (size_type i=0; i<n; ++i) {
-            auto cv = node_index_[i];
-            auto t = vec_t_[vec_ci_[cv]];
+            t_on_[i] = delay[i];
+            // A stimulus with negative duration is never on.
+            t_off_[i] = std::max<value_type>(t_on_[i], delay[i]+duration[i]);
+        }
+
+        // Group the stimuli by cell, and order those of each cell by onset
+        // and by offset time.
+        auto cell_of = [this](size_type i) { return vec_ci_[node_index_[i]]; };
+        auto order_by_cell_then = [&](std::vector<size_type>& order, const std::vector<value_type>& t) {
+            util::assign(order, make_span(n));
+            std::stable_sort(order.begin(), order.end(),
+                [&](size_type i, size_type j) {
+                    return cell_of(i)<cell_of(j) || (cell_of(i)==cell_of(j) && t[i]<t[j]);
+                });
+        };
+        order_by_cell_then(on_order_, t_on_);
+        order_by_cell_then(off_order_, t_off_);
+
+        cells_.clear();
+        cell_divs_.clear();
+        for (size_type k=0; k<n; ++k) {
+            auto cell = cell_of(on_order_[k]);
+            if (cells_.empty() || cells_.back()!=cell) {
+                cells_.push_back(cell);
+                cell_divs_.push_back(k);
+            }
+        }
+        cell_divs_.push_back(n);
+
+        next_on_.assign(cell_divs_.begin(), cell_divs_.end()-1);
+        next_off_.assign(cell_divs_.begin(), cell_divs_.end()-1);
+
+        active_.clear();
+        active_.reserve(n);
+        active_pos_.assign(n, npos);
+    }
+
+    void nrn_state() override {}
+
+    void nrn_current() override {
+        // Update the active list for the current time of each cell.
+        for (size_type c=0; c<cells_.size(); ++c) {
+            auto t = vec_t_[cells_[c]];
+            auto end = cell_divs_[c+1];
 
-            if (t>=delay[i] && t<delay[i]+duration[i]) {
-                // Amplitudes are given as a current into a compartment, so subtract.
-                vec_i_[cv] -= weight_[i]*amplitude[i];
+            auto& on = next_on_[c];
+            while (on<end && t>=t_on_[on_order_[on]]) {
+                activate(on_order_[on++]);
             }
+            // Stimuli turn off no earlier than they turn on, so any stimulus
+            // passed here has been activated above or in an earlier call.
+            auto& off = next_off_[c];
+            while (off<end && t>=t_off_[off_order_[off]]) {
+                deactivate(off_order_[off++]);
+            }
+        }
+
+        for (auto i: active_) {
+            auto cv = node_index_[i];
+            value_type a = amplitude[i];
+            if (frequency[i]) {
+                auto t = vec_t_[vec_ci_[cv]];
+                a *= std::sin(2*math::pi<value_type>*frequency[i]*(t-t_on_[i]) + phase[i]);
+            }
+            // Amplitudes are given as a current into a compartment, so subtract.
+            vec_i_[cv] -= weight_[i]*a;
         }
     }
+
     void write_ions() override {}
     void deliver_events(deliverable_event_stream::state events) override {}
 
@@ -42,7 +119,9 @@ protected:
         return {
             {"delay", &delay},
             {"duration", &duration},
-            {"amplitude", &amplitude}
+            {"amplitude", &amplitude},
+            {"frequency", &frequency},
+            {"phase", &phase}
         };
     }
 
@@ -50,14 +129,59 @@ protected:
         return {
             {"delay", 0},
             {"duration", 0},
-            {"amplitude", 0}
+            {"amplitude", 0},
+            {"frequency", 0},
+            {"phase", 0}
         };
     }
+
 private:
-    fvm_value_type* delay;
-    fvm_value_type* duration;
-    fvm_value_type* amplitude;
+    static constexpr size_type npos = size_type(-1);
+
+    void activate(size_type i) {
+        active_pos_[i] = active_.size();
+        active_.push_back(i);
+    }
+
+    void deactivate(size_type i) {
+        auto pos = active_pos_[i];
+        if (pos==npos) return;
+
+        auto last = active_.back();
+        active_[pos] = last;
+        active_pos_[last] = pos;
+        active_.pop_back();
+        active_pos_[i] = npos;
+    }
+
+    state_type* delay;
+    state_type* duration;
+    state_type* amplitude;
+    state_type* frequency;
+    state_type* phase;
+
+    // Onset and offset time of each stimulus.
+    std::vector<value_type> t_on_;
+    std::vector<value_type> t_off_;
+
+    // Cells with stimuli, and the partition of the stimuli by cell.
+    std::vector<index_type> cells_;
+    std::vector<size_type> cell_divs_;
+
+    // Stimulus indices of each cell ordered by onset and by offset time,
+    // and the cursor of each cell into each.
+    std::vector<size_type> on_order_;
+    std::vector<size_type> off_order_;
+    std::vector<size_type> next_on_;
+    std::vector<size_type> next_off_;
+
+    // Active stimuli, and the position of each stimulus in the active list.
+    std::vector<size_type> active_;
+    std::vector<size_type> active_pos_;
 };
+
+constexpr stimulus::size_type stimulus::npos;
+
 } // namespace multicore
 
 template <>
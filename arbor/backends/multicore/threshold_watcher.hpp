@@ -1,9 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include <arbor/assert.hpp>
 #include <arbor/execution_context.hpp>
 #include <arbor/fvm_types.hpp>
 #include <arbor/math.hpp>
+#include <arbor/simd/simd.hpp>
 
 #include "backends/threshold_crossing.hpp"
 #include "multicore_common.hpp"
@@ -12,6 +17,9 @@ namespace arb {
 namespace multicore {
 
 class threshold_watcher {
+    // Detectors are tested in blocks of the native SIMD width.
+    static constexpr unsigned simd_width = simd::simd_abi::native_width<fvm_value_type>::value;
+
 public:
     threshold_watcher() = default;
 
@@ -30,13 +38,22 @@ public:
         t_before_(t_before),
         t_after_(t_after),
         values_(values),
-        n_cv_(cv_index.size()),
-        cv_index_(cv_index),
-        is_crossed_(n_cv_),
-        thresholds_(thresholds),
-        v_prev_(values_, values_+n_cv_)
+        n_cv_(cv_index.size())
     {
         arb_assert(n_cv_==thresholds.size());
+
+        // The detector state is padded to a multiple of the SIMD width;
+        // padding detectors watch the first CV with an infinite threshold.
+        fvm_size_type n_pad = (n_cv_+simd_width-1)/simd_width*simd_width;
+
+        cv_index_.assign(n_pad, n_cv_? cv_index[0]: 0);
+        thresholds_.assign(n_pad, INFINITY);
+        v_prev_.assign(n_pad, 0);
+
+        std::copy(cv_index.begin(), cv_index.end(), cv_index_.begin());
+        std::copy(thresholds.begin(), thresholds.end(), thresholds_.begin());
+
+        crossings_.reserve(n_cv_);
         reset();
     }
 
@@ -51,8 +68,8 @@ public:
     /// calling, because the values are used to determine the initial state
     void reset() {
         clear_crossings();
-        for (fvm_size_type i = 0; i<n_cv_; ++i) {
-            is_crossed_[i] = values_[cv_index_[i]]>=thresholds_[i];
+        for (fvm_size_type i = 0; i<cv_index_.size(); ++i) {
+            v_prev_[i] = values_[cv_index_[i]];
         }
     }
 
@@ -63,37 +80,48 @@ public:
     /// Tests each target for changed threshold state
     /// Crossing events are recorded for each threshold that
     /// is crossed since the last call to test
+    ///
+    /// A detector is in the crossed state if the value at the previous
+    /// test was at or above the threshold. The values are gathered and
+    /// compared a block at a time, in a branch-free loop that the compiler
+    /// vectorizes; only the rare blocks with a crossing from below are
+    /// revisited to compute the crossing times.
     void test() {
-        for (fvm_size_type i = 0; i<n_cv_; ++i) {
-            auto cv     = cv_index_[i];
-            auto cell   = cv_to_cell_[cv];
-            auto v_prev = v_prev_[i];
-            auto v      = values_[cv];
-            auto thresh = thresholds_[i];
-
-            if (!is_crossed_[i]) {
-                if (v>=thresh) {
-                    // The threshold has been passed, so estimate the time using
-                    // linear interpolation.
-                    auto pos = (thresh - v_prev)/(v - v_prev);
-                    auto crossing_time = math::lerp(t_before_[cell], t_after_[cell], pos);
-                    crossings_.push_back({i, crossing_time});
-
-                    is_crossed_[i] = true;
-                }
+        const fvm_size_type n_pad = cv_index_.size();
+        const fvm_index_type* cv_index = cv_index_.data();
+        const fvm_value_type* thresholds = thresholds_.data();
+        fvm_value_type* v_prev = v_prev_.data();
+
+        for (fvm_size_type i = 0; i<n_pad; i += simd_width) {
+            fvm_value_type v[simd_width];
+            int hit = 0;
+            for (unsigned j = 0; j<simd_width; ++j) {
+                v[j] = values_[cv_index[i+j]];
+                hit |= (v_prev[i+j]<thresholds[i+j]) & (v[j]>=thresholds[i+j]);
             }
-            else {
-                if (v<thresh) {
-                    is_crossed_[i] = false;
+
+            if (hit) {
+                for (unsigned j = 0; j<simd_width; ++j) {
+                    auto thresh = thresholds[i+j];
+                    if (v_prev[i+j]<thresh && v[j]>=thresh) {
+                        // The threshold has been passed, so estimate the time using
+                        // linear interpolation.
+                        auto cell = cv_to_cell_[cv_index[i+j]];
+                        auto pos = (thresh - v_prev[i+j])/(v[j] - v_prev[i+j]);
+                        auto crossing_time = math::lerp(t_before_[cell], t_after_[cell], pos);
+                        crossings_.push_back({i+j, crossing_time});
+                    }
                 }
             }
 
-            v_prev_[i] = v;
+            for (unsigned j = 0; j<simd_width; ++j) {
+                v_prev[i+j] = v[j];
+            }
         }
     }
 
     bool is_crossed(fvm_size_type i) const {
-        return is_crossed_[i];
+        return v_prev_[i]>=thresholds_[i];
     }
 
     /// The number of threshold values that are monitored.
@@ -109,12 +137,11 @@ private:
     const fvm_value_type* t_after_ = nullptr;
     const fvm_value_type* values_ = nullptr;
 
-    /// Threshold watcher state.
+    /// Threshold watcher state, padded to a multiple of the SIMD width.
     fvm_size_type n_cv_ = 0;
-    std::vector<fvm_index_type> cv_index_;
-    std::vector<fvm_size_type> is_crossed_;
-    std::vector<fvm_value_type> thresholds_;
-    std::vector<fvm_value_type> v_prev_;
+    iarray cv_index_;
+    array thresholds_;
+    array v_prev_;
     std::vector<threshold_crossing> crossings_;
 };
 
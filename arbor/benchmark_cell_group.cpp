@@ -59,7 +59,7 @@ void benchmark_cell_group::advance(epoch ep,
 
         auto spike_times = util::make_range(cells_[i].time_sequence.events(t_, ep.tfinal));
         for (auto t: spike_times) {
-            spikes_.push_back({{gid, 0u}, t});
+            spike_sink().push_back({{gid, 0u}, t});
         }
 
         // Wait until the expected time to advance has elapsed. Use a busy-wait
@@ -72,12 +72,16 @@ void benchmark_cell_group::advance(epoch ep,
     PL();
 };
 
+void benchmark_cell_group::set_spike_sink(std::vector<spike>* sink) {
+    sink_ = sink;
+}
+
 const std::vector<spike>& benchmark_cell_group::spikes() const {
-    return spikes_;
+    return sink_? *sink_: spikes_;
 }
 
 void benchmark_cell_group::clear_spikes() {
-    spikes_.clear();
+    spike_sink().clear();
 }
 
 void benchmark_cell_group::add_sampler(sampler_association_handle h,
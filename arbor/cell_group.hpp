@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <stdexcept>
 #include <vector>
 
 #include <arbor/common_types.hpp>
@@ -12,13 +13,12 @@
 
 #include "epoch.hpp"
 #include "event_binner.hpp"
+#include "event_lanes.hpp"
 #include "event_queue.hpp"
 #include "util/rangeutil.hpp"
 
 namespace arb {
 
-using event_lane_subrange = util::subrange_view_type<std::vector<pse_vector>>;
-
 class cell_group {
 public:
     virtual ~cell_group() = default;
@@ -29,6 +29,10 @@ public:
     virtual void set_binning_policy(binning_kind policy, time_type bin_interval) = 0;
     virtual void advance(epoch epoch, time_type dt, const event_lane_subrange& events) = 0;
 
+    // Spikes generated by advance() are appended to the sink set by
+    // set_spike_sink(), or to a buffer owned by the cell group if the sink
+    // is null. spikes() and clear_spikes() refer to the sink in use.
+    virtual void set_spike_sink(std::vector<spike>* sink) = 0;
     virtual const std::vector<spike>& spikes() const = 0;
     virtual void clear_spikes() = 0;
 
@@ -36,6 +40,28 @@ public:
     // from a sampler call back called from a different cell group running on a different thread.
 
     virtual void add_sampler(sampler_association_handle, cell_member_predicate, schedule, sampler_function, sampling_policy) = 0;
+
+    // By default, a bulk sampler is called for each probe in turn, with the
+    // samples copied from the sample records.
+    virtual void add_bulk_sampler(sampler_association_handle h, cell_member_predicate probe_ids, schedule sched, bulk_sampler_function fn, sampling_policy policy) {
+        auto per_probe = [fn = std::move(fn)](cell_member_type pid, probe_tag tag, std::size_t n, const sample_record* recs) {
+            std::vector<time_type> time(n);
+            std::vector<double> value(n);
+            for (std::size_t i = 0; i<n; ++i) {
+                time[i] = recs[i].time;
+                auto p = util::any_cast<const double*>(recs[i].data);
+                if (!p) {
+                    throw std::runtime_error("unexpected sample type in bulk sampler");
+                }
+                value[i] = *p;
+            }
+
+            const std::size_t offset[2] = {0, n};
+            fn(sample_columns{1, &pid, &tag, offset, time.data(), value.data()});
+        };
+        add_sampler(h, std::move(probe_ids), std::move(sched), std::move(per_probe), policy);
+    }
+
     virtual void remove_sampler(sampler_association_handle) = 0;
     virtual void remove_all_samplers() = 0;
 };
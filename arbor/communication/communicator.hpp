@@ -4,6 +4,7 @@
 #include <functional>
 #include <iostream>
 #include <random>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -17,6 +18,7 @@
 
 #include "algorithms.hpp"
 #include "connection.hpp"
+#include "event_lanes.hpp"
 #include "event_queue.hpp"
 #include "profile/profiler_macro.hpp"
 #include "threading/threading.hpp"
@@ -50,6 +52,7 @@ public:
         thread_pool_ = ctx.thread_pool;
 
         num_domains_ = distributed_->size();
+        exchange_mode_ = distributed_->spike_exchange();
         num_local_groups_ = dom_dec.groups.size();
         num_local_cells_ = dom_dec.num_local_cells;
 
@@ -126,11 +129,20 @@ public:
 
         // Sort the connections for each domain.
         // This is num_domains_ independent sorts, so it can be parallelized trivially.
+        // Each sort is itself parallel, for the case of few domains with many
+        // connections.
         const auto& cp = connection_part_;
         threading::parallel_for::apply(0, num_domains_, thread_pool_.get(),
             [&](cell_size_type i) {
-                util::sort(util::subrange_view(connections_, cp[i], cp[i+1]));
+                threading::parallel_sort::apply(
+                    connections_.begin()+cp[i], connections_.begin()+cp[i+1], thread_pool_.get());
             });
+
+        build_source_index();
+
+        if (exchange_mode_==spike_exchange_mode::sparse) {
+            build_spike_routes();
+        }
     }
 
     /// The range of event queues that belong to cells in group i.
@@ -152,94 +164,198 @@ public:
     /// Perform exchange of spikes.
     ///
     /// Takes as input the list of local_spikes that were generated on the calling domain.
-    /// Returns the full global set of vectors, along with meta data about their partition
+    /// Returns the spikes required for event generation on this domain, along with
+    /// meta data about their partition by source domain. In the allgather exchange
+    /// mode this is the full global set of spikes; in the sparse mode only the
+    /// spikes from sources with connections on this domain are received.
     gathered_vector<spike> exchange(std::vector<spike> local_spikes) {
+        start_exchange(std::move(local_spikes));
+        return complete_exchange();
+    }
+
+    /// Start an exchange of spikes, which is completed by complete_exchange().
+    ///
+    /// The exchange proceeds in the background if the distributed context
+    /// supports asynchronous collectives. At most one exchange may be pending.
+    void start_exchange(std::vector<spike> local_spikes) {
+        arb_assert(!pending_exchange_.pending());
+
         PE(communication_exchange_sort);
-        // sort the spikes in ascending order of source gid
-        util::sort_by(local_spikes, [](spike s){return s.source;});
+        // sort the spikes in ascending order of source gid; the spikes
+        // gathered from the local spike stores are already sorted.
+        auto source_less = [](const spike& l, const spike& r) {return l.source<r.source;};
+        if (!std::is_sorted(local_spikes.begin(), local_spikes.end(), source_less)) {
+            threading::parallel_sort::apply(local_spikes, thread_pool_.get(), source_less);
+        }
         PL();
 
+        pending_local_spikes_ = local_spikes.size();
+
+        if (exchange_mode_==spike_exchange_mode::sparse) {
+            PE(communication_exchange_route);
+            std::vector<unsigned> send_partition;
+            auto send_spikes = route_spikes(local_spikes, send_partition);
+            PL();
+
+            PE(communication_exchange_gather);
+            pending_exchange_ = distributed_->start_exchange_spikes(send_spikes, send_partition);
+            PL();
+            return;
+        }
+
         PE(communication_exchange_gather);
         // global all-to-all to gather a local copy of the global spike list on each node.
-        auto global_spikes = distributed_->gather_spikes(local_spikes);
-        num_spikes_ += global_spikes.size();
+        pending_exchange_ = distributed_->start_gather_spikes(local_spikes);
         PL();
+    }
+
+    /// Wait for the pending exchange to complete, and return the spikes
+    /// received, as for exchange().
+    gathered_vector<spike> complete_exchange() {
+        PE(communication_exchange_wait);
+        auto spikes = pending_exchange_.complete();
+        if (exchange_mode_==spike_exchange_mode::sparse) {
+            // Not all spikes are received: count the local spikes, which
+            // are summed over the domains by reduce_num_spikes().
+            unreduced_local_spikes_ += pending_local_spikes_;
+        }
+        else {
+            num_spikes_ += spikes.size();
+        }
+        PL();
+
+        return spikes;
+    }
+
+    /// Gather the full global set of spikes.
+    ///
+    /// In the sparse exchange mode, exchange() does not return all spikes;
+    /// this is used to obtain them for output. Must be called on all domains.
+    gathered_vector<spike> gather_spikes(const std::vector<spike>& local_spikes) {
+        return distributed_->gather_spikes(local_spikes);
+    }
+
+    /// True if exchange() returns the full global set of spikes.
+    bool exchanges_all_spikes() const {
+        return exchange_mode_==spike_exchange_mode::allgather;
+    }
 
-        return global_spikes;
+    /// Collective: true if flag is set on any domain.
+    bool any_domain(bool flag) const {
+        return distributed_->max(int(flag));
     }
 
     /// Check each global spike in turn to see it generates local events.
-    /// If so, make the events and insert them into the appropriate event list.
+    /// If so, make the events and store them in the lane of their target cell.
     ///
-    /// Takes reference to a vector of event lists as an argument, with one list
-    /// for each local cell group. On completion, the events in each list are
-    /// all events that must be delivered to targets in that cell group as a
-    /// result of the global spike exchange, plus any events that were already
-    /// in the list.
+    /// Takes a reference to an event lane store with one lane for each local
+    /// cell. On completion, the events in each lane are all events that must
+    /// be delivered to that cell as a result of the global spike exchange,
+    /// in the order of the spikes, then of the connections. Any events that
+    /// were already in the store are discarded.
+    ///
+    /// The connections of each spike are found in constant time with the
+    /// source index. The lanes are filled with a pass that counts the events
+    /// of each cell, followed by a pass that scatters the events into the
+    /// lanes. With more than one thread and many spikes, the spikes are split
+    /// into chunks, and the events of each chunk are made in parallel into
+    /// buckets by block of target cells; the blocks are then counted and
+    /// scattered in parallel, taking the buckets in chunk order, so that the
+    /// result does not depend on the number of threads.
     void make_event_queues(
             const gathered_vector<spike>& global_spikes,
-            std::vector<pse_vector>& queues)
+            event_lane_store& queues)
     {
         arb_assert(queues.size()==num_local_cells_);
 
-        using util::subrange_view;
-        using util::make_span;
-        using util::make_range;
+        const auto& spikes = global_spikes.values();
+        const auto n_spikes = spikes.size();
+        const std::size_t n_chunks = thread_pool_->get_num_threads();
 
-        const auto& sp = global_spikes.partition();
-        const auto& cp = connection_part_;
-        for (auto dom: make_span(num_domains_)) {
-            auto cons = subrange_view(connections_, cp[dom], cp[dom+1]);
-            auto spks = subrange_view(global_spikes.values(), sp[dom], sp[dom+1]);
-
-            struct spike_pred {
-                bool operator()(const spike& spk, const cell_member_type& src)
-                    {return spk.source<src;}
-                bool operator()(const cell_member_type& src, const spike& spk)
-                    {return src<spk.source;}
-            };
-
-            // We have a choice of whether to walk spikes or connections:
-            // i.e., we can iterate over the spikes, and for each spike search
-            // the for connections that have the same source; or alternatively
-            // for each connection, we can search the list of spikes for spikes
-            // with the same source.
-            //
-            // We iterate over whichever set is the smallest, which has
-            // complexity of order max(S log(C), C log(S)), where S is the
-            // number of spikes, and C is the number of connections.
-            if (cons.size()<spks.size()) {
-                auto sp = spks.begin();
-                auto cn = cons.begin();
-                while (cn!=cons.end() && sp!=spks.end()) {
-                    auto sources = std::equal_range(sp, spks.end(), cn->source(), spike_pred());
-                    for (auto s: make_range(sources)) {
-                        queues[cn->index_on_domain()].push_back(cn->make_event(s));
-                    }
+        queues.clear();
+        lane_cursor_.resize(num_local_cells_);
 
-                    sp = sources.first;
-                    ++cn;
-                }
+        if (n_chunks<2 || n_spikes<parallel_min_spikes) {
+            auto first = spikes.data();
+            auto last = first+n_spikes;
+
+            for_each_event(first, last,
+                [&](const connection& c, const spike&) {
+                    queues.add_count(c.index_on_domain(), 1);
+                });
+            queues.allocate();
+
+            for (auto i: util::make_span(num_local_cells_)) {
+                lane_cursor_[i] = queues.offset(i);
             }
-            else {
-                auto cn = cons.begin();
-                auto sp = spks.begin();
-                while (cn!=cons.end() && sp!=spks.end()) {
-                    auto targets = std::equal_range(cn, cons.end(), sp->source);
-                    for (auto c: make_range(targets)) {
-                        queues[c.index_on_domain()].push_back(c.make_event(*sp));
+            auto events = queues.data();
+            for_each_event(first, last,
+                [&](const connection& c, const spike& spk) {
+                    events[lane_cursor_[c.index_on_domain()]++] = c.make_event(spk);
+                });
+            return;
+        }
+
+        const std::size_t n_blocks = std::min<std::size_t>(n_chunks, num_local_cells_);
+        auto block_of = [&](cell_size_type i) {
+            return std::size_t(std::uint64_t(i)*n_blocks/num_local_cells_);
+        };
+        auto block_first = [&](std::size_t b) {
+            return cell_size_type((std::uint64_t(b)*num_local_cells_+n_blocks-1)/n_blocks);
+        };
+
+        event_buckets_.resize(n_chunks*n_blocks);
+        threading::parallel_for::apply(0, n_chunks, thread_pool_.get(),
+            [&](std::size_t k) {
+                auto buckets = event_buckets_.data()+k*n_blocks;
+                for (auto b: util::make_span(n_blocks)) {
+                    buckets[b].clear();
+                }
+                for_each_event(spikes.data()+k*n_spikes/n_chunks, spikes.data()+(k+1)*n_spikes/n_chunks,
+                    [&](const connection& c, const spike& spk) {
+                        auto i = c.index_on_domain();
+                        buckets[block_of(i)].push_back({i, c.make_event(spk)});
+                    });
+            });
+
+        threading::parallel_for::apply(0, n_blocks, thread_pool_.get(),
+            [&](std::size_t b) {
+                for (auto k: util::make_span(n_chunks)) {
+                    for (auto& e: event_buckets_[k*n_blocks+b]) {
+                        queues.add_count(e.first, 1);
                     }
+                }
+            });
+        queues.allocate();
 
-                    cn = targets.first;
-                    ++sp;
+        auto events = queues.data();
+        threading::parallel_for::apply(0, n_blocks, thread_pool_.get(),
+            [&](std::size_t b) {
+                for (auto i: util::make_span(block_first(b), block_first(b+1))) {
+                    lane_cursor_[i] = queues.offset(i);
                 }
-            }
-        }
+                for (auto k: util::make_span(n_chunks)) {
+                    for (auto& e: event_buckets_[k*n_blocks+b]) {
+                        events[lane_cursor_[e.first]++] = e.second;
+                    }
+                }
+            });
     }
 
-    /// Returns the total number of global spikes over the duration of the simulation
+    /// Returns the total number of global spikes over the duration of the
+    /// simulation. In the sparse exchange mode, only the spikes exchanged up
+    /// to the last call to reduce_num_spikes() are counted.
     std::uint64_t num_spikes() const { return num_spikes_; }
 
+    /// Add the spikes exchanged in the sparse mode since the last call to
+    /// the global spike count. Must be called on all domains.
+    void reduce_num_spikes() {
+        if (exchange_mode_==spike_exchange_mode::sparse) {
+            num_spikes_ += distributed_->sum(unreduced_local_spikes_);
+            unreduced_local_spikes_ = 0;
+        }
+    }
+
     cell_size_type num_local_cells() const {
         return num_local_cells_;
     }
@@ -250,9 +366,175 @@ public:
 
     void reset() {
         num_spikes_ = 0;
+        unreduced_local_spikes_ = 0;
     }
 
 private:
+    // Minimum number of global spikes for which make_event_queues() divides
+    // the work between threads.
+    static constexpr std::size_t parallel_min_spikes = 1024;
+
+    // Range of connections_ with a given source gid.
+    using connection_range = std::pair<cell_size_type, cell_size_type>;
+
+    // Connections with the same source gid are contiguous in connections_,
+    // as they are in the partition of the source domain, sorted by source.
+    //
+    // If the source gids span a range that is not much larger than the
+    // number of distinct source gids, the connection ranges are stored in a
+    // table indexed by gid relative to the smallest source gid; otherwise
+    // in a hash table.
+    void build_source_index() {
+        source_dense_.clear();
+        source_sparse_.clear();
+        source_gid_min_ = 0;
+
+        std::vector<std::pair<cell_gid_type, connection_range>> ranges;
+        for (cell_size_type b = 0; b<connections_.size();) {
+            auto gid = connections_[b].source().gid;
+            auto e = b+1;
+            while (e<connections_.size() && connections_[e].source().gid==gid) ++e;
+            ranges.push_back({gid, {b, e}});
+            b = e;
+        }
+        if (ranges.empty()) {
+            source_is_dense_ = true;
+            return;
+        }
+
+        auto minmax = std::minmax_element(ranges.begin(), ranges.end());
+        std::size_t extent = minmax.second->first - minmax.first->first + 1;
+        source_is_dense_ = extent <= 4*ranges.size()+1024;
+
+        if (source_is_dense_) {
+            source_gid_min_ = minmax.first->first;
+            source_dense_.assign(extent, connection_range(0, 0));
+            for (auto& r: ranges) {
+                source_dense_[r.first-source_gid_min_] = r.second;
+            }
+        }
+        else {
+            source_sparse_.reserve(ranges.size());
+            for (auto& r: ranges) {
+                source_sparse_.insert(r);
+            }
+        }
+    }
+
+    connection_range source_connections(cell_gid_type gid) const {
+        if (source_is_dense_) {
+            // Gids below source_gid_min_ wrap around to large offsets.
+            std::size_t k = gid-source_gid_min_;
+            return k<source_dense_.size()? source_dense_[k]: connection_range(0, 0);
+        }
+        auto it = source_sparse_.find(gid);
+        return it==source_sparse_.end()? connection_range(0, 0): it->second;
+    }
+
+    // Set up the routes for sparse spike exchange.
+    //
+    // Each domain sends to each source domain the sorted list of source gids
+    // of its connections from that domain. The gids received from each domain
+    // are the local sources from which that domain requires spikes, which are
+    // stored as a list of destination domains for each such local source:
+    // the destinations of local gid route_gids_[i] are
+    // route_domains_[route_divs_[i], route_divs_[i+1]).
+    void build_spike_routes() {
+        const auto& cp = connection_part_;
+
+        std::vector<cell_gid_type> needed;
+        std::vector<unsigned> needed_partition = {0u};
+        for (auto dom: util::make_span(num_domains_)) {
+            for (auto i: util::make_span(cp[dom], cp[dom+1])) {
+                auto gid = connections_[i].source().gid;
+                if (needed.size()==needed_partition.back() || needed.back()!=gid) {
+                    needed.push_back(gid);
+                }
+            }
+            needed_partition.push_back(needed.size());
+        }
+
+        auto requests = distributed_->exchange_gids(needed, needed_partition);
+
+        std::vector<std::pair<cell_gid_type, unsigned>> routes;
+        routes.reserve(requests.size());
+        for (auto dom: util::make_span(num_domains_)) {
+            const auto& rp = requests.partition();
+            for (auto i: util::make_span(rp[dom], rp[dom+1])) {
+                routes.push_back({requests.values()[i], dom});
+            }
+        }
+        std::sort(routes.begin(), routes.end());
+
+        route_gids_.clear();
+        route_domains_.clear();
+        route_divs_.assign(1, 0);
+        for (auto& r: routes) {
+            if (route_gids_.empty() || route_gids_.back()!=r.first) {
+                if (!route_gids_.empty()) {
+                    route_divs_.push_back(route_domains_.size());
+                }
+                route_gids_.push_back(r.first);
+            }
+            route_domains_.push_back(r.second);
+        }
+        if (!route_gids_.empty()) {
+            route_divs_.push_back(route_domains_.size());
+        }
+    }
+
+    // Copy each spike in sorted local_spikes once for each domain that
+    // requires it, ordered by destination domain, and set send_partition
+    // to the partition of the result by destination domain.
+    std::vector<spike> route_spikes(const std::vector<spike>& local_spikes, std::vector<unsigned>& send_partition) {
+        // Index into route_gids_ for each spike, or -1 if not required.
+        std::vector<int> route(local_spikes.size());
+        std::vector<unsigned> counts(num_domains_, 0);
+
+        auto r = route_gids_.begin();
+        for (auto i: util::make_span(local_spikes.size())) {
+            auto gid = local_spikes[i].source.gid;
+            r = std::lower_bound(r, route_gids_.end(), gid);
+            if (r==route_gids_.end() || *r!=gid) {
+                route[i] = -1;
+                continue;
+            }
+            route[i] = r-route_gids_.begin();
+            for (auto j: util::make_span(route_divs_[route[i]], route_divs_[route[i]+1])) {
+                ++counts[route_domains_[j]];
+            }
+        }
+
+        send_partition = algorithms::make_index(counts);
+        auto offsets = send_partition;
+
+        std::vector<spike> send(send_partition.back());
+        for (auto i: util::make_span(local_spikes.size())) {
+            if (route[i]<0) continue;
+            for (auto j: util::make_span(route_divs_[route[i]], route_divs_[route[i]+1])) {
+                send[offsets[route_domains_[j]]++] = local_spikes[i];
+            }
+        }
+        return send;
+    }
+
+    // Call f(connection, spike) for each connection that generates an event
+    // from a spike in [first, last), in the order of the spikes, then of the
+    // connections.
+    template <typename F>
+    void for_each_event(const spike* first, const spike* last, F&& f) {
+        for (; first!=last; ++first) {
+            const auto& spk = *first;
+            auto r = source_connections(spk.source.gid);
+            for (auto i: util::make_span(r)) {
+                const auto& c = connections_[i];
+                if (c.source().index==spk.source.index) {
+                    f(c, spk);
+                }
+            }
+        }
+    }
+
     cell_size_type num_local_cells_;
     cell_size_type num_local_groups_;
     cell_size_type num_domains_;
@@ -261,9 +543,35 @@ private:
     std::vector<cell_size_type> index_divisions_;
     util::partition_view_type<std::vector<cell_size_type>> index_part_;
 
+    bool source_is_dense_ = true;
+    cell_gid_type source_gid_min_ = 0;
+    std::vector<connection_range> source_dense_;
+    std::unordered_map<cell_gid_type, connection_range> source_sparse_;
+
+    // Routes of local sources to domains for sparse spike exchange.
+    spike_exchange_mode exchange_mode_ = spike_exchange_mode::allgather;
+    std::vector<cell_gid_type> route_gids_;
+    std::vector<unsigned> route_divs_;
+    std::vector<unsigned> route_domains_;
+
+    // Exchange started by start_exchange(), and the number of local spikes
+    // sent with it.
+    spike_exchange_handle pending_exchange_;
+    std::size_t pending_local_spikes_ = 0;
+
+    // Scratch space for make_event_queues(): the write position in each
+    // lane, and the events made by each chunk of spikes for each block of
+    // cells, with their target cell.
+    std::vector<event_lane_store::size_type> lane_cursor_;
+    std::vector<std::vector<std::pair<cell_size_type, spike_event>>> event_buckets_;
+
     distributed_context_handle distributed_;
     task_system_handle thread_pool_;
     std::uint64_t num_spikes_ = 0u;
+
+    // Local spikes exchanged in the sparse mode that are not yet counted in
+    // num_spikes_.
+    std::uint64_t unreduced_local_spikes_ = 0u;
 };
 
 } // namespace arb
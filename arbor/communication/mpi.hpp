@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <iostream>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <mpi.h>
@@ -177,6 +178,168 @@ gathered_vector<T> gather_all_with_partition(const std::vector<T>& values, MPI_C
     );
 }
 
+/// Point-to-point exchange of a partitioned vector
+/// Values in [send_partition[i], send_partition[i+1]) are sent to rank i.
+/// Returns the values received, partitioned by the rank they were sent from.
+template <typename T>
+gathered_vector<T> alltoall_with_partition(const std::vector<T>& values, const std::vector<unsigned>& send_partition, MPI_Comm comm) {
+    using gathered_type = gathered_vector<T>;
+    using count_type = typename gathered_vector<T>::count_type;
+    using traits = mpi_traits<T>;
+
+    const auto nranks = size(comm);
+    arb_assert(send_partition.size()==unsigned(nranks+1));
+
+    // As for gather_all_with_partition, counts and displacements are int
+    // as required by MPI_Alltoallv.
+    std::vector<int> send_counts(nranks), send_displs(nranks);
+    for (auto i=0; i<nranks; ++i) {
+        send_counts[i] = (send_partition[i+1]-send_partition[i])*traits::count();
+        send_displs[i] = send_partition[i]*traits::count();
+    }
+
+    std::vector<int> recv_counts(nranks);
+    MPI_OR_THROW(MPI_Alltoall,
+            send_counts.data(), 1, MPI_INT, // send buffer
+            recv_counts.data(), 1, MPI_INT, // receive buffer
+            comm);
+    auto recv_displs = algorithms::make_index(recv_counts);
+
+    std::vector<T> buffer(recv_displs.back()/traits::count());
+    MPI_OR_THROW(MPI_Alltoallv,
+            // const_cast required for MPI implementations that don't use const* in their interfaces
+            const_cast<T*>(values.data()), send_counts.data(), send_displs.data(), traits::mpi_type(), // send buffer
+            buffer.data(), recv_counts.data(), recv_displs.data(), traits::mpi_type(), // receive buffer
+            comm);
+
+    for (auto& d : recv_displs) {
+        d /= traits::count();
+    }
+
+    return gathered_type(
+        std::move(buffer),
+        std::vector<count_type>(recv_displs.begin(), recv_displs.end())
+    );
+}
+
+/// Nonblocking collective on a partitioned vector, started by
+/// igather_all_with_partition or ialltoall_with_partition.
+/// The counts are exchanged when the collective is started; the values
+/// are exchanged asynchronously, and received when wait() is called.
+template <typename T>
+class partitioned_request {
+public:
+    using gathered_type = gathered_vector<T>;
+    using count_type = typename gathered_vector<T>::count_type;
+    using traits = mpi_traits<T>;
+
+    partitioned_request() = default;
+    partitioned_request(partitioned_request&& other) { *this = std::move(other); }
+
+    partitioned_request& operator=(partitioned_request&& other) {
+        std::swap(send_, other.send_);
+        std::swap(send_counts_, other.send_counts_);
+        std::swap(send_displs_, other.send_displs_);
+        std::swap(buffer_, other.buffer_);
+        std::swap(recv_counts_, other.recv_counts_);
+        std::swap(recv_displs_, other.recv_displs_);
+        std::swap(request_, other.request_);
+        return *this;
+    }
+
+    // A request must be completed before the buffers can be released.
+    ~partitioned_request() {
+        if (request_!=MPI_REQUEST_NULL) {
+            MPI_Wait(&request_, MPI_STATUS_IGNORE);
+        }
+    }
+
+    gathered_type wait() {
+        MPI_OR_THROW(MPI_Wait, &request_, MPI_STATUS_IGNORE);
+
+        for (auto& d : recv_displs_) {
+            d /= traits::count();
+        }
+        return gathered_type(
+            std::move(buffer_),
+            std::vector<count_type>(recv_displs_.begin(), recv_displs_.end())
+        );
+    }
+
+private:
+    template <typename U>
+    friend partitioned_request<U> igather_all_with_partition(const std::vector<U>&, MPI_Comm);
+
+    template <typename U>
+    friend partitioned_request<U> ialltoall_with_partition(const std::vector<U>&, const std::vector<unsigned>&, MPI_Comm);
+
+    // The send and receive buffers, counts and displacements must remain
+    // valid until the request has completed; moving the vectors does not
+    // move their storage.
+    std::vector<T> send_;
+    std::vector<int> send_counts_;
+    std::vector<int> send_displs_;
+    std::vector<T> buffer_;
+    std::vector<int> recv_counts_;
+    std::vector<int> recv_displs_;
+    MPI_Request request_ = MPI_REQUEST_NULL;
+};
+
+/// Start a nonblocking gather_all_with_partition.
+template <typename T>
+partitioned_request<T> igather_all_with_partition(const std::vector<T>& values, MPI_Comm comm) {
+    using traits = mpi_traits<T>;
+
+    partitioned_request<T> r;
+    r.send_ = values;
+    r.recv_counts_ = gather_all(int(values.size()), comm);
+    for (auto& c : r.recv_counts_) {
+        c *= traits::count();
+    }
+    r.recv_displs_ = algorithms::make_index(r.recv_counts_);
+    r.buffer_.resize(r.recv_displs_.back()/traits::count());
+
+    MPI_OR_THROW(MPI_Iallgatherv,
+            r.send_.data(), r.recv_counts_[rank(comm)], traits::mpi_type(), // send buffer
+            r.buffer_.data(), r.recv_counts_.data(), r.recv_displs_.data(), traits::mpi_type(), // receive buffer
+            comm, &r.request_);
+
+    return r;
+}
+
+/// Start a nonblocking alltoall_with_partition.
+template <typename T>
+partitioned_request<T> ialltoall_with_partition(const std::vector<T>& values, const std::vector<unsigned>& send_partition, MPI_Comm comm) {
+    using traits = mpi_traits<T>;
+
+    const auto nranks = size(comm);
+    arb_assert(send_partition.size()==unsigned(nranks+1));
+
+    partitioned_request<T> r;
+    r.send_ = values;
+    r.send_counts_.resize(nranks);
+    r.send_displs_.resize(nranks);
+    for (auto i=0; i<nranks; ++i) {
+        r.send_counts_[i] = (send_partition[i+1]-send_partition[i])*traits::count();
+        r.send_displs_[i] = send_partition[i]*traits::count();
+    }
+
+    r.recv_counts_.resize(nranks);
+    MPI_OR_THROW(MPI_Alltoall,
+            r.send_counts_.data(), 1, MPI_INT, // send buffer
+            r.recv_counts_.data(), 1, MPI_INT, // receive buffer
+            comm);
+    r.recv_displs_ = algorithms::make_index(r.recv_counts_);
+    r.buffer_.resize(r.recv_displs_.back()/traits::count());
+
+    MPI_OR_THROW(MPI_Ialltoallv,
+            r.send_.data(), r.send_counts_.data(), r.send_displs_.data(), traits::mpi_type(), // send buffer
+            r.buffer_.data(), r.recv_counts_.data(), r.recv_displs_.data(), traits::mpi_type(), // receive buffer
+            comm, &r.request_);
+
+    return r;
+}
+
 template <typename T>
 T reduce(T value, MPI_Op op, int root, MPI_Comm comm) {
     using traits = mpi_traits<T>;
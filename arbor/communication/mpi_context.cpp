@@ -5,7 +5,9 @@
 #error "build only if MPI is enabled"
 #endif
 
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <mpi.h>
@@ -14,9 +16,25 @@
 #include <arbor/spike.hpp>
 
 #include "communication/mpi.hpp"
+#include "communication/spike_codec.hpp"
 
 namespace arb {
 
+// Spike exchange started with a nonblocking MPI collective.
+struct mpi_spike_request: spike_exchange_handle::request {
+    explicit mpi_spike_request(mpi::partitioned_request<char> r):
+        pending(std::move(r))
+    {}
+
+    gathered_vector<arb::spike> complete() override {
+        return spike_codec::decode(pending.wait());
+    }
+
+    mpi::partitioned_request<char> pending;
+};
+
+// Spikes are exchanged in the packed encoding of spike_codec.
+//
 // Throws arb::mpi::mpi_error if MPI calls fail.
 struct mpi_context_impl {
     int size_;
@@ -30,7 +48,34 @@ struct mpi_context_impl {
 
     gathered_vector<arb::spike>
     gather_spikes(const std::vector<arb::spike>& local_spikes) const {
-        return mpi::gather_all_with_partition(local_spikes, comm_);
+        auto bytes = spike_codec::encode(local_spikes);
+        return spike_codec::decode(mpi::gather_all_with_partition(bytes, comm_));
+    }
+
+    gathered_vector<arb::spike>
+    exchange_spikes(const std::vector<arb::spike>& local_spikes, const std::vector<unsigned>& send_partition) const {
+        std::vector<unsigned> byte_partition;
+        auto bytes = spike_codec::encode(local_spikes, send_partition, byte_partition);
+        return spike_codec::decode(mpi::alltoall_with_partition(bytes, byte_partition, comm_));
+    }
+
+    gathered_vector<cell_gid_type>
+    exchange_gids(const std::vector<cell_gid_type>& local_gids, const std::vector<unsigned>& send_partition) const {
+        return mpi::alltoall_with_partition(local_gids, send_partition, comm_);
+    }
+
+    spike_exchange_handle
+    start_gather_spikes(const std::vector<arb::spike>& local_spikes) const {
+        return spike_exchange_handle(std::unique_ptr<spike_exchange_handle::request>(
+            new mpi_spike_request(mpi::igather_all_with_partition(spike_codec::encode(local_spikes), comm_))));
+    }
+
+    spike_exchange_handle
+    start_exchange_spikes(const std::vector<arb::spike>& local_spikes, const std::vector<unsigned>& send_partition) const {
+        std::vector<unsigned> byte_partition;
+        auto bytes = spike_codec::encode(local_spikes, send_partition, byte_partition);
+        return spike_exchange_handle(std::unique_ptr<spike_exchange_handle::request>(
+            new mpi_spike_request(mpi::ialltoall_with_partition(bytes, byte_partition, comm_))));
     }
 
     std::string name() const { return "MPI"; }
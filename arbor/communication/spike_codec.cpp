@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <arbor/assert.hpp>
+#include <arbor/common_types.hpp>
+#include <arbor/communication/gathered_vector.hpp>
+#include <arbor/spike.hpp>
+
+#include "communication/spike_codec.hpp"
+#include "util/span.hpp"
+
+namespace arb {
+namespace spike_codec {
+
+namespace {
+
+using key_type = std::uint32_t;
+static_assert(sizeof(time_type)==sizeof(key_type), "time key must have the size of time_type");
+
+// Map the bit pattern of a time to an unsigned integer with the same order:
+// set the sign bit of non-negative values, and flip all bits of negative
+// values.
+key_type time_key(time_type t) {
+    key_type k;
+    std::memcpy(&k, &t, sizeof(k));
+    return (k>>31)? ~k: k|0x80000000u;
+}
+
+time_type key_time(key_type k) {
+    k = (k>>31)? k&0x7fffffffu: ~k;
+    time_type t;
+    std::memcpy(&t, &k, sizeof(t));
+    return t;
+}
+
+void put_varint(std::uint64_t x, byte_vector& out) {
+    while (x>=0x80) {
+        out.push_back(char((x&0x7f)|0x80));
+        x >>= 7;
+    }
+    out.push_back(char(x));
+}
+
+std::uint64_t get_varint(const char*& p) {
+    std::uint64_t x = 0;
+    unsigned shift = 0;
+    unsigned char b;
+    do {
+        b = *p++;
+        x |= std::uint64_t(b&0x7f)<<shift;
+        shift += 7;
+    } while (b&0x80);
+    return x;
+}
+
+std::uint64_t zigzag(std::int64_t x) {
+    return (std::uint64_t(x)<<1)^std::uint64_t(x>>63);
+}
+
+std::int64_t unzigzag(std::uint64_t x) {
+    return std::int64_t(x>>1)^-std::int64_t(x&1);
+}
+
+} // anonymous namespace
+
+void encode(const spike* begin, const spike* end, byte_vector& out) {
+    if (begin==end) return;
+
+    key_type kmin = time_key(begin->time);
+    for (auto s = begin; s!=end; ++s) {
+        kmin = std::min(kmin, time_key(s->time));
+    }
+
+    put_varint(end-begin, out);
+    put_varint(kmin, out);
+
+    std::int64_t gid = 0;
+    for (auto s = begin; s!=end; ++s) {
+        put_varint(zigzag(std::int64_t(s->source.gid)-gid), out);
+        put_varint(s->source.index, out);
+        put_varint(time_key(s->time)-kmin, out);
+        gid = s->source.gid;
+    }
+}
+
+byte_vector encode(const std::vector<spike>& spikes) {
+    byte_vector out;
+    out.reserve(5*spikes.size()+10);
+    encode(spikes.data(), spikes.data()+spikes.size(), out);
+    return out;
+}
+
+byte_vector encode(const std::vector<spike>& spikes,
+                   const std::vector<unsigned>& partition,
+                   std::vector<unsigned>& byte_partition)
+{
+    byte_vector out;
+    out.reserve(5*spikes.size()+10*partition.size());
+
+    byte_partition.assign(1, 0u);
+    for (auto i: util::make_span(partition.size()-1)) {
+        encode(spikes.data()+partition[i], spikes.data()+partition[i+1], out);
+        byte_partition.push_back(out.size());
+    }
+    return out;
+}
+
+gathered_vector<spike> decode(const gathered_vector<char>& bytes) {
+    using count_type = gathered_vector<spike>::count_type;
+
+    const auto& bp = bytes.partition();
+    const char* data = bytes.values().data();
+    const auto n = bp.size()-1;
+
+    // Read the number of spikes in each batch from its header, so that the
+    // spikes can be decoded in place.
+    std::vector<count_type> partition(n+1, 0u);
+    for (auto i: util::make_span(n)) {
+        const char* p = data+bp[i];
+        partition[i+1] = partition[i] + (bp[i]==bp[i+1]? 0: get_varint(p));
+    }
+
+    std::vector<spike> spikes(partition.back());
+    for (auto i: util::make_span(n)) {
+        if (bp[i]==bp[i+1]) continue;
+
+        const char* p = data+bp[i];
+        get_varint(p);
+        const auto kmin = key_type(get_varint(p));
+
+        std::int64_t gid = 0;
+        for (auto j: util::make_span(partition[i], partition[i+1])) {
+            auto& s = spikes[j];
+            gid += unzigzag(get_varint(p));
+            s.source.gid = cell_gid_type(gid);
+            s.source.index = cell_lid_type(get_varint(p));
+            s.time = key_time(key_type(kmin+get_varint(p)));
+        }
+        arb_assert(p==data+bp[i+1]);
+    }
+
+    return gathered_vector<spike>(std::move(spikes), std::move(partition));
+}
+
+} // namespace spike_codec
+} // namespace arb
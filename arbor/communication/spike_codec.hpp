@@ -0,0 +1,49 @@
+#pragma once
+
+// Packed encoding of spikes for exchange between domains.
+//
+// A batch of spikes is encoded as a header followed by one record per spike,
+// each field an unsigned LEB128 varint:
+//
+//     header: number of spikes, minimum time key in the batch
+//     record: zigzag(gid - previous gid), source index, time key - minimum
+//
+// The time key of a spike is the bit pattern of its time, reordered so that
+// keys compare as the times do (see time_key). The time offsets are thus a
+// fixed-point representation of the time relative to the start of the batch
+// with the precision of the time itself, and the encoding is lossless. As the
+// spikes exchanged together are generated in one integration interval, the
+// offsets are small.
+//
+// With spikes sorted by source, as they are by the communicator, a record is
+// typically four or five bytes, against twelve for arb::spike.
+//
+// An empty batch is encoded as no bytes.
+
+#include <vector>
+
+#include <arbor/communication/gathered_vector.hpp>
+#include <arbor/spike.hpp>
+
+namespace arb {
+namespace spike_codec {
+
+using byte_vector = std::vector<char>;
+
+// Append the encoding of the spikes in [begin, end) to out.
+void encode(const spike* begin, const spike* end, byte_vector& out);
+
+byte_vector encode(const std::vector<spike>& spikes);
+
+// Encode each part [partition[i], partition[i+1]) of the spikes as a separate
+// batch; byte_partition is set to the partition of the result by batch.
+byte_vector encode(const std::vector<spike>& spikes,
+                   const std::vector<unsigned>& partition,
+                   std::vector<unsigned>& byte_partition);
+
+// Decode the batches received from each domain, retaining the partition of
+// the spikes by domain.
+gathered_vector<spike> decode(const gathered_vector<char>& bytes);
+
+} // namespace spike_codec
+} // namespace arb
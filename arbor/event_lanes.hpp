@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include <arbor/assert.hpp>
+#include <arbor/spike_event.hpp>
+
+#include "util/range.hpp"
+
+namespace arb {
+
+using event_span = util::range<const spike_event*>;
+
+/// A contiguous range of lanes in an event_lane_store: lane i is the sorted
+/// sequence of events to be delivered to the ith cell of the range.
+///
+/// A default constructed subrange has no lanes.
+class event_lane_subrange {
+public:
+    using size_type = std::size_t;
+
+    event_lane_subrange() = default;
+
+    event_lane_subrange(const spike_event* events, const size_type* divs, size_type n):
+        events_(events), divs_(divs), size_(n)
+    {}
+
+    size_type size() const { return size_; }
+    bool empty() const { return size_==0; }
+
+    event_span operator[](size_type i) const {
+        arb_assert(i<size_);
+        return {events_+divs_[i], events_+divs_[i+1]};
+    }
+
+private:
+    const spike_event* events_ = nullptr;
+    const size_type* divs_ = nullptr;
+    size_type size_ = 0;
+};
+
+/// The event lanes of all local cells, stored in compressed row format: the
+/// events of all lanes are kept in a single buffer, and the events of lane i
+/// are those in [divs[i], divs[i+1]).
+///
+/// The store is filled in two passes: after clear(), the number of events in
+/// each lane is counted with add_count(), then allocate() computes the lane
+/// offsets and sizes the buffer, after which the events of each lane are
+/// written to lane(i). Distinct lanes can be filled concurrently in both
+/// passes.
+///
+/// The buffer keeps its capacity between fills, so that in a simulation with
+/// a steady volume of events the lanes are not reallocated.
+class event_lane_store {
+public:
+    using size_type = event_lane_subrange::size_type;
+
+    event_lane_store() = default;
+    explicit event_lane_store(size_type n_lanes): divs_(n_lanes+1, 0) {}
+
+    /// Number of lanes.
+    size_type size() const { return divs_.empty()? 0: divs_.size()-1; }
+
+    /// Total number of events in all lanes.
+    size_type num_events() const { return events_.size(); }
+
+    event_span operator[](size_type i) const {
+        arb_assert(i<size());
+        return {events_.data()+divs_[i], events_.data()+divs_[i+1]};
+    }
+
+    /// Mutable view of the events in lane i, e.g. for sorting the lane
+    /// in place.
+    util::range<spike_event*> lane(size_type i) {
+        arb_assert(i<size());
+        return {events_.data()+divs_[i], events_.data()+divs_[i+1]};
+    }
+
+    /// View of the lanes in [first, last).
+    event_lane_subrange subrange(size_type first, size_type last) const {
+        arb_assert(first<=last && last<=size());
+        return event_lane_subrange(events_.data(), divs_.data()+first, last-first);
+    }
+
+    /// Add n to the number of events in lane i, before a call to allocate().
+    void add_count(size_type i, size_type n) {
+        divs_[i+1] += n;
+    }
+
+    /// Compute the lane offsets from the counts set with add_count(), and
+    /// size the buffer to hold all of the events.
+    void allocate() {
+        for (size_type i = 1; i<divs_.size(); ++i) {
+            divs_[i] += divs_[i-1];
+        }
+        events_.resize(divs_.empty()? 0: divs_.back());
+    }
+
+    /// Offset of lane i in the buffer, for i ≤ size().
+    size_type offset(size_type i) const {
+        return divs_[i];
+    }
+
+    spike_event* data() { return events_.data(); }
+    const spike_event* data() const { return events_.data(); }
+
+    /// Remove all events, leaving every lane empty with a count of zero.
+    void clear() {
+        std::fill(divs_.begin(), divs_.end(), 0);
+        events_.clear();
+    }
+
+private:
+    std::vector<spike_event> events_;
+    std::vector<size_type> divs_;
+};
+
+} // namespace arb
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <arbor/spike_event.hpp>
+
+#include "event_sort.hpp"
+
+namespace arb {
+
+void bucket_sort_events(event_range events, event_sort_buffer& buffer) {
+    const auto n = events.size();
+    if (n<2) return;
+
+    // Find the time window of the events, and whether they are already
+    // sorted, as is the case when they were generated by one spike.
+    double tmin = events[0].time;
+    double tmax = tmin;
+    bool sorted = true;
+    for (std::size_t i = 1; i<n; ++i) {
+        const double t = events[i].time;
+        tmin = std::min(tmin, t);
+        tmax = std::max(tmax, t);
+        sorted = sorted && !(events[i]<events[i-1]);
+    }
+    if (sorted) return;
+
+    if (!(tmax>tmin) || !std::isfinite(tmax-tmin)) {
+        std::sort(events.begin(), events.end());
+        return;
+    }
+
+    // One bucket per event, the last of which holds the events at tmax.
+    const unsigned nb = n;
+    const double scale = (nb-1)/(tmax-tmin);
+    auto bucket = [&](const spike_event& e) {
+        return std::min(nb-1, unsigned((e.time-tmin)*scale));
+    };
+
+    auto& divs = buffer.divs;
+    divs.assign(nb+1, 0);
+    for (auto& e: events) {
+        ++divs[bucket(e)+1];
+    }
+    for (unsigned b = 1; b<=nb; ++b) {
+        divs[b] += divs[b-1];
+    }
+
+    // Scatter the events into the buckets, after which divs[b] is the end
+    // of bucket b, and the start of bucket b+1.
+    auto& buf = buffer.events;
+    buf.resize(n);
+    for (auto& e: events) {
+        buf[divs[bucket(e)]++] = e;
+    }
+
+    // The buckets are ordered by time, so only events within a bucket
+    // need to be compared.
+    unsigned b0 = 0;
+    for (unsigned b = 0; b<nb; ++b) {
+        const unsigned b1 = divs[b];
+        if (b1-b0>1) {
+            std::sort(buf.begin()+b0, buf.begin()+b1);
+        }
+        b0 = b1;
+    }
+
+    std::copy(buf.begin(), buf.end(), events.begin());
+}
+
+void event_sorter::sort(event_range events) {
+    if (events.size()<bucket_sort_min_events) {
+        std::sort(events.begin(), events.end());
+    }
+    else {
+        bucket_sort_events(events, buffers_.local());
+    }
+}
+
+} // namespace arb
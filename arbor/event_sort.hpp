@@ -0,0 +1,53 @@
+#pragma once
+
+// Sorting of the pending events of a cell before they are merged into its
+// event lane.
+//
+// The pending events of a cell are generated by the spikes of one
+// integration interval, so their delivery times fall in a window a few
+// minimum delays wide, and they are close to uniformly distributed in the
+// window. They are sorted with a bucket sort on the delivery time, with
+// about one bucket per event, followed by a comparison sort of each bucket;
+// small lanes, and lanes whose events all have the same time, are sorted
+// with a comparison sort alone.
+//
+// The result is the same as that of std::sort with spike_event::operator<.
+
+#include <cstddef>
+#include <vector>
+
+#include <arbor/execution_context.hpp>
+#include <arbor/spike_event.hpp>
+
+#include "threading/threading.hpp"
+#include "util/range.hpp"
+
+namespace arb {
+
+using event_range = util::range<spike_event*>;
+
+// Scratch space for bucket_sort_events().
+struct event_sort_buffer {
+    std::vector<spike_event> events;
+    std::vector<unsigned> divs;
+};
+
+// Sort events with a bucket sort on time, using buffer as scratch space.
+void bucket_sort_events(event_range events, event_sort_buffer& buffer);
+
+class event_sorter {
+public:
+    // Lanes with fewer events are sorted with a comparison sort.
+    static constexpr std::size_t bucket_sort_min_events = 64;
+
+    explicit event_sorter(const task_system_handle& ts): buffers_(ts) {}
+
+    // Sort events in place. May be called concurrently by the tasks of
+    // the task system, each of which uses its own scratch space.
+    void sort(event_range events);
+
+private:
+    threading::enumerable_thread_specific<event_sort_buffer> buffers_;
+};
+
+} // namespace arb
@@ -1,15 +1,15 @@
+#include <algorithm>
 #include <set>
 #include <stdexcept>
+#include <string>
 #include <unordered_set>
 #include <vector>
 
 #include <arbor/arbexcept.hpp>
 #include <arbor/mc_cell.hpp>
 
-#include "algorithms.hpp"
 #include "fvm_compartment.hpp"
 #include "fvm_layout.hpp"
-#include "tree.hpp"
 #include "util/maputil.hpp"
 #include "util/meta.hpp"
 #include "util/partition.hpp"
@@ -27,25 +27,52 @@ using util::value_by_key;
 // Convenience routines
 
 namespace {
-    template <typename ResizableContainer, typename Index>
-    void extend_to(ResizableContainer& c, const Index& i) {
-        if (util::size(c)<=i) {
-            c.resize(i+1);
+    // Order in which the CVs of the segments of a cell are numbered.
+    std::vector<fvm_size_type> segment_order(const mc_cell& c, cv_ordering ordering) {
+        using size_type = fvm_size_type;
+
+        const size_type nseg = c.num_segments();
+        std::vector<size_type> order;
+        order.reserve(nseg);
+
+        if (ordering==cv_ordering::segment) {
+            util::assign(order, make_span(0, nseg));
+            return order;
         }
-    }
 
-    struct compartment_model {
-        arb::tree tree;
-        std::vector<tree::int_type> parent_index;
-        std::vector<tree::int_type> segment_index;
+        // Depth-first order: segment indices are not necessarily in any
+        // particular relation to the topology of the cell.
+
+        std::vector<std::vector<std::string>> mech_names(nseg);
+        std::vector<std::vector<size_type>> children(nseg);
+        for (auto i: make_span(0, nseg)) {
+            util::assign(mech_names[i], transform_view(c.segment(i)->mechanisms(),
+                [](const mechanism_desc& m) { return m.name(); }));
+            util::sort(mech_names[i]);
+            if (i>0) {
+                children[c.parents()[i]].push_back(i);
+            }
+        }
 
-        explicit compartment_model(const mc_cell& cell) {
-            tree = arb::tree(cell.parents());
-            auto counts = cell.compartment_counts();
-            parent_index = make_parent_index(tree, counts);
-            segment_index = algorithms::make_index(counts);
+        std::vector<size_type> stack = {0};
+        while (!stack.empty()) {
+            size_type i = stack.back();
+            stack.pop_back();
+            order.push_back(i);
+
+            // Children with the same mechanisms as i are visited first; the
+            // stack holds them in reverse.
+            auto& kids = children[i];
+            std::stable_sort(kids.begin(), kids.end(),
+                [&](size_type a, size_type b) {
+                    bool a_same = mech_names[a]==mech_names[i];
+                    bool b_same = mech_names[b]==mech_names[i];
+                    return a_same!=b_same? a_same: mech_names[a]<mech_names[b];
+                });
+            stack.insert(stack.end(), kids.rbegin(), kids.rend());
         }
-    };
+        return order;
+    }
 } // namespace
 
 // Cable segment discretization
@@ -110,7 +137,7 @@ namespace {
 //       = 1/R · hV₁V₂/(h₂²V₁+h₁²V₂)
 //
 
-fvm_discretization fvm_discretize(const std::vector<mc_cell>& cells) {
+fvm_discretization fvm_discretize(const std::vector<mc_cell>& cells, cv_ordering ordering) {
     using value_type = fvm_value_type;
     using index_type = fvm_index_type;
     using size_type = fvm_size_type;
@@ -136,25 +163,15 @@ fvm_discretization fvm_discretize(const std::vector<mc_cell>& cells) {
         util::fill(subrange_view(D.cv_to_cell, cell_comp_part[i]), static_cast<index_type>(i));
     }
 
-    std::vector<size_type> seg_comp_bounds;
+    // Compartment index range for each segment in a cell.
+    std::vector<std::pair<size_type, size_type>> seg_comp_part;
+
     for (auto i: make_span(0, D.ncell)) {
         const auto& c = cells[i];
-        compartment_model cell_graph (c);
         auto cell_comp_ival = cell_comp_part[i];
-
         auto cell_comp_base = cell_comp_ival.first;
-        for (auto k: make_span(cell_comp_ival)) {
-            D.parent_cv[k] = cell_graph.parent_index[k-cell_comp_base]+cell_comp_base;
-        }
 
-        // Compartment index range for each segment in this cell.
-        seg_comp_bounds.clear();
-        auto seg_comp_part = make_partition(
-            seg_comp_bounds,
-            transform_view(c.segments(), [](const mc_segment_ptr& s) { return s->num_compartments(); }),
-            cell_comp_base);
-
-        const auto nseg = seg_comp_part.size();
+        const auto nseg = c.num_segments();
         if (nseg==0) {
             throw arbor_internal_error("fvm_layout: cannot discretrize cell with no segments");
         }
@@ -168,6 +185,23 @@ fvm_discretization fvm_discretize(const std::vector<mc_cell>& cells) {
             throw arbor_internal_error("fvm_layout: soma must have exactly one compartment");
         }
 
+        // Number the compartments of each segment consecutively, with the
+        // segments taken in the given order; the parent of the first
+        // compartment of a segment is the last compartment of its parent
+        // segment.
+        seg_comp_part.resize(nseg);
+        size_type comp = cell_comp_base;
+        for (auto j: segment_order(c, ordering)) {
+            auto n = c.segment(j)->num_compartments();
+            seg_comp_part[j] = {comp, comp+n};
+
+            D.parent_cv[comp] = j? seg_comp_part[c.parents()[j]].second-1: comp;
+            for (auto k: make_span(comp+1, comp+n)) {
+                D.parent_cv[k] = k-1;
+            }
+            comp += n;
+        }
+
         segment_info soma_info;
 
         size_type soma_cv = cell_comp_base;
@@ -252,7 +286,6 @@ fvm_discretization fvm_discretize(const std::vector<mc_cell>& cells) {
 fvm_mechanism_data fvm_build_mechanism_data(const mechanism_catalogue& catalogue, const std::vector<mc_cell>& cells, const fvm_discretization& D) {
     using util::assign;
     using util::sort_by;
-    using util::optional;
 
     using value_type = fvm_value_type;
     using index_type = fvm_index_type;
@@ -394,25 +427,19 @@ fvm_mechanism_data fvm_build_mechanism_data(const mechanism_catalogue& catalogue
     for (auto& ionseg: ion_segments) {
         auto& ion = mechdata.ions[ionseg.first];
 
+        // As for density mechanisms below, ion CVs are kept in increasing order.
         for (size_type segment: ionseg.second) {
             const segment_info& seg_info = D.segments[segment];
-
             if (seg_info.has_parent()) {
-                index_type cv = seg_info.parent_cv;
-                optional<std::size_t> parent_idx = util::binary_search_index(ion.cv, cv);
-                if (!parent_idx) {
-                    ion.cv.push_back(cv);
-                    ion.iconc_norm_area.push_back(D.cv_area[cv]);
-                    ion.econc_norm_area.push_back(D.cv_area[cv]);
-                }
-            }
-
-            for (auto cv: make_span(seg_info.cv_range())) {
-                ion.cv.push_back(cv);
-                ion.iconc_norm_area.push_back(D.cv_area[cv]);
-                ion.econc_norm_area.push_back(D.cv_area[cv]);
+                ion.cv.push_back(seg_info.parent_cv);
             }
+            util::append(ion.cv, make_span(seg_info.cv_range()));
         }
+        util::sort(ion.cv);
+        ion.cv.erase(std::unique(ion.cv.begin(), ion.cv.end()), ion.cv.end());
+
+        assign(ion.iconc_norm_area, transform_view(ion.cv, [&D](index_type cv) { return D.cv_area[cv]; }));
+        ion.econc_norm_area = ion.iconc_norm_area;
     }
 
     // IIb. Density mechanism CVs, parameters and ionic default concentration contributions.
@@ -454,10 +481,7 @@ fvm_mechanism_data fvm_build_mechanism_data(const mechanism_catalogue& catalogue
                 int pidx = param_index.at(kv.first);
                 value_type v = kv.second;
 
-                extend_to(param_area_contrib[pidx], index);
                 param_area_contrib[pidx][index] += area;
-
-                extend_to(param_value[pidx], index);
                 param_value[pidx][index] += area*v;
             }
 
@@ -472,31 +496,48 @@ fvm_mechanism_data fvm_build_mechanism_data(const mechanism_catalogue& catalogue
                 }
             }
 
-            extend_to(config.norm_area, index);
             config.norm_area[index] += area;
         };
 
+        // Lay out the mechanism instances in increasing CV order, so that runs
+        // of consecutive CVs map to runs of consecutive instances: the SIMD
+        // chunks of such runs can then use direct vector loads and stores
+        // in the multicore back end (see multicore/partition_by_constraint.hpp).
+        // The parent CV of a segment need not follow the CVs of the segments
+        // preceding it, and is shared by sibling segments.
+
+        for (auto& seg_entry: entry.second.segments) {
+            const segment_info& seg_info = D.segments[seg_entry.first];
+            if (seg_info.has_parent()) {
+                config.cv.push_back(seg_info.parent_cv);
+            }
+            util::append(config.cv, make_span(seg_info.cv_range()));
+        }
+        util::sort(config.cv);
+        config.cv.erase(std::unique(config.cv.begin(), config.cv.end()), config.cv.end());
+
+        for (auto pidx: make_span(0, nparam)) {
+            param_value[pidx].assign(config.cv.size(), 0);
+            param_area_contrib[pidx].assign(config.cv.size(), 0);
+        }
+        config.norm_area.assign(config.cv.size(), 0);
+
+        auto cv_index = [&config](index_type cv) -> size_type {
+            return util::binary_search_index(config.cv, cv).value();
+        };
+
         for (auto& seg_entry: entry.second.segments) {
             const segment_info& seg_info = D.segments[seg_entry.first];
             const mechanism_desc& mech_desc = *seg_entry.second;
 
             if (seg_info.has_parent()) {
                 index_type cv = seg_info.parent_cv;
-                optional<std::size_t> parent_idx = util::binary_search_index(config.cv, cv);
-                if (!parent_idx) {
-                    parent_idx = config.cv.size();
-                    config.cv.push_back(cv);
-                }
-
-                accumulate_mech_data(*parent_idx, cv, seg_info.parent_cv_area, mech_desc);
+                accumulate_mech_data(cv_index(cv), cv, seg_info.parent_cv_area, mech_desc);
             }
 
             for (auto cv: make_span(seg_info.cv_range())) {
-                size_type idx = config.cv.size();
-                config.cv.push_back(cv);
-
                 value_type area = cv==seg_info.distal_cv? seg_info.distal_cv_area: D.cv_area[cv];
-                accumulate_mech_data(idx, cv, area, mech_desc);
+                accumulate_mech_data(cv_index(cv), cv, area, mech_desc);
             }
         }
 
@@ -587,7 +628,7 @@ fvm_mechanism_data fvm_build_mechanism_data(const mechanism_catalogue& catalogue
         sort_by(stimuli, stim_cv_field);
         assign(stim_config.cv, transform_view(stimuli, stim_cv_field));
 
-        stim_config.param_values.resize(3);
+        stim_config.param_values.resize(5);
 
         stim_config.param_values[0].first = "delay";
         assign(stim_config.param_values[0].second,
@@ -600,6 +641,14 @@ fvm_mechanism_data fvm_build_mechanism_data(const mechanism_catalogue& catalogue
         stim_config.param_values[2].first = "amplitude";
         assign(stim_config.param_values[2].second,
             transform_view(stimuli, [](cv_clamp p) { return p.second.amplitude; }));
+
+        stim_config.param_values[3].first = "frequency";
+        assign(stim_config.param_values[3].second,
+            transform_view(stimuli, [](cv_clamp p) { return p.second.frequency; }));
+
+        stim_config.param_values[4].first = "phase";
+        assign(stim_config.param_values[4].second,
+            transform_view(stimuli, [](cv_clamp p) { return p.second.phase; }));
     }
 
     return mechdata;
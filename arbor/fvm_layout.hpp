@@ -86,7 +86,7 @@ struct fvm_discretization {
     }
 };
 
-fvm_discretization fvm_discretize(const std::vector<mc_cell>& cells);
+fvm_discretization fvm_discretize(const std::vector<mc_cell>& cells, cv_ordering ordering = cv_ordering::segment);
 
 
 // Post-discretization data for point and density mechanism instantiation.
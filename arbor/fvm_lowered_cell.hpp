@@ -32,11 +32,15 @@ struct fvm_lowered_cell {
         std::vector<target_handle>& target_handles,
         probe_association_map<probe_handle>& probe_map) = 0;
 
+    // Set the probe handles sampled by the sample events given to
+    // integrate(): the sampling plan persists until it is next set.
+    virtual void set_sampling_plan(const std::vector<probe_handle>& handles) = 0;
+
     virtual fvm_integration_result integrate(
         fvm_value_type tfinal,
         fvm_value_type max_dt,
-        std::vector<deliverable_event> staged_events,
-        std::vector<sample_event> staged_samples) = 0;
+        const std::vector<deliverable_event>& staged_events,
+        const std::vector<sample_event>& staged_samples) = 0;
 
     virtual fvm_value_type time() const = 0;
 
@@ -7,6 +7,7 @@
 // implementation details may be tested in the unit tests.
 // It should otherwise only be used in `fvm_lowered_cell.cpp`.
 
+#include <algorithm>
 #include <cmath>
 #include <iterator>
 #include <memory>
@@ -53,11 +54,15 @@ public:
         std::vector<target_handle>& target_handles,
         probe_association_map<probe_handle>& probe_map) override;
 
+    void set_sampling_plan(const std::vector<probe_handle>& handles) override {
+        state_->set_sample_handles(handles);
+    }
+
     fvm_integration_result integrate(
         value_type tfinal,
         value_type max_dt,
-        std::vector<deliverable_event> staged_events,
-        std::vector<sample_event> staged_samples) override;
+        const std::vector<deliverable_event>& staged_events,
+        const std::vector<sample_event>& staged_samples) override;
 
     value_type time() const override { return tmin_; }
 
@@ -78,7 +83,14 @@ private:
     std::unique_ptr<shared_state> state_; // Cell state shared across mechanisms.
 
     // TODO: Can we move the backend-dependent data structures below into state_?
+    // Samples with the exact policy are kept in their own stream, as the
+    // integration steps are shortened to end at their sample times.
     sample_event_stream sample_events_;
+    sample_event_stream exact_sample_events_;
+
+    // Buffers for the sample events of each stream, reused across epochs.
+    std::vector<sample_event> staged_samples_;
+    std::vector<sample_event> staged_exact_samples_;
     array sample_time_;
     array sample_value_;
     matrix<backend> matrix_;
@@ -89,6 +101,15 @@ private:
     value_type temperature_ = NAN;
     std::vector<mechanism_ptr> mechanisms_;
 
+    // Mechanisms whose state update and current computation are fused, and
+    // the remainder, which are integrated with nrn_state() and nrn_current().
+    std::vector<mechanism*> fused_mechanisms_;
+    std::vector<mechanism*> unfused_mechanisms_;
+
+    // True if the fused mechanisms have already added their current
+    // contributions for the next integration step.
+    bool fused_currents_ = false;
+
     // Non-physical voltage check threshold, 0 => no check.
     value_type check_voltage_mV = 0;
 
@@ -134,6 +155,7 @@ void fvm_lowered_cell_impl<Backend>::reset() {
     for (auto& m: mechanisms_) {
         m->nrn_init();
     }
+    fused_currents_ = false;
 
     update_ion_state();
 
@@ -146,8 +168,8 @@ template <typename Backend>
 fvm_integration_result fvm_lowered_cell_impl<Backend>::integrate(
     value_type tfinal,
     value_type dt_max,
-    std::vector<deliverable_event> staged_events,
-    std::vector<sample_event> staged_samples)
+    const std::vector<deliverable_event>& staged_events,
+    const std::vector<sample_event>& staged_samples)
 {
     using util::as_const;
 
@@ -155,14 +177,23 @@ fvm_integration_result fvm_lowered_cell_impl<Backend>::integrate(
     PE(advance_integrate_setup);
     threshold_watcher_.clear_crossings();
 
-    auto n_samples = staged_samples.size();
+    // Each sample event takes one sample of each probe handle in its range.
+    auto n_samples = util::sum_by(staged_samples, [](const sample_event& ev) { return ev.raw.end-ev.raw.begin; });
     if (sample_time_.size() < n_samples) {
         sample_time_ = array(n_samples);
         sample_value_ = array(n_samples);
     }
 
-    state_->deliverable_events.init(std::move(staged_events));
-    sample_events_.init(std::move(staged_samples));
+    // Split the staged samples by policy, which keeps each part grouped by cell.
+    staged_samples_.clear();
+    staged_exact_samples_.clear();
+    for (const auto& ev: staged_samples) {
+        (ev.raw.policy==sampling_policy::exact? staged_exact_samples_: staged_samples_).push_back(ev);
+    }
+
+    state_->deliverable_events.init(staged_events);
+    sample_events_.init(staged_samples_);
+    exact_sample_events_.init(staged_exact_samples_);
 
     arb_assert((assert_tmin(), true));
     unsigned remaining_steps = dt_steps(tmin_, tfinal, dt_max);
@@ -179,10 +210,17 @@ fvm_integration_result fvm_lowered_cell_impl<Backend>::integrate(
         state_->deliverable_events.mark_until_after(state_->time);
         PL();
 
-        PE(advance_integrate_current_zero);
-        state_->zero_currents();
-        PL();
-        for (auto& m: mechanisms_) {
+        if (!fused_currents_) {
+            PE(advance_integrate_current_zero);
+            state_->zero_currents();
+            PL();
+            for (auto m: fused_mechanisms_) {
+                m->nrn_current();
+            }
+        }
+        fused_currents_ = false;
+
+        for (auto m: unfused_mechanisms_) {
             m->deliver_events();
             m->nrn_current();
         }
@@ -194,30 +232,40 @@ fvm_integration_result fvm_lowered_cell_impl<Backend>::integrate(
 
         state_->update_time_to(dt_max, tfinal);
         state_->deliverable_events.event_time_if_before(state_->time_to);
+        PL();
+
+        // Take exact samples due at the cell time, and end the step at the
+        // time of the next exact sample.
+
+        PE(advance_integrate_samples);
+        exact_sample_events_.mark_until_after(state_->time);
+        state_->take_samples(exact_sample_events_.marked_events(), sample_time_, sample_value_);
+        exact_sample_events_.drop_marked_events();
+        exact_sample_events_.event_time_if_before(state_->time_to);
+        PL();
+
+        PE(advance_integrate_events);
         state_->set_dt();
         PL();
 
         // Take samples at cell time if sample time in this step interval.
+        // Interpolated samples are completed at the end of the step.
 
         PE(advance_integrate_samples);
         sample_events_.mark_until(state_->time_to);
         state_->take_samples(sample_events_.marked_events(), sample_time_, sample_value_);
-        sample_events_.drop_marked_events();
         PL();
 
         // Integrate voltage by matrix solve.
 
-        PE(advance_integrate_matrix_build);
-        matrix_.assemble(state_->dt_cell, state_->voltage, state_->current_density);
-        PL();
-        PE(advance_integrate_matrix_solve);
-        matrix_.solve();
+        PE(advance_integrate_matrix);
+        matrix_.assemble_and_solve(state_->dt_cell, state_->voltage, state_->current_density);
         memory::copy(matrix_.solution(), state_->voltage);
         PL();
 
         // Integrate mechanism state.
 
-        for (auto& m: mechanisms_) {
+        for (auto m: unfused_mechanisms_) {
             m->nrn_state();
         }
 
@@ -227,6 +275,31 @@ fvm_integration_result fvm_lowered_cell_impl<Backend>::integrate(
         update_ion_state();
         PL();
 
+        // Interpolate samples between the states at the start and end of the
+        // step. This must precede the fused pass below, which overwrites the
+        // current densities with those of the next step: the current is
+        // constant over the step, so current probes take the value at the
+        // start of the step.
+
+        PE(advance_integrate_samples);
+        state_->interpolate_samples(sample_events_.marked_events(), sample_time_, sample_value_);
+        sample_events_.drop_marked_events();
+        PL();
+
+        // Integrate the state of the fused mechanisms, and compute their
+        // current contributions for the next step, which uses the voltage
+        // and ion state as they are now.
+
+        if (!fused_mechanisms_.empty()) {
+            PE(advance_integrate_current_zero);
+            state_->zero_currents();
+            PL();
+            for (auto m: fused_mechanisms_) {
+                m->nrn_state_current();
+            }
+            fused_currents_ = true;
+        }
+
         // Update time and test for spike threshold crossings.
 
         PE(advance_integrate_threshold);
@@ -340,10 +413,11 @@ void fvm_lowered_cell_impl<B>::initialize(
 
     // Discretize cells, build matrix.
 
-    fvm_discretization D = fvm_discretize(cells);
+    fvm_discretization D = fvm_discretize(cells, global_props.cv_order);
     arb_assert(D.ncell == ncell);
     matrix_ = matrix<backend>(D.parent_cv, D.cell_cv_bounds, D.cv_capacitance, D.face_conductance, D.cv_area);
     sample_events_ = sample_event_stream(ncell);
+    exact_sample_events_ = sample_event_stream(ncell);
 
     // Discretize mechanism data.
 
@@ -413,6 +487,14 @@ void fvm_lowered_cell_impl<B>::initialize(
             mech->set_parameter(pv.first, pv.second);
         }
         mechanisms_.push_back(mechanism_ptr(mech.release()));
+
+        mechanism* mp = mechanisms_.back().get();
+        if (global_props.fuse_mechanism_kernels && mp->fusible()) {
+            fused_mechanisms_.push_back(mp);
+        }
+        else {
+            unfused_mechanisms_.push_back(mp);
+        }
     }
 
     // Collect detectors, probe handles.
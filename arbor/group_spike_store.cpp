@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <arbor/execution_context.hpp>
+#include <arbor/simulation.hpp>
+#include <arbor/spike.hpp>
+
+#include "group_spike_store.hpp"
+#include "merge_spikes.hpp"
+
+namespace arb {
+
+group_spike_store::group_spike_store(std::size_t num_groups, const task_system_handle& ts):
+    sinks_(num_groups), task_system_(ts)
+{}
+
+void group_spike_store::sort(std::size_t i) {
+    auto& s = sinks_[i];
+    if (!std::is_sorted(s.begin(), s.end(), spike_source_time_less)) {
+        std::sort(s.begin(), s.end(), spike_source_time_less);
+    }
+}
+
+std::vector<spike> group_spike_store::gather() const {
+    std::vector<spike_span> runs;
+    std::size_t n = 0;
+    for (auto& s: sinks_) {
+        runs.push_back({s.data(), s.data()+s.size()});
+        n += s.size();
+    }
+
+    std::vector<spike> spikes(n);
+    merge_spikes(runs, spikes.data(), task_system_.get());
+    return spikes;
+}
+
+void group_spike_store::record(spike_volume_stats& stats) const {
+    std::size_t n = 0;
+    for (auto& s: sinks_) {
+        n += s.size();
+        stats.max_group_interval_spikes = std::max<std::uint64_t>(stats.max_group_interval_spikes, s.size());
+    }
+    ++stats.num_intervals;
+    stats.num_spikes += n;
+    stats.max_interval_spikes = std::max<std::uint64_t>(stats.max_interval_spikes, n);
+}
+
+void group_spike_store::clear() {
+    for (auto& s: sinks_) {
+        s.clear();
+    }
+}
+
+} // namespace arb
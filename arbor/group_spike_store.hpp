@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <arbor/execution_context.hpp>
+#include <arbor/simulation.hpp>
+#include <arbor/spike.hpp>
+
+namespace arb {
+
+/// Storage for the spikes generated by the cell groups on a domain in one
+/// integration interval.
+///
+/// Each cell group appends its spikes directly to its own sink, set with
+/// cell_group::set_spike_sink(). The sinks keep their capacity when cleared,
+/// so a group that generates no more spikes than in earlier intervals does
+/// not allocate. The sinks are sorted in parallel by the cell group tasks,
+/// then gather() merges them into the vector of local spikes for exchange,
+/// which is the only copy made of the spikes before they are sent.
+class group_spike_store {
+public:
+    group_spike_store() = default;
+    group_spike_store(std::size_t num_groups, const task_system_handle& ts);
+
+    /// The sink for the spikes of cell group i.
+    std::vector<spike>& sink(std::size_t i) {
+        return sinks_[i];
+    }
+
+    /// Sort the spikes in the sink of cell group i by source, then time.
+    void sort(std::size_t i);
+
+    /// Merge the sorted sinks into a single vector of spikes, sorted by
+    /// source, then time.
+    std::vector<spike> gather() const;
+
+    /// Add the volume of spikes in the sinks to stats, as one interval.
+    void record(spike_volume_stats& stats) const;
+
+    /// Clear all of the sinks.
+    void clear();
+
+private:
+    std::vector<std::vector<spike>> sinks_;
+    task_system_handle task_system_;
+};
+
+} // namespace arb
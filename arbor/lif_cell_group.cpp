@@ -1,10 +1,27 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <arbor/simd/simd.hpp>
+
 #include <lif_cell_group.hpp>
 
 #include "profile/profiler_macro.hpp"
+#include "util/filter.hpp"
+#include "util/maputil.hpp"
+#include "util/range.hpp"
+#include "util/rangeutil.hpp"
 #include "util/span.hpp"
 
 using namespace arb;
 
+namespace {
+    constexpr unsigned simd_width = simd::simd_abi::native_width<lif_cell_group::value_type>::value;
+    using simd_value = simd::simd<lif_cell_group::value_type, simd_width>;
+    using simd_mask = simd_value::simd_mask;
+    using simd::where;
+}
+
 // Constructor containing gid of first cell in a group and a container of all cells.
 lif_cell_group::lif_cell_group(const std::vector<cell_gid_type>& gids, const recipe& rec):
     gids_(gids)
@@ -12,96 +29,521 @@ lif_cell_group::lif_cell_group(const std::vector<cell_gid_type>& gids, const rec
     // Default to no binning of events
     set_binning_policy(binning_kind::none, 0);
 
-    cells_.reserve(gids_.size());
-    last_time_updated_.resize(gids_.size());
+    for (auto lid: util::make_span(gids_.size())) {
+        const auto gid = gids_[lid];
+        for (cell_lid_type i = 0; i<rec.num_probes(gid); ++i) {
+            const auto p = rec.get_probe({gid, i});
+            probe_map_.insert({p.id, {cell_size_type(lid), p.tag}});
+        }
+    }
 
+    std::vector<lif_cell> cells;
+    cells.reserve(gids_.size());
     for (auto lid: util::make_span(gids_.size())) {
-        cells_.push_back(util::any_cast<lif_cell>(rec.get_cell_description(gids_[lid])));
+        cells.push_back(util::any_cast<lif_cell>(rec.get_cell_description(gids_[lid])));
+    }
+
+    // Padding cells never fire, and are left unchanged by an update.
+    lif_cell padding;
+    padding.V_th = std::numeric_limits<value_type>::infinity();
+    padding.V_m = 0;
+
+    auto add_cells = [&](lif_integration kind) {
+        for (auto lid: util::make_span(cells.size())) {
+            if (cells[lid].integration==kind) {
+                push_slot(cells[lid], lid);
+            }
+        }
+        while (slot_lid_.size()%simd_width) {
+            push_slot(padding, padding_lid);
+        }
+    };
+
+    lid_slot_.resize(gids_.size());
+    add_cells(lif_integration::exact);
+    stepped_begin_ = slot_lid_.size();
+    add_cells(lif_integration::stepped);
+
+    const auto n = slot_lid_.size();
+    V_m_ = V_m_initial_;
+    t_last_.assign(n, 0);
+    refractory_steps_.assign(n, 0);
+    step_decay_.assign(n, 1);
+    t_ref_steps_.assign(n, 0);
+    trace_index_.assign(n, std::size_t(no_trace));
+}
+
+void lif_cell_group::push_slot(const lif_cell& cell, cell_size_type lid) {
+    if (lid!=padding_lid) {
+        lid_slot_[lid] = slot_lid_.size();
     }
+    slot_lid_.push_back(lid);
+    tau_m_.push_back(cell.tau_m);
+    V_th_.push_back(cell.V_th);
+    C_m_.push_back(cell.C_m);
+    E_L_.push_back(cell.E_L);
+    t_ref_.push_back(cell.t_ref);
+    V_m_initial_.push_back(cell.V_m);
 }
 
 cell_kind lif_cell_group::get_cell_kind() const {
     return cell_kind::lif_neuron;
 }
 
-void lif_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& event_lanes) {
+void lif_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& lanes) {
     PE(advance_lif);
+    const auto n = slot_lid_.size();
+    const auto event_lanes = binning_==binning_kind::none || lanes.empty()?
+        lanes: bin_events(ep.tfinal, lanes);
+
+    setup_samples(ep.tfinal, dt);
+
     if (event_lanes.size() > 0) {
-        for (auto lid: util::make_span(gids_.size())) {
-            // Advance each cell independently.
-            advance_cell(ep.tfinal, dt, lid, event_lanes[lid]);
+        for (std::size_t i = 0; i<stepped_begin_; i += exact_block_size) {
+            advance_exact(ep.tfinal, event_lanes, i, std::min(i+exact_block_size, stepped_begin_));
+        }
+    }
+
+    if (stepped_begin_<n && dt>0 && ep.tfinal>t_) {
+        if (dt!=stepped_dt_) {
+            for (std::size_t i = stepped_begin_; i<n; ++i) {
+                step_decay_[i] = std::exp(-dt/tau_m_[i]);
+                // Events that arrive in a step that ends before the end of the
+                // refractory period, measured from the end of the step of the
+                // spike, are lost.
+                t_ref_steps_[i] = std::max(0., std::ceil(t_ref_[i]/dt)-1);
+            }
+            stepped_dt_ = dt;
+        }
+
+        std::size_t n_steps = std::ceil((ep.tfinal-t_)/dt);
+        while (n_steps>1 && t_+(n_steps-1)*double(dt)>=ep.tfinal) --n_steps;
+
+        for (std::size_t i = stepped_begin_; i<n; i += simd_width) {
+            advance_stepped(ep.tfinal, dt, n_steps, event_lanes, i);
         }
     }
+
+    deliver_samples();
+    t_ = ep.tfinal;
     PL();
 }
+void lif_cell_group::set_spike_sink(std::vector<spike>* sink) {
+    sink_ = sink;
+}
 
 const std::vector<spike>& lif_cell_group::spikes() const {
-    return spikes_;
+    return sink_? *sink_: spikes_;
 }
 
 void lif_cell_group::clear_spikes() {
-    spikes_.clear();
+    spike_sink().clear();
 }
 
-// TODO: implement sampler
 void lif_cell_group::add_sampler(sampler_association_handle h, cell_member_predicate probe_ids,
-                                    schedule sched, sampler_function fn, sampling_policy policy) {}
-void lif_cell_group::remove_sampler(sampler_association_handle h) {}
-void lif_cell_group::remove_all_samplers() {}
+                                    schedule sched, sampler_function fn, sampling_policy policy)
+{
+    std::vector<cell_member_type> probeset =
+        util::assign_from(util::filter(util::keys(probe_map_), probe_ids));
+
+    if (!probeset.empty()) {
+        sampler_map_.add(h, sampler_association{std::move(sched), std::move(fn), std::move(probeset), {}, policy});
+    }
+}
+
+void lif_cell_group::add_bulk_sampler(sampler_association_handle h, cell_member_predicate probe_ids,
+                                      schedule sched, bulk_sampler_function fn, sampling_policy policy)
+{
+    std::vector<cell_member_type> probeset =
+        util::assign_from(util::filter(util::keys(probe_map_), probe_ids));
+
+    if (!probeset.empty()) {
+        sampler_map_.add(h, sampler_association{std::move(sched), {}, std::move(probeset), std::move(fn), policy});
+    }
+}
+
+void lif_cell_group::remove_sampler(sampler_association_handle h) {
+    sampler_map_.remove(h);
+}
+
+void lif_cell_group::remove_all_samplers() {
+    sampler_map_.clear();
+}
 
-// TODO: implement binner_
 void lif_cell_group::set_binning_policy(binning_kind policy, time_type bin_interval) {
+    binning_ = policy;
+    binners_.clear();
+    binners_.resize(gids_.size(), event_binner(policy, bin_interval));
 }
 
 void lif_cell_group::reset() {
-    spikes_.clear();
-    last_time_updated_.clear();
+    clear_spikes();
+    for (auto& assoc: sampler_map_) {
+        assoc.sched.reset();
+    }
+    for (auto& b: binners_) {
+        b.reset();
+    }
+
+    V_m_ = V_m_initial_;
+    std::fill(t_last_.begin(), t_last_.end(), 0);
+    std::fill(refractory_steps_.begin(), refractory_steps_.end(), 0);
+    t_ = 0;
+}
+
+event_span lif_cell_group::slot_events(const event_lane_subrange& event_lanes, std::size_t slot) const {
+    const auto lid = slot_lid_[slot];
+    if (lid==padding_lid || lid>=event_lanes.size()) {
+        return {};
+    }
+
+    return event_lanes[lid];
+}
+
+event_lane_subrange lif_cell_group::bin_events(time_type tfinal, const event_lane_subrange& event_lanes) {
+    const auto n = event_lanes.size();
+    if (binned_lanes_.size()!=n) {
+        binned_lanes_ = event_lane_store(n);
+    }
+    binned_lanes_.clear();
+
+    auto before_tfinal = [tfinal](const spike_event& e) { return e.time<tfinal; };
+    for (std::size_t lid = 0; lid<n; ++lid) {
+        const auto lane = event_lanes[lid];
+        binned_lanes_.add_count(lid, std::partition_point(lane.begin(), lane.end(), before_tfinal)-lane.begin());
+    }
+    binned_lanes_.allocate();
+
+    for (std::size_t lid = 0; lid<n; ++lid) {
+        auto out = binned_lanes_.lane(lid).begin();
+        for (auto e: event_lanes[lid]) {
+            if (e.time>=tfinal) break;
+            e.time = binners_[lid].bin(e.time, t_);
+            *out++ = e;
+        }
+    }
+
+    return binned_lanes_.subrange(0, n);
+}
+
+void lif_cell_group::setup_samples(time_type tfinal, time_type dt) {
+    for (auto i: traced_slots_) {
+        trace_index_[i] = no_trace;
+    }
+    traced_slots_.clear();
+    sampler_calls_.clear();
+    bulk_calls_.clear();
+    sample_time_.clear();
+
+    for (auto& sa: sampler_map_) {
+        auto sample_times = util::make_range(sa.sched.events(t_, tfinal));
+        if (sample_times.empty()) {
+            continue;
+        }
+
+        if (sa.bulk_sampler) {
+            bulk_calls_.push_back({sa.bulk_sampler, sampler_calls_.size(), sampler_calls_.size()+sa.probe_ids.size()});
+        }
+
+        for (cell_member_type pid: sa.probe_ids) {
+            const auto& p = probe_map_.at(pid);
+            const auto slot = lid_slot_[p.handle];
+            const auto begin = sample_time_.size();
+            sample_time_.insert(sample_time_.end(), sample_times.begin(), sample_times.end());
+            sampler_calls_.push_back({sa.sampler, pid, p.tag, slot, begin, sample_time_.size()});
+
+            if (trace_index_[slot]==no_trace) {
+                trace_index_[slot] = traced_slots_.size();
+                traced_slots_.push_back(slot);
+            }
+        }
+    }
+
+    // Order the samples of each trace by time, and start each trace with
+    // the state of the cell at the start of the epoch. A cell with time
+    // steps in its refractory period starts to decay at the end of the last
+    // step of the period.
+    const auto n_traces = traced_slots_.size();
+    trace_sample_divs_.assign(n_traces+1, 0);
+    for (auto& sc: sampler_calls_) {
+        trace_sample_divs_[trace_index_[sc.slot]+1] += sc.end-sc.begin;
+    }
+    for (std::size_t j = 0; j<n_traces; ++j) {
+        trace_sample_divs_[j+1] += trace_sample_divs_[j];
+    }
+
+    trace_next_.assign(trace_sample_divs_.begin(), trace_sample_divs_.end()-1);
+    trace_samples_.resize(sample_time_.size());
+    for (auto& sc: sampler_calls_) {
+        auto& next = trace_next_[trace_index_[sc.slot]];
+        for (auto j = sc.begin; j<sc.end; ++j) {
+            trace_samples_[next++] = j;
+        }
+    }
+
+    trace_t_decay_.resize(n_traces);
+    trace_V_m_.resize(n_traces);
+    auto by_time = [this](std::size_t j, std::size_t k) { return sample_time_[j]<sample_time_[k]; };
+    for (std::size_t j = 0; j<n_traces; ++j) {
+        auto samples = trace_samples_.begin();
+        auto first = samples+trace_sample_divs_[j];
+        auto last = samples+trace_sample_divs_[j+1];
+        if (!std::is_sorted(first, last, by_time)) {
+            std::stable_sort(first, last, by_time);
+        }
+        trace_next_[j] = trace_sample_divs_[j];
+
+        const auto i = traced_slots_[j];
+        trace_t_decay_[j] = i<stepped_begin_? t_last_[i]: t_+refractory_steps_[i]*double(dt);
+        trace_V_m_[j] = V_m_[i];
+    }
+
+    const auto n = sample_time_.size();
+    sample_value_.resize(n+simd_width);
+    sample_decay_.resize(n+simd_width);
+    std::fill(sample_decay_.begin()+n, sample_decay_.end(), 0);
 }
 
-// Advances a single cell (lid) with the exact solution (jumps can be arbitrary).
-// Parameter dt is ignored, since we make jumps between two consecutive spikes.
-void lif_cell_group::advance_cell(time_type tfinal, time_type dt, cell_gid_type lid, pse_vector& event_lane) {
-    // Current time of last update.
-    auto t = last_time_updated_[lid];
-    auto& cell = cells_[lid];
-    const auto n_events = event_lane.size();
+void lif_cell_group::sample_segment(std::size_t trace, double t, double t_decay, value_type V_m) {
+    const auto end = trace_sample_divs_[trace+1];
+    const value_type r = -1/tau_m_[traced_slots_[trace]];
+    auto& next = trace_next_[trace];
+    for (; next<end; ++next) {
+        const auto j = trace_samples_[next];
+        const double ts = sample_time_[j];
+        if (ts>=t) break;
+        sample_value_[j] = V_m;
+        sample_decay_[j] = std::max(0., ts-t_decay)*r;
+    }
+}
+
+void lif_cell_group::deliver_samples() {
+    if (sampler_calls_.empty()) {
+        return;
+    }
 
-    // Integrate until tfinal using the exact solution of membrane voltage differential equation.
-    for (unsigned i=0; i<n_events; ++i ) {
-        auto& ev = event_lane[i];
-        const auto time = ev.time;
-        auto weight = ev.weight;
+    // Evaluate the samples after the last change of state of each cell,
+    // then the decay of the potential for all of the samples at once.
+    for (std::size_t j = 0; j<traced_slots_.size(); ++j) {
+        sample_segment(j, INFINITY, trace_t_decay_[j], trace_V_m_[j]);
+    }
+
+    auto& value = sample_value_;
+    auto& decay = sample_decay_;
+    for (std::size_t j = 0; j<sample_time_.size(); j += simd_width) {
+        (simd_value(value.data()+j)*exp(simd_value(decay.data()+j))).copy_to(value.data()+j);
+    }
 
-        if (time < t) continue;        // skip event if a neuron is in refactory period
-        if (time >= tfinal) break;     // end of integration interval
+    for (auto& sc: sampler_calls_) {
+        if (!sc.sampler) continue;
 
-        // if there are events that happened at the same time as this event, process them as well
-        while (i + 1 < n_events && event_lane[i+1].time <= time) {
-            weight += event_lane[i+1].weight;
-            i++;
+        sample_records_.clear();
+        for (auto j = sc.begin; j<sc.end; ++j) {
+            sample_records_.push_back(sample_record{sample_time_[j], const_cast<const value_type*>(&value[j])});
         }
+        sc.sampler(sc.probe_id, sc.tag, sc.end-sc.begin, sample_records_.data());
+    }
 
-        // Let the membrane potential decay.
-        auto decay = exp(-(time - t) / cell.tau_m);
-        cell.V_m *= decay;
-        auto update = weight / cell.C_m;
-        // Add jump due to spike.
-        cell.V_m += update;
-        t = time;
-        // If crossing threshold occurred
-        if (cell.V_m >= cell.V_th) {
-            cell_member_type spike_neuron_gid = {gids_[lid], 0};
-            spike s = {spike_neuron_gid, t};
-            spikes_.push_back(s);
+    // The samples of the probes of a bulk sampler are contiguous in the
+    // sample buffers.
+    for (auto& bc: bulk_calls_) {
+        const auto base = sampler_calls_[bc.begin_call].begin;
+
+        bulk_probe_id_.clear();
+        bulk_tag_.clear();
+        bulk_offset_.clear();
+        for (auto k = bc.begin_call; k<bc.end_call; ++k) {
+            bulk_probe_id_.push_back(sampler_calls_[k].probe_id);
+            bulk_tag_.push_back(sampler_calls_[k].tag);
+            bulk_offset_.push_back(sampler_calls_[k].begin-base);
+        }
+        bulk_offset_.push_back(sampler_calls_[bc.end_call-1].end-base);
+
+        bc.sampler(sample_columns{bc.end_call-bc.begin_call, bulk_probe_id_.data(), bulk_tag_.data(),
+            bulk_offset_.data(), sample_time_.data()+base, value.data()+base});
+    }
+}
+
+void lif_cell_group::advance_exact(time_type tfinal, const event_lane_subrange& event_lanes, std::size_t first, std::size_t last) {
+    // The decay of the membrane potential between consecutive events of each
+    // cell, or between the last update and the first event, for all of the
+    // events of the cells in the buffer order, evaluated with SIMD exp. Without
+    // SIMD, or when the cells receive few events, the decay is evaluated as
+    // the events are delivered instead.
+    auto& decay = event_decay_;
+    bool precompute_decay = false;
+    std::size_t n_events = 0;
+    if (simd_width>1) {
+        for (auto i = first; i<last; ++i) {
+            n_events += slot_events(event_lanes, i).size();
+        }
+        precompute_decay = n_events>=exact_dense_events*(last-first);
+    }
+    if (precompute_decay) {
+        decay.resize(n_events+simd_width);
+        value_type* arg = decay.data();
+        for (auto i = first; i<last; ++i) {
+            value_type t = t_last_[i];
+            const value_type r = -1/tau_m_[i];
+            for (auto& e: slot_events(event_lanes, i)) {
+                if (e.time>=tfinal) break;
+                *arg++ = (e.time-t)*r;
+                t = e.time;
+            }
+        }
+        n_events = arg-decay.data();
+        std::fill(arg, decay.data()+decay.size(), 0);
+        for (std::size_t j = 0; j<n_events; j += simd_width) {
+            exp(simd_value(decay.data()+j)).copy_to(decay.data()+j);
+        }
+    }
+
+    // Integrate each cell until tfinal using the exact solution of the
+    // membrane voltage differential equation, with jumps at the events.
+    // The precomputed decay of an event is used unless the cell has fired,
+    // or skipped events in its refractory period, since the previous event.
+    const value_type* event_decay = decay.data();
+    std::size_t j = 0;
+    for (auto i = first; i<last; ++i) {
+        const value_type tau_m = tau_m_[i];
+        const value_type C_m = C_m_[i];
+        const value_type V_th = V_th_[i];
+
+        value_type t = t_last_[i];
+        value_type V_m = V_m_[i];
+        bool in_sequence = precompute_decay;
+        const auto trace = trace_index_[i];
+
+        const auto events = slot_events(event_lanes, i);
+        const auto end = events.end();
+        for (auto e = events.begin(); e!=end; ++e, ++j) {
+            const auto time = e->time;
+            if (time>=tfinal) break;     // end of integration interval
+            if (time<t) {
+                // Skip event if a neuron is in refactory period.
+                in_sequence = false;
+                continue;
+            }
+
+            if (trace!=no_trace) {
+                sample_segment(trace, time, t, V_m);
+            }
+
+            // If there are events that happened at the same time as this
+            // event, process them as well.
+            const auto d = in_sequence? event_decay[j]: std::exp(-(time-t)/tau_m);
+            auto weight = e->weight;
+            while (e+1!=end && (e+1)->time<=time) {
+                weight += (++e)->weight;
+                ++j;
+            }
+
+            // Let the membrane potential decay, and add the jump due to the event.
+            V_m = V_m*d + weight/C_m;
+            t = time;
+            in_sequence = precompute_decay;
+
+            if (V_m>=V_th) {
+                spike_sink().push_back({{gids_[slot_lid_[i]], 0}, time});
+
+                // Advance the time of the last update to account for the
+                // refractory period, and reset the membrane potential. Times
+                // are kept at the precision of time_type.
+                t = time_type(t+t_ref_[i]);
+                V_m = E_L_[i];
+                in_sequence = false;
+            }
+        }
+
+        t_last_[i] = t;
+        V_m_[i] = V_m;
+        if (trace!=no_trace) {
+            trace_t_decay_[trace] = t;
+            trace_V_m_[trace] = V_m;
+        }
+    }
+}
+
+void lif_cell_group::advance_stepped(time_type tfinal, time_type dt, std::size_t n_steps, const event_lane_subrange& event_lanes, std::size_t first) {
+    const double t0 = t_;
+    auto step_end = [&](std::size_t s) { return std::min(t0+(s+1)*double(dt), double(tfinal)); };
+
+    // Sum the weights of the events of each cell in the step in which they
+    // arrive, with the steps of the cells of the block interleaved.
+    auto& input = step_input_;
+    input.assign(n_steps*simd_width, 0);
+    for (unsigned k = 0; k<simd_width; ++k) {
+        for (auto& e: slot_events(event_lanes, first+k)) {
+            if (e.time>=tfinal) break;
+            const auto s = std::min(n_steps-1, std::size_t(std::max(0., (e.time-t0)/dt)));
+            input[s*simd_width+k] += e.weight;
+        }
+    }
+
+    const simd_value C_m(C_m_.data()+first);
+    const simd_value V_th(V_th_.data()+first);
+    const simd_value E_L(E_L_.data()+first);
+    const simd_value t_ref_steps(t_ref_steps_.data()+first);
+    const simd_value step_decay(step_decay_.data()+first);
+
+    // The last step can be shorter than dt.
+    const double last_dt = step_end(n_steps-1)-(t0+(n_steps-1)*double(dt));
+    const simd_value last_decay = last_dt==dt?
+        step_decay: exp(-simd_value(last_dt)/simd_value(tau_m_.data()+first));
+
+    simd_value V_m(V_m_.data()+first);
+    simd_value refractory(refractory_steps_.data()+first);
+
+    // Lanes of sampled cells, the segment of which changes at the end of
+    // each step in which they receive input or fire.
+    std::size_t trace[simd_width];
+    bool traced = false;
+    for (unsigned k = 0; k<simd_width; ++k) {
+        trace[k] = trace_index_[first+k];
+        traced |= trace[k]!=no_trace;
+    }
+
+    bool fired[simd_width];
+    bool updated[simd_width];
+    value_type V_step[simd_width];
+    for (std::size_t s = 0; s<n_steps; ++s) {
+        // The membrane potential of cells in the refractory period stays at
+        // the resting potential, and their input is lost.
+        const simd_mask update = refractory<=simd_value(0.);
+        const simd_value decay = s+1<n_steps? step_decay: last_decay;
+        where(update, V_m) = V_m*decay + simd_value(input.data()+s*simd_width)/C_m;
+        refractory = max(refractory-simd_value(1.), simd_value(0.));
+
+        const simd_mask crossed = update && V_m>=V_th;
+        crossed.copy_to(fired);
+        if (std::any_of(fired, fired+simd_width, [](bool f) { return f; })) {
+            where(crossed, V_m) = E_L;
+            where(crossed, refractory) = t_ref_steps;
+
+            const time_type t = step_end(s);
+            for (unsigned k = 0; k<simd_width; ++k) {
+                if (fired[k]) {
+                    spike_sink().push_back({{gids_[slot_lid_[first+k]], 0}, t});
+                }
+            }
+        }
 
-            // Advance the last_time_updated to account for the refractory period.
-            t += cell.t_ref;
+        if (traced) {
+            const double t = step_end(s);
+            const value_type* step_input = input.data()+s*simd_width;
+            update.copy_to(updated);
+            V_m.copy_to(V_step);
+            for (unsigned k = 0; k<simd_width; ++k) {
+                const auto j = trace[k];
+                if (j==no_trace || !(fired[k] || (updated[k] && step_input[k]!=0))) continue;
 
-            // Reset the voltage to resting potential.
-            cell.V_m = cell.E_L;
+                sample_segment(j, t, trace_t_decay_[j], trace_V_m_[j]);
+                trace_t_decay_[j] = fired[k]? t+t_ref_steps_[first+k]*double(dt): t;
+                trace_V_m_[j] = V_step[k];
+            }
         }
     }
 
-    // This is the last time a cell was updated.
-    last_time_updated_[lid] = t;
+    V_m.copy_to(V_m_.data()+first);
+    refractory.copy_to(refractory_steps_.data()+first);
 }
@@ -9,6 +9,9 @@
 #include <arbor/spike.hpp>
 
 #include "cell_group.hpp"
+#include "event_binner.hpp"
+#include "event_lanes.hpp"
+#include "sampler_map.hpp"
 
 namespace arb {
 
@@ -26,31 +29,170 @@ public:
     virtual void set_binning_policy(binning_kind policy, time_type bin_interval) override;
     virtual void advance(epoch epoch, time_type dt, const event_lane_subrange& events) override;
 
+    virtual void set_spike_sink(std::vector<spike>* sink) override;
     virtual const std::vector<spike>& spikes() const override;
     virtual void clear_spikes() override;
 
     // Sampler association methods below should be thread-safe, as they might be invoked
     // from a sampler call back called from a different cell group running on a different thread.
     virtual void add_sampler(sampler_association_handle, cell_member_predicate, schedule, sampler_function, sampling_policy) override;
+    virtual void add_bulk_sampler(sampler_association_handle, cell_member_predicate, schedule, bulk_sampler_function, sampling_policy) override;
     virtual void remove_sampler(sampler_association_handle) override;
     virtual void remove_all_samplers() override;
 
 private:
-    // Advances a single cell (lid) with the exact solution (jumps can be arbitrary).
-    // Parameter dt is ignored, since we make jumps between two consecutive spikes.
-    void advance_cell(time_type tfinal, time_type dt, cell_gid_type lid, pse_vector& event_lane);
+    // Advance the cells in the slots [first, last) with the exact solution,
+    // making jumps between consecutive events. The decay of the membrane
+    // potential between events is evaluated for all of the events of the
+    // cells at once, in a vectorized loop over the flat event buffer.
+    void advance_exact(time_type tfinal, const event_lane_subrange& event_lanes, std::size_t first, std::size_t last);
+
+    // Advance the cells in the slots [first, first+simd_width) by n_steps
+    // time steps of dt from t_, the last of which ends at tfinal. The events
+    // of each cell are first summed into the step in which they arrive, and
+    // each step is then a vectorized update of all of the cells.
+    void advance_stepped(time_type tfinal, time_type dt, std::size_t n_steps, const event_lane_subrange& event_lanes, std::size_t first);
+
+    // Copy the events of the epoch to binned_lanes_, with times binned by the
+    // binner of each cell.
+    event_lane_subrange bin_events(time_type tfinal, const event_lane_subrange& event_lanes);
+
+    // Gather the sample times of the samplers that are triggered in the epoch
+    // ending at tfinal, and start a trace of the membrane potential of each
+    // sampled cell.
+    void setup_samples(time_type tfinal, time_type dt);
+
+    // Evaluate the remaining samples of the sampled cells, and pass the
+    // samples to the samplers.
+    void deliver_samples();
+
+    // The event lane of the cell in a slot.
+    event_span slot_events(const event_lane_subrange& event_lanes, std::size_t slot) const;
+
+    // Append a cell to the state, in the slot after the last.
+    void push_slot(const lif_cell& cell, cell_size_type lid);
+
+    // The sink set by set_spike_sink(), or spikes_.
+    std::vector<spike>& spike_sink() { return sink_? *sink_: spikes_; }
 
     // List of the gids of the cells in the group.
     std::vector<cell_gid_type> gids_;
 
-    // Cells that belong to this group.
-    std::vector<lif_cell> cells_;
+    // The cells are stored as a structure of arrays, indexed by slot. The
+    // cells integrated with the exact solution are in the slots before
+    // stepped_begin_, followed by those integrated with time steps, and the
+    // cells of each kind are padded with inert cells to a whole number of
+    // SIMD blocks. slot_lid_ holds the lid of the cell in each slot, or
+    // padding_lid for padding.
+    static constexpr cell_size_type padding_lid = cell_size_type(-1);
+
+    std::vector<cell_size_type> slot_lid_;
+    std::size_t stepped_begin_ = 0;
+
+    // Cell parameters.
+    std::vector<value_type> tau_m_;
+    std::vector<value_type> V_th_;
+    std::vector<value_type> C_m_;
+    std::vector<value_type> E_L_;
+    std::vector<value_type> t_ref_;
+    std::vector<value_type> V_m_initial_;
+
+    // Membrane potential, and, for cells with the exact solution, the time of
+    // the last update or the end of the refractory period, whichever is
+    // later, or, for cells with time steps, the number of steps left in the
+    // refractory period.
+    std::vector<value_type> V_m_;
+    std::vector<value_type> t_last_;
+    std::vector<value_type> refractory_steps_;
+
+    // Decay of the membrane potential over a time step of stepped_dt_, and the
+    // number of steps in the refractory period.
+    std::vector<value_type> step_decay_;
+    std::vector<value_type> t_ref_steps_;
+    time_type stepped_dt_ = 0;
+
+    // The cells with the exact solution are advanced in blocks of this many
+    // cells, and event_decay_ holds the decay before each of their events,
+    // when the cells of the block receive exact_dense_events or more events
+    // each on average.
+    static constexpr std::size_t exact_block_size = 256;
+    static constexpr std::size_t exact_dense_events = 4;
+    std::vector<value_type> event_decay_;
+
+    // The summed weights of the events in each step, for each cell of a block.
+    std::vector<value_type> step_input_;
+
+    // Event binning: events are binned when the policy is not none.
+    binning_kind binning_ = binning_kind::none;
+    std::vector<event_binner> binners_;
+    event_lane_store binned_lanes_;
+
+    // Samplers, and the probes of the cells, each of which samples the
+    // membrane potential of the cell with lid given by the probe handle.
+    sampler_association_map sampler_map_;
+    probe_association_map<cell_size_type> probe_map_;
+    std::vector<std::size_t> lid_slot_;
+
+    // The samples of the sampled cells are evaluated as the cells are
+    // integrated. Each sampled cell has a trace: the indices of its samples
+    // in the sample buffers, ordered by time, and the current segment of its
+    // membrane potential, which is V_m until t_decay, after which it decays
+    // exponentially. When the state of the cell changes at time t, other than
+    // by decay, the samples before t are evaluated on the current segment,
+    // which is then replaced by a new one. The decay over the segments is
+    // evaluated for all of the samples at once, at the end of the epoch.
+    //
+    // trace_index_ holds the index of the trace of the cell in each slot, or
+    // no_trace if the cell is not sampled in the current epoch.
+    static constexpr std::size_t no_trace = std::size_t(-1);
+    std::vector<std::size_t> trace_index_;
+    std::vector<std::size_t> traced_slots_;
+    std::vector<std::size_t> trace_sample_divs_;
+    std::vector<std::size_t> trace_samples_;
+    std::vector<std::size_t> trace_next_;
+    std::vector<double> trace_t_decay_;
+    std::vector<value_type> trace_V_m_;
+
+    // Evaluate the samples of a trace before time t on the segment
+    // given by t_decay and V_m.
+    void sample_segment(std::size_t trace, double t, double t_decay, value_type V_m);
+
+    // A sampler call for one probe: the samples are the entries in
+    // [begin, end) of the sample buffers.
+    struct sampler_call_info {
+        sampler_function sampler;
+        cell_member_type probe_id;
+        probe_tag tag;
+        std::size_t slot;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    std::vector<sampler_call_info> sampler_calls_;
+
+    // A bulk sampler call for the probes of an association: the sampler
+    // calls in [begin_call, end_call), which have an empty sampler.
+    struct bulk_call_info {
+        bulk_sampler_function sampler;
+        std::size_t begin_call;
+        std::size_t end_call;
+    };
+
+    std::vector<bulk_call_info> bulk_calls_;
+    std::vector<cell_member_type> bulk_probe_id_;
+    std::vector<probe_tag> bulk_tag_;
+    std::vector<std::size_t> bulk_offset_;
+    std::vector<time_type> sample_time_;
+    std::vector<value_type> sample_value_;
+    std::vector<value_type> sample_decay_;
+    std::vector<sample_record> sample_records_;
+
+    // Time at the end of the last epoch.
+    time_type t_ = 0;
 
     // Spikes that are generated (not necessarily sorted).
     std::vector<spike> spikes_;
-
-    // Time when the cell was last updated.
-    std::vector<time_type> last_time_updated_;
+    std::vector<spike>* sink_ = nullptr;
 };
 
 } // namespace arb
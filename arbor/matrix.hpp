@@ -69,6 +69,11 @@ public:
         state_.assemble(dt_cell, voltage, current);
     }
 
+    /// Assemble the matrix for given dt and solve the linear system.
+    void assemble_and_solve(const array& dt_cell, const array& voltage, const array& current) {
+        state_.assemble_and_solve(dt_cell, voltage, current);
+    }
+
     /// Get a view of the solution
     typename State::const_view solution() const {
         return state_.solution();
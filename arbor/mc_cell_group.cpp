@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <functional>
 #include <unordered_map>
 #include <vector>
@@ -20,6 +21,7 @@
 #include "util/maputil.hpp"
 #include "util/partition.hpp"
 #include "util/range.hpp"
+#include "util/rangeutil.hpp"
 #include "util/span.hpp"
 
 namespace arb {
@@ -58,9 +60,8 @@ mc_cell_group::mc_cell_group(const std::vector<cell_gid_type>& gids, const recip
 }
 
 void mc_cell_group::reset() {
-    spikes_.clear();
+    clear_spikes();
 
-    sample_events_.clear();
     for (auto &assoc: sampler_map_) {
         assoc.sched.reset();
     }
@@ -85,7 +86,7 @@ void mc_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& e
     // skip event binning if empty lanes are passed
     if (event_lanes.size()) {
         for (auto lid: util::count_along(gids_)) {
-            auto& lane = event_lanes[lid];
+            auto lane = event_lanes[lid];
             for (auto e: lane) {
                 if (e.time>=ep.tfinal) break;
                 e.time = binners_[lid].bin(e.time, tstart);
@@ -99,16 +100,16 @@ void mc_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& e
 
     // Create sample events and delivery information.
     //
-    // For each (schedule, sampler, probe set) in the sampler association
-    // map that will be triggered in this integration interval, create
-    // sample events for the lowered cell, one for each scheduled sample
-    // time and probe in the probe set.
+    // For each (schedule, sampler, probe set) in the sampling plan that
+    // will be triggered in this integration interval, create sample events
+    // for the lowered cell, one for each scheduled sample time and sample
+    // gather of the association.
     //
-    // Each event is associated with an offset into the sample data and
-    // time buffers; these are assigned contiguously such that one call to
-    // a sampler callback can be represented by a `sampler_call_info`
-    // value as defined below, grouping together all the samples of the
-    // same probe for this callback in this association.
+    // Samples are assigned offsets into the sample data and time buffers
+    // contiguously by association, then by probe, then by sample time, such
+    // that one call to a sampler callback can be represented by a
+    // `sampler_call_info` value as defined below, grouping together all the
+    // samples of the same probe for this callback in this association.
 
     struct sampler_call_info {
         sampler_function sampler;
@@ -120,41 +121,100 @@ void mc_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& e
         sample_size_type end_offset;
     };
 
+    // A bulk sampler is called once with all the samples of its
+    // association, which start at `base_offset`.
+
+    struct bulk_call_info {
+        const sampling_plan_entry* entry;
+        sample_size_type base_offset;
+        sample_size_type n_times;
+    };
+
     PE(advance_samplesetup);
+    // Mark the plan valid before it takes its snapshot of the associations,
+    // so that changes made meanwhile are picked up in the next epoch.
+    if (!sampling_plan_valid_.exchange(true)) {
+        update_sampling_plan();
+    }
+
     std::vector<sampler_call_info> call_info;
+    std::vector<bulk_call_info> bulk_call_info;
 
-    std::vector<sample_event> sample_events;
     sample_size_type n_samples = 0;
     sample_size_type max_samples_per_call = 0;
 
-    for (auto& sa: sampler_map_) {
-        auto sample_times = util::make_range(sa.sched.events(tstart, ep.tfinal));
-        if (sample_times.empty()) {
+    for (auto& entry: sampling_plan_) {
+        auto& sa = *entry.assoc;
+        entry.sample_times = sa.sched.events(tstart, ep.tfinal);
+        entry.base_offset = n_samples;
+
+        const sample_size_type n_times = entry.sample_times.second-entry.sample_times.first;
+        if (!n_times) {
             continue;
         }
 
-        sample_size_type n_times = sample_times.size();
-        max_samples_per_call = std::max(max_samples_per_call, n_times);
+        const sample_size_type base = n_samples;
+        n_samples += (entry.end-entry.begin)*n_times;
 
-        for (cell_member_type pid: sa.probe_ids) {
-            auto cell_index = gid_index_map_.at(pid.gid);
-            auto p = probe_map_[pid];
-
-            call_info.push_back({sa.sampler, pid, p.tag, n_samples, n_samples+n_times});
-
-            for (auto t: sample_times) {
-                sample_event ev{t, cell_index, {p.handle, n_samples++}};
-                sample_events.push_back(ev);
+        if (sa.bulk_sampler) {
+            bulk_call_info.push_back({&entry, base, n_times});
+        }
+        else {
+            max_samples_per_call = std::max(max_samples_per_call, n_times);
+            for (auto k: util::count_along(sa.probe_ids)) {
+                sample_size_type offset = base+k*n_times;
+                call_info.push_back({sa.sampler, sa.probe_ids[k], entry.tags[k], offset, offset+n_times});
             }
         }
     }
 
-    // Sample events must be ordered by time for the lowered cell.
-    util::sort_by(sample_events, [](const sample_event& ev) { return event_time(ev); });
+    // Sample events are staged grouped by cell, and in time order for each
+    // cell, as taken by the lowered cell: the sample times of the gathers
+    // on a cell, each in time order, are merged through a min-heap keyed on
+    // (time, gather index), so that ties are staged in gather order.
+
+    staged_samples_.clear();
+    for (std::size_t g = 0; g<sample_gathers_.size();) {
+        const auto cell_index = sample_gathers_[g].cell_index;
+
+        gather_heap_.clear();
+        std::size_t g_end = g;
+        for (; g_end<sample_gathers_.size() && sample_gathers_[g_end].cell_index==cell_index; ++g_end) {
+            const auto& times = sampling_plan_[sample_gathers_[g_end].entry].sample_times;
+            gather_staged_[g_end] = 0;
+            if (times.first!=times.second) {
+                gather_heap_.push_back({times.first[0], g_end});
+            }
+        }
+        std::make_heap(gather_heap_.begin(), gather_heap_.end(), std::greater<>{});
+
+        while (!gather_heap_.empty()) {
+            std::pop_heap(gather_heap_.begin(), gather_heap_.end(), std::greater<>{});
+            const auto t_next = gather_heap_.back().first;
+            const auto next = gather_heap_.back().second;
+
+            const auto& sg = sample_gathers_[next];
+            const auto& entry = sampling_plan_[sg.entry];
+            const sample_size_type n_times = entry.sample_times.second-entry.sample_times.first;
+            const auto i = gather_staged_[next]++;
+            sample_size_type offset = entry.base_offset+(sg.begin-entry.begin)*n_times+i;
+            staged_samples_.push_back({t_next, cell_index, {sg.begin, sg.end, offset, n_times, entry.assoc->policy, t_next}});
+
+            // Replace the gather's entry with its next sample time, if any.
+            if (i+1<n_times) {
+                gather_heap_.back().first = entry.sample_times.first[i+1];
+                std::push_heap(gather_heap_.begin(), gather_heap_.end(), std::greater<>{});
+            }
+            else {
+                gather_heap_.pop_back();
+            }
+        }
+        g = g_end;
+    }
     PL();
 
     // Run integration and collect samples, spikes.
-    auto result = lowered_->integrate(ep.tfinal, dt, staged_events_, std::move(sample_events));
+    auto result = lowered_->integrate(ep.tfinal, dt, staged_events_, staged_samples_);
 
     // For each sampler callback registered in `call_info`, construct the
     // vector of sample entries from the lowered cell sample times and values
@@ -172,6 +232,28 @@ void mc_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& e
 
         sc.sampler(sc.probe_id, sc.tag, sc.end_offset-sc.begin_offset, sample_records.data());
     }
+
+    // The samples of a bulk sampler association are contiguous in the
+    // lowered cell sample arrays; only the sample times need conversion.
+
+    std::vector<std::size_t> bulk_offset;
+    std::vector<time_type> bulk_time;
+
+    for (auto& bc: bulk_call_info) {
+        const auto& entry = *bc.entry;
+        const std::size_t n_probe = entry.end-entry.begin;
+        const auto base = bc.base_offset;
+        const auto end = base+n_probe*bc.n_times;
+
+        bulk_offset.clear();
+        for (std::size_t k = 0; k<=n_probe; ++k) {
+            bulk_offset.push_back(k*bc.n_times);
+        }
+        bulk_time.assign(result.sample_time.begin()+base, result.sample_time.begin()+end);
+
+        entry.assoc->bulk_sampler(sample_columns{n_probe, entry.assoc->probe_ids.data(), entry.tags.data(),
+            bulk_offset.data(), bulk_time.data(), result.sample_value.begin()+base});
+    }
     PL();
 
     // Copy out spike voltage threshold crossings from the back end, then
@@ -180,27 +262,86 @@ void mc_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& e
     // global index for spike communication.
 
     for (auto c: result.crossings) {
-        spikes_.push_back({spike_sources_[c.index], time_type(c.time)});
+        spike_sink().push_back({spike_sources_[c.index], time_type(c.time)});
     }
 }
 
+void mc_cell_group::update_sampling_plan() {
+    sampling_plan_.clear();
+    sample_gathers_.clear();
+    std::vector<probe_handle> handles;
+
+    // The probe ids of each association are sorted, so that the probes
+    // on the same cell are contiguous.
+
+    for (auto& assoc: sampler_map_.snapshot()) {
+        const auto& sa = *assoc;
+        const std::size_t entry_index = sampling_plan_.size();
+        const std::size_t gather_begin = sample_gathers_.size();
+
+        sampling_plan_entry entry;
+        entry.assoc = assoc;
+        entry.begin = handles.size();
+
+        for (cell_member_type pid: sa.probe_ids) {
+            cell_size_type cell_index = gid_index_map_.at(pid.gid);
+            const auto& p = probe_map_.at(pid);
+
+            fvm_size_type h = handles.size();
+            if (sample_gathers_.size()==gather_begin || sample_gathers_.back().cell_index!=cell_index) {
+                sample_gathers_.push_back({cell_index, h, h, entry_index});
+            }
+            ++sample_gathers_.back().end;
+
+            handles.push_back(p.handle);
+            entry.tags.push_back(p.tag);
+        }
+
+        entry.end = handles.size();
+        sampling_plan_.push_back(std::move(entry));
+    }
+
+    // Sample events are staged by cell, in association order for each cell.
+    util::stable_sort_by(sample_gathers_, [](const sample_gather& sg) { return sg.cell_index; });
+    gather_staged_.assign(sample_gathers_.size(), 0);
+
+    lowered_->set_sampling_plan(handles);
+}
+
 void mc_cell_group::add_sampler(sampler_association_handle h, cell_member_predicate probe_ids,
                                 schedule sched, sampler_function fn, sampling_policy policy)
 {
     std::vector<cell_member_type> probeset =
         util::assign_from(util::filter(util::keys(probe_map_), probe_ids));
+    util::sort(probeset);
+
+    if (!probeset.empty()) {
+        sampler_map_.add(h, sampler_association{std::move(sched), std::move(fn), std::move(probeset), {}, policy});
+        sampling_plan_valid_ = false;
+    }
+}
+
+void mc_cell_group::add_bulk_sampler(sampler_association_handle h, cell_member_predicate probe_ids,
+                                     schedule sched, bulk_sampler_function fn, sampling_policy policy)
+{
+    std::vector<cell_member_type> probeset =
+        util::assign_from(util::filter(util::keys(probe_map_), probe_ids));
+    util::sort(probeset);
 
     if (!probeset.empty()) {
-        sampler_map_.add(h, sampler_association{std::move(sched), std::move(fn), std::move(probeset)});
+        sampler_map_.add(h, sampler_association{std::move(sched), {}, std::move(probeset), std::move(fn), policy});
+        sampling_plan_valid_ = false;
     }
 }
 
 void mc_cell_group::remove_sampler(sampler_association_handle h) {
     sampler_map_.remove(h);
+    sampling_plan_valid_ = false;
 }
 
 void mc_cell_group::remove_all_samplers() {
     sampler_map_.clear();
+    sampling_plan_valid_ = false;
 }
 
 } // namespace arb
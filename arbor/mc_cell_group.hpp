@@ -1,9 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <iterator>
+#include <memory>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <arbor/common_types.hpp>
@@ -42,17 +45,24 @@ public:
 
     void advance(epoch ep, time_type dt, const event_lane_subrange& event_lanes) override;
 
+    void set_spike_sink(std::vector<spike>* sink) override {
+        sink_ = sink;
+    }
+
     const std::vector<spike>& spikes() const override {
-        return spikes_;
+        return sink_? *sink_: spikes_;
     }
 
     void clear_spikes() override {
-        spikes_.clear();
+        spike_sink().clear();
     }
 
     void add_sampler(sampler_association_handle h, cell_member_predicate probe_ids,
                      schedule sched, sampler_function fn, sampling_policy policy) override;
 
+    void add_bulk_sampler(sampler_association_handle h, cell_member_predicate probe_ids,
+                          schedule sched, bulk_sampler_function fn, sampling_policy policy) override;
+
     void remove_sampler(sampler_association_handle h) override;
 
     void remove_all_samplers() override;
@@ -70,8 +80,11 @@ private:
     // Spike detectors attached to the cell.
     std::vector<cell_member_type> spike_sources_;
 
-    // Spikes that are generated.
+    // Spikes that are generated, unless a sink is set by set_spike_sink().
     std::vector<spike> spikes_;
+    std::vector<spike>* sink_ = nullptr;
+
+    std::vector<spike>& spike_sink() { return sink_? *sink_: spikes_; }
 
     // Event time binning manager.
     std::vector<event_binner> binners_;
@@ -79,8 +92,8 @@ private:
     // List of events to deliver
     std::vector<deliverable_event> staged_events_;
 
-    // Pending samples to be taken.
-    event_queue<sample_event> sample_events_;
+    // Sample events for the lowered cell in the current epoch.
+    std::vector<sample_event> staged_samples_;
 
     // Handles for accessing lowered cell.
     std::vector<target_handle> target_handles_;
@@ -91,6 +104,48 @@ private:
     // Collection of samplers to be run against probes in this group.
     sampler_association_map sampler_map_;
 
+    // The sampling plan: the probe handles of all sampler associations are
+    // set once in the lowered cell, in association order, with the probes
+    // of each association grouped by cell. A sample gather is the run of
+    // the probes of one association on one cell, which are sampled by one
+    // sample event for each sample time. The plan is rebuilt before the
+    // next epoch when associations are added or removed, which may happen
+    // on other threads; it holds its own references to the associations,
+    // so that those removed during an epoch stay valid until it ends.
+
+    struct sample_gather {
+        cell_size_type cell_index;
+        fvm_size_type begin;        // range of probe handles in the plan
+        fvm_size_type end;
+        std::size_t entry;          // index of association in the plan
+    };
+
+    struct sampling_plan_entry {
+        std::shared_ptr<sampler_association> assoc;
+        std::vector<probe_tag> tags; // tags of assoc->probe_ids
+        fvm_size_type begin;         // range of probe handles in the plan
+        fvm_size_type end;
+
+        // Sample times of the association in the current epoch, and the
+        // offset of its first sample in the lowered cell sample arrays.
+        time_event_span sample_times;
+        sample_size_type base_offset;
+    };
+
+    std::vector<sampling_plan_entry> sampling_plan_;
+    std::atomic<bool> sampling_plan_valid_{false};
+
+    // Sample gathers ordered by cell, and the number of sample events staged
+    // for each in the current epoch.
+    std::vector<sample_gather> sample_gathers_;
+    std::vector<sample_size_type> gather_staged_;
+
+    // Heap of (next sample time, gather index) used to merge the sample
+    // times of the gathers on a cell; kept to reuse its storage.
+    std::vector<std::pair<time_type, std::size_t>> gather_heap_;
+
+    void update_sampling_plan();
+
     // Lookup table for target ids -> local target handle indices.
     std::vector<std::size_t> target_handle_divisions_;
 };
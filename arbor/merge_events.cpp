@@ -34,8 +34,9 @@ static constexpr spike_event terminal_pse{cell_member_type{0,0}, terminal_time,
 // event generators than can be counted using an unsigned a complete redesign
 // will be needed.
 
-tourney_tree::tourney_tree(std::vector<event_span>& input):
+tourney_tree::tourney_tree(std::vector<event_span>& input, const event_refill& refill):
     input_(input),
+    refill_(refill),
     n_lanes_(input_.size())
 {
     // Must have at least 1 queue.
@@ -91,6 +92,9 @@ void tourney_tree::pop() {
     if (!in.empty()) {
         ++in.left;
     }
+    if (in.empty() && refill_) {
+        in = refill_(lane);
+    }
 
     event(i) = in.empty()? terminal_pse: in.front();
 
@@ -146,9 +150,9 @@ const spike_event& tourney_tree::event(unsigned i) const {
 
 } // namespace impl
 
-void tree_merge_events(std::vector<event_span>& sources, pse_vector& out) {
+void tree_merge_events(std::vector<event_span>& sources, pse_vector& out, const event_refill& refill) {
     PE(communication_enqueue_tree);
-    impl::tourney_tree tree(sources);
+    impl::tourney_tree tree(sources, refill);
     while (!tree.empty()) {
         out.push_back(tree.head());
         tree.pop();
@@ -156,5 +160,16 @@ void tree_merge_events(std::vector<event_span>& sources, pse_vector& out) {
     PL();
 }
 
+spike_event* tree_merge_events(std::vector<event_span>& sources, spike_event* out, const event_refill& refill) {
+    PE(communication_enqueue_tree);
+    impl::tourney_tree tree(sources, refill);
+    while (!tree.empty()) {
+        *out++ = tree.head();
+        tree.pop();
+    }
+    PL();
+    return out;
+}
+
 } // namespace arb
 
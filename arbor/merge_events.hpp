@@ -1,11 +1,13 @@
 #pragma once
 
+#include <functional>
 #include <iosfwd>
 #include <vector>
 
 #include <arbor/event_generator.hpp>
 #include <arbor/spike_event.hpp>
 
+#include "event_lanes.hpp"
 #include "event_queue.hpp"
 #include "profile/profiler_macro.hpp"
 #include "util/range.hpp"
@@ -14,9 +16,39 @@
 
 namespace arb {
 
-using event_span = util::range<const spike_event*>;
+// Called with the index of a source when all of its events have been
+// merged, to provide its next block of events; an empty block marks the end
+// of the source.
+using event_refill = std::function<event_span (unsigned)>;
 
-void tree_merge_events(std::vector<event_span>& sources, pse_vector& out);
+// Append the merged events to out. If refill is set, sources are refilled
+// by refill when exhausted.
+void tree_merge_events(std::vector<event_span>& sources, pse_vector& out, const event_refill& refill = {});
+
+// Write the merged events to the sequence starting at out, and return the
+// end of the written sequence.
+spike_event* tree_merge_events(std::vector<event_span>& sources, spike_event* out, const event_refill& refill = {});
+
+// Buffers for the tree merge of the events of a cell with generators in
+// [t_from, t_to), which are reused for the cells of a block across epochs:
+// the sources of the merge, and the generator of each source, if any.
+struct generator_merge_buffer {
+    time_type t_from = 0;
+    time_type t_to = 0;
+    std::vector<event_span> sources;
+    std::vector<event_generator*> source_gen;
+};
+
+// Merge the events of one cell for the epoch [t_from, t_to) into new_events:
+// the old events of the cell at or after t_from, the sorted pending events,
+// and the events of its generators in the epoch. Defined in simulation.cpp.
+void merge_cell_events(
+    time_type t_from,
+    time_type t_to,
+    event_span old_events,
+    event_span pending,
+    std::vector<event_generator>& generators,
+    pse_vector& new_events);
 
 namespace impl {
     // The tournament tree is used internally by the merge_events method, and
@@ -26,7 +58,7 @@ namespace impl {
         using key_val = std::pair<unsigned, spike_event>;
 
     public:
-        tourney_tree(std::vector<event_span>& input);
+        tourney_tree(std::vector<event_span>& input, const event_refill& refill = {});
         bool empty() const;
         spike_event head() const;
         void pop();
@@ -48,6 +80,7 @@ namespace impl {
 
         std::vector<key_val> heap_;
         std::vector<event_span>& input_;
+        event_refill refill_;
         unsigned leaves_;
         unsigned nodes_;
         unsigned n_lanes_;
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <arbor/spike.hpp>
+
+#include "merge_spikes.hpp"
+#include "threading/threading.hpp"
+#include "util/span.hpp"
+
+namespace arb {
+
+namespace {
+
+constexpr std::size_t min_part_size = 4096;
+
+// Merge the runs into out with a heap on the first spike of each run.
+void heap_merge(std::vector<spike_span> runs, spike* out) {
+    runs.erase(
+        std::remove_if(runs.begin(), runs.end(), [](const spike_span& r) { return r.empty(); }),
+        runs.end());
+
+    auto greater = [](const spike_span& a, const spike_span& b) {
+        return spike_source_time_less(*b.begin(), *a.begin());
+    };
+    std::make_heap(runs.begin(), runs.end(), greater);
+
+    while (runs.size()>1) {
+        std::pop_heap(runs.begin(), runs.end(), greater);
+        auto& r = runs.back();
+        *out++ = *r.left++;
+        if (r.empty()) {
+            runs.pop_back();
+        }
+        else {
+            std::push_heap(runs.begin(), runs.end(), greater);
+        }
+    }
+    if (!runs.empty()) {
+        std::copy(runs[0].begin(), runs[0].end(), out);
+    }
+}
+
+} // anonymous namespace
+
+void merge_spikes(const std::vector<spike_span>& runs, spike* out, threading::task_system* ts) {
+    const unsigned k = runs.size();
+
+    std::size_t n = 0;
+    for (auto& r: runs) {
+        n += r.size();
+    }
+
+    // Merge in a few parts per thread, of at least min_part_size spikes.
+    const std::size_t nthreads = ts->get_num_threads();
+    const unsigned nparts = nthreads==1? 1: std::max<std::size_t>(1, std::min(4*nthreads, n/min_part_size));
+    if (nparts==1) {
+        heap_merge(runs, out);
+        return;
+    }
+
+    std::vector<spike> sample;
+    for (auto& r: runs) {
+        const auto m = r.size();
+        for (auto j: util::make_span(nparts)) {
+            if (j*m/nparts<m) sample.push_back(r[j*m/nparts]);
+        }
+    }
+    std::sort(sample.begin(), sample.end(), spike_source_time_less);
+
+    // bounds[p*k+i] is the start of part p in run i.
+    std::vector<const spike*> bounds((nparts+1)*k);
+    for (auto i: util::make_span(k)) {
+        bounds[i] = runs[i].begin();
+        bounds[nparts*k+i] = runs[i].end();
+        for (auto p: util::make_span(1u, nparts)) {
+            const auto& splitter = sample[p*sample.size()/nparts];
+            bounds[p*k+i] = std::lower_bound(runs[i].begin(), runs[i].end(), splitter, spike_source_time_less);
+        }
+    }
+
+    threading::parallel_for::apply(0, nparts, 1, ts,
+        [&](int p) {
+            std::vector<spike_span> part;
+            std::size_t offset = 0;
+            for (auto i: util::make_span(k)) {
+                part.push_back({bounds[p*k+i], bounds[(p+1)*k+i]});
+                offset += bounds[p*k+i]-bounds[i];
+            }
+            heap_merge(std::move(part), out+offset);
+        });
+}
+
+} // namespace arb
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+#include <arbor/spike.hpp>
+
+#include "threading/threading.hpp"
+#include "util/range.hpp"
+
+// Merge sorted runs of spikes into a single sorted sequence, in parallel.
+
+namespace arb {
+
+// Local spikes are gathered for exchange in order of source, then time,
+// so that the order does not depend on where each spike was stored.
+inline bool spike_source_time_less(const spike& l, const spike& r) {
+    return l.source<r.source || (l.source==r.source && l.time<r.time);
+}
+
+using spike_span = util::range<const spike*>;
+
+// Merge the runs, each sorted by spike_source_time_less, into out, which
+// must have space for all of their spikes.
+//
+// The output is split into parts by splitter spikes, chosen as quantiles of
+// a sample of the runs, and the parts are merged in parallel.
+void merge_spikes(const std::vector<spike_span>& runs, spike* out, threading::task_system* ts);
+
+} // namespace arb
@@ -0,0 +1,70 @@
+#pragma once
+
+// Philox4x32-10 counter-based random number generator.
+//
+// Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC'11.
+//
+// The generator is a bijection of a 128-bit counter, parameterized by a
+// 64-bit key: the ith random number of a stream is obtained from the counter
+// i alone, so that a stream can be started at any position, and reset, in
+// constant time.
+
+#include <array>
+#include <cstdint>
+
+namespace arb {
+
+struct philox4x32 {
+    using counter_type = std::array<std::uint32_t, 4>;
+    using key_type = std::array<std::uint32_t, 2>;
+
+    static counter_type apply(counter_type c, key_type k) {
+        for (unsigned r = 0; r<10; ++r) {
+            if (r) {
+                k[0] += 0x9E3779B9u;
+                k[1] += 0xBB67AE85u;
+            }
+            const std::uint64_t p0 = std::uint64_t(0xD2511F53u)*c[0];
+            const std::uint64_t p1 = std::uint64_t(0xCD9E8D57u)*c[2];
+            c = {{
+                std::uint32_t(p1>>32)^c[1]^k[0],
+                std::uint32_t(p1),
+                std::uint32_t(p0>>32)^c[3]^k[1],
+                std::uint32_t(p0)
+            }};
+        }
+        return c;
+    }
+
+    // Apply the generator to n counters, held as four arrays of components,
+    // in place. The rounds are applied to all of the counters in turn, so
+    // that the loop over the counters can be vectorized.
+    template <unsigned n>
+    static void apply_n(std::uint32_t (&c0)[n], std::uint32_t (&c1)[n],
+                        std::uint32_t (&c2)[n], std::uint32_t (&c3)[n], key_type k)
+    {
+        for (unsigned r = 0; r<10; ++r) {
+            if (r) {
+                k[0] += 0x9E3779B9u;
+                k[1] += 0xBB67AE85u;
+            }
+            for (unsigned j = 0; j<n; ++j) {
+                const std::uint64_t p0 = std::uint64_t(0xD2511F53u)*c0[j];
+                const std::uint64_t p1 = std::uint64_t(0xCD9E8D57u)*c2[j];
+                const std::uint32_t x0 = std::uint32_t(p1>>32)^c1[j]^k[0];
+                const std::uint32_t x2 = std::uint32_t(p0>>32)^c3[j]^k[1];
+                c0[j] = x0;
+                c1[j] = std::uint32_t(p1);
+                c2[j] = x2;
+                c3[j] = std::uint32_t(p0);
+            }
+        }
+    }
+};
+
+// Convert 64 random bits to a double uniformly distributed in (0, 1].
+inline double uniform_open_closed(std::uint64_t x) {
+    return double((x>>11)+1)*(1./9007199254740992.); // 2^-53
+}
+
+} // namespace arb
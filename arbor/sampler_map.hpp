@@ -6,8 +6,10 @@
  */
 
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include <arbor/common_types.hpp>
 #include <arbor/sampling.hpp>
@@ -18,21 +20,30 @@
 namespace arb {
 
 // An association between a samplers, schedule, and set of probe ids, as provided
-// to e.g. `model::add_sampler()`.
+// to e.g. `model::add_sampler()`. Associations made with `add_bulk_sampler()`
+// have an empty sampler, and a bulk sampler instead.
 
 struct sampler_association {
     schedule sched;
     sampler_function sampler;
     std::vector<cell_member_type> probe_ids;
+    bulk_sampler_function bulk_sampler;
+    sampling_policy policy = sampling_policy::lax;
 };
 
 // Maintain a set of associations paired with handles used for deletion.
+//
+// Associations are held by shared pointer, so that a cell group can keep
+// using those of a snapshot while samplers are removed, e.g. by a sampler
+// callback.
 
 class sampler_association_map {
 public:
+    using association_ptr = std::shared_ptr<sampler_association>;
+
     void add(sampler_association_handle h, sampler_association assoc) {
         std::lock_guard<std::mutex> lock(m_);
-        map_.insert({h, std::move(assoc)});
+        map_.insert({h, std::make_shared<sampler_association>(std::move(assoc))});
     }
 
     void remove(sampler_association_handle h) {
@@ -45,12 +56,23 @@ public:
         map_.clear();
     }
 
+    // The current associations, in iteration order.
+    std::vector<association_ptr> snapshot() {
+        std::lock_guard<std::mutex> lock(m_);
+        std::vector<association_ptr> assocs;
+        assocs.reserve(map_.size());
+        for (auto& p: map_) {
+            assocs.push_back(p.second);
+        }
+        return assocs;
+    }
+
 private:
-    using assoc_map = std::unordered_map<sampler_association_handle, sampler_association>;
+    using assoc_map = std::unordered_map<sampler_association_handle, association_ptr>;
     assoc_map map_;
     std::mutex m_;
 
-    static sampler_association& second(assoc_map::value_type& p) { return p.second; }
+    static sampler_association& second(assoc_map::value_type& p) { return *p.second; }
     auto assoc_view() { return util::transform_view(map_, &sampler_association_map::second); }
 
 public:
@@ -1,11 +1,18 @@
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <iterator>
 #include <numeric>
 #include <utility>
 #include <vector>
 
+#include <arbor/assert.hpp>
 #include <arbor/common_types.hpp>
 #include <arbor/schedule.hpp>
+#include <arbor/simd/simd.hpp>
+
+#include "philox.hpp"
 
 // Implementations for specific schedules.
 
@@ -38,6 +45,59 @@ time_event_span regular_schedule_impl::events(time_type t0, time_type t1) {
     return as_time_event_span(times_);
 }
 
+// The times are generated as in events(), from the start of the interval or
+// the time following the last block, whichever is later.
+time_event_span regular_schedule_impl::stream(time_type t0, time_type t1) {
+    times_.clear();
+
+    t0 = std::max({t0, t0_, stream_from_});
+    t1 = std::min(t1, t1_);
+
+    if (t1>t0) {
+        long long n = t0*oodt_;
+        time_type t = n*dt_;
+
+        while (t<t0) {
+            t = (++n)*dt_;
+        }
+
+        while (t<t1 && times_.size()<schedule_stream_block_size) {
+            times_.push_back(t);
+            t = (++n)*dt_;
+        }
+        stream_from_ = t;
+    }
+
+    return as_time_event_span(times_);
+}
+
+// The number of times that stream() would return: the first index is found
+// as in stream(), and the end index from its closed form, corrected for
+// rounding in the same arithmetic.
+std::size_t regular_schedule_impl::count(time_type t0, time_type t1) const {
+    t0 = std::max({t0, t0_, stream_from_});
+    t1 = std::min(t1, t1_);
+
+    if (!(t1>t0)) {
+        return 0;
+    }
+
+    long long n0 = t0*oodt_;
+    while (n0*dt_<t0) {
+        ++n0;
+    }
+
+    long long n1 = std::max<long long>(n0, t1*oodt_);
+    while (n1>n0 && (n1-1)*dt_>=t1) {
+        --n1;
+    }
+    while (n1*dt_<t1) {
+        ++n1;
+    }
+
+    return n1-n0;
+}
+
 // Explicit schedule implementation.
 
 time_event_span explicit_schedule_impl::events(time_type t0, time_type t1) {
@@ -50,4 +110,151 @@ time_event_span explicit_schedule_impl::events(time_type t0, time_type t1) {
     return {lb, ub};
 }
 
+// Counter-based Poisson schedule implementation.
+
+counter_poisson_schedule_impl::counter_poisson_schedule_impl(time_type tstart, time_type rate_kHz, std::uint64_t seed):
+    tstart_(tstart), rate_(rate_kHz), seed_(seed)
+{
+    arb_assert(tstart_>=0);
+    window_ = rate_>0? events_per_window/rate_: std::numeric_limits<double>::infinity();
+    reset();
+}
+
+void counter_poisson_schedule_impl::reset() {
+    start_window(0);
+}
+
+void counter_poisson_schedule_impl::start_window(std::uint64_t w) {
+    window_index_ = w;
+    draw_ = 0;
+    window_t_ = tstart_+w*window_;
+    window_done_ = false;
+    block_pos_ = 0;
+    block_n_ = 0;
+}
+
+void counter_poisson_schedule_impl::draw_block() {
+    namespace S = simd;
+    constexpr unsigned width = S::simd_abi::native_width<double>::value;
+    using simd_value = S::simd<double, width>;
+    static_assert(block_size%width==0, "block size must be a multiple of the SIMD width");
+
+    if (window_done_) {
+        start_window(window_index_+1);
+    }
+
+    // Each value of the counter gives two uniform variates: the counter is
+    // the index of the pair in the window, and the window.
+    constexpr unsigned n = block_size/2;
+    std::uint32_t c0[n], c1[n], c2[n], c3[n];
+    for (unsigned j = 0; j<n; ++j) {
+        const std::uint64_t i = draw_/2+j;
+        c0[j] = std::uint32_t(i);
+        c1[j] = std::uint32_t(i>>32);
+        c2[j] = std::uint32_t(window_index_);
+        c3[j] = std::uint32_t(window_index_>>32);
+    }
+    philox4x32::apply_n(c0, c1, c2, c3, {{std::uint32_t(seed_), std::uint32_t(seed_>>32)}});
+    draw_ += block_size;
+
+    double u[block_size];
+    for (unsigned j = 0; j<n; ++j) {
+        u[2*j] = uniform_open_closed(std::uint64_t(c0[j])<<32 | c1[j]);
+        u[2*j+1] = uniform_open_closed(std::uint64_t(c2[j])<<32 | c3[j]);
+    }
+
+    // Exponentially distributed intervals.
+    const simd_value scale = -1/rate_;
+    for (unsigned j = 0; j<block_size; j += width) {
+        simd_value x(u+j);
+        x = log(x)*scale;
+        x.copy_to(u+j);
+    }
+
+    const double t_end = tstart_+(window_index_+1)*window_;
+    block_pos_ = 0;
+    block_n_ = 0;
+    for (unsigned j = 0; j<block_size; ++j) {
+        window_t_ += u[j];
+        if (window_t_>=t_end) {
+            window_done_ = true;
+            break;
+        }
+        block_[block_n_++] = window_t_;
+    }
+}
+
+void counter_poisson_schedule_impl::seek(time_type t) {
+    // Jump to the window that contains t, if it is not the current window.
+    if (t>=tstart_+(window_index_+1)*window_) {
+        auto w = std::uint64_t((t-tstart_)/window_);
+        if (tstart_+w*window_>t) --w;
+        start_window(w);
+    }
+
+    while (next()<t) {
+        ++block_pos_;
+    }
+}
+
+time_event_span counter_poisson_schedule_impl::events(time_type t0, time_type t1) {
+    times_.clear();
+
+    if (rate_>0) {
+        seek(t0);
+        for (time_type t; (t = next())<t1; ++block_pos_) {
+            times_.push_back(t);
+        }
+    }
+
+    return as_time_event_span(times_);
+}
+
+time_event_span counter_poisson_schedule_impl::stream(time_type t0, time_type t1) {
+    times_.clear();
+
+    if (rate_>0) {
+        seek(t0);
+        for (time_type t; times_.size()<schedule_stream_block_size && (t = next())<t1; ++block_pos_) {
+            times_.push_back(t);
+        }
+    }
+
+    return as_time_event_span(times_);
+}
+
+// The cursor is moved to t0, as stream() would, and restored after drawing
+// the times in [t0, t1).
+std::size_t counter_poisson_schedule_impl::count(time_type t0, time_type t1) {
+    if (!(rate_>0)) {
+        return 0;
+    }
+
+    seek(t0);
+
+    const auto window_index = window_index_;
+    const auto draw = draw_;
+    const auto window_t = window_t_;
+    const auto window_done = window_done_;
+    const auto block_pos = block_pos_;
+    const auto block_n = block_n_;
+    time_type block[block_size];
+    std::copy(block_, block_+block_size, block);
+
+    std::size_t n = 0;
+    for (; next()<t1; ++block_pos_) {
+        ++n;
+    }
+
+    window_index_ = window_index;
+    draw_ = draw;
+    window_t_ = window_t;
+    window_done_ = window_done;
+    block_pos_ = block_pos;
+    block_n_ = block_n;
+    std::copy(block, block+block_size, block_);
+
+    return n;
+}
+
 } // namespace arb
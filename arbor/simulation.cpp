@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <memory>
 #include <set>
 #include <vector>
@@ -11,8 +12,10 @@
 #include "cell_group.hpp"
 #include "cell_group_factory.hpp"
 #include "communication/communicator.hpp"
+#include "event_lanes.hpp"
+#include "event_sort.hpp"
+#include "group_spike_store.hpp"
 #include "merge_events.hpp"
-#include "thread_private_spike_store.hpp"
 #include "threading/threading.hpp"
 #include "util/double_buffer.hpp"
 #include "util/filter.hpp"
@@ -24,7 +27,7 @@
 namespace arb {
 
 class spike_double_buffer {
-    util::double_buffer<thread_private_spike_store> buffer_;
+    util::double_buffer<group_spike_store> buffer_;
 
 public:
     // Convenience functions that map the spike buffers onto the appropriate
@@ -39,11 +42,11 @@ public:
     //      current:  spikes generated in the current interval
     //      previous: spikes generated in the preceding interval
 
-    spike_double_buffer(thread_private_spike_store l, thread_private_spike_store r):
+    spike_double_buffer(group_spike_store l, group_spike_store r):
             buffer_(std::move(l), std::move(r)) {}
 
-    thread_private_spike_store& current()  { return buffer_.get(); }
-    thread_private_spike_store& previous() { return buffer_.other(); }
+    group_spike_store& current()  { return buffer_.get(); }
+    group_spike_store& previous() { return buffer_.other(); }
     void exchange() { buffer_.exchange(); }
 };
 
@@ -58,6 +61,9 @@ public:
     sampler_association_handle add_sampler(cell_member_predicate probe_ids,
         schedule sched, sampler_function f, sampling_policy policy = sampling_policy::lax);
 
+    sampler_association_handle add_bulk_sampler(cell_member_predicate probe_ids,
+        schedule sched, bulk_sampler_function f, sampling_policy policy = sampling_policy::lax);
+
     void remove_sampler(sampler_association_handle);
 
     void remove_all_samplers();
@@ -66,6 +72,10 @@ public:
         return communicator_.num_spikes();
     }
 
+    spike_volume_stats local_spike_stats() const {
+        return spike_stats_;
+    }
+
     void set_binning_policy(binning_kind policy, time_type bin_interval);
 
     void inject_events(const pse_vector& events);
@@ -78,7 +88,7 @@ private:
     // See comments on implementation for more information.
     void setup_events(time_type t_from, time_type time_to, std::size_t epoch_id);
 
-    std::vector<pse_vector>& event_lanes(std::size_t epoch_id) {
+    event_lane_store& event_lanes(std::size_t epoch_id) {
         return event_lanes_[epoch_id%2];
     }
 
@@ -92,7 +102,17 @@ private:
     // one set of event_generators for each local cell
     std::vector<std::vector<event_generator>> event_generators_;
 
+    // The events of cells with event generators that are not countable are
+    // merged in setup_events() before the lanes are allocated, and staged
+    // here, with one buffer for each block of cells.
+    std::vector<pse_vector> staged_events_;
+
+    // Buffers for merging the events of cells with generators in
+    // setup_events(), one for each block of cells.
+    std::vector<generator_merge_buffer> merge_buffers_;
+
     std::unique_ptr<spike_double_buffer> local_spikes_;
+    spike_volume_stats spike_stats_;
 
     // Hash table for looking up the the local index of a cell with a given gid
     std::unordered_map<cell_gid_type, cell_size_type> gid_to_local_;
@@ -102,8 +122,11 @@ private:
     task_system_handle task_system_;
 
     // Pending events to be delivered.
-    std::array<std::vector<pse_vector>, 2> event_lanes_;
-    std::vector<pse_vector> pending_events_;
+    std::array<event_lane_store, 2> event_lanes_;
+    event_lane_store pending_events_;
+
+    // Sorts the pending events of each cell in setup_events().
+    event_sorter pending_sorter_;
 
     // Sampler associations handles are managed by a helper class.
     util::handle_set<sampler_association_handle> sassoc_handles_;
@@ -129,18 +152,19 @@ simulation_state::simulation_state(
         const domain_decomposition& decomp,
         execution_context ctx
     ):
-    local_spikes_(new spike_double_buffer(thread_private_spike_store(ctx.thread_pool),
-                                          thread_private_spike_store(ctx.thread_pool))),
+    local_spikes_(new spike_double_buffer(group_spike_store(decomp.groups.size(), ctx.thread_pool),
+                                          group_spike_store(decomp.groups.size(), ctx.thread_pool))),
     communicator_(rec, decomp, ctx),
-    task_system_(ctx.thread_pool)
+    task_system_(ctx.thread_pool),
+    pending_sorter_(ctx.thread_pool)
 {
     const auto num_local_cells = communicator_.num_local_cells();
 
     // Cache the minimum delay of the network
     min_delay_ = communicator_.min_delay();
 
-    // Initialize empty buffers for pending events for each local cell
-    pending_events_.resize(num_local_cells);
+    // Initialize empty lanes for pending events for each local cell
+    pending_events_ = event_lane_store(num_local_cells);
 
     event_generators_.resize(num_local_cells);
     cell_local_size_type lidx = 0;
@@ -166,9 +190,9 @@ simulation_state::simulation_state(
 
     // Create event lane buffers.
     // There is one set for each epoch: current (0) and next (1).
-    // For each epoch there is one lane for each cell in the cell group.
-    event_lanes_[0].resize(num_local_cells);
-    event_lanes_[1].resize(num_local_cells);
+    // For each epoch there is one lane for each local cell.
+    event_lanes_[0] = event_lane_store(num_local_cells);
+    event_lanes_[1] = event_lane_store(num_local_cells);
 }
 
 void simulation_state::reset() {
@@ -180,9 +204,7 @@ void simulation_state::reset() {
 
     // Clear all pending events in the event lanes.
     for (auto& lanes: event_lanes_) {
-        for (auto& lane: lanes) {
-            lane.clear();
-        }
+        lanes.clear();
     }
 
     // Reset all event generators.
@@ -192,14 +214,13 @@ void simulation_state::reset() {
         }
     }
 
-    for (auto& lane: pending_events_) {
-        lane.clear();
-    }
+    pending_events_.clear();
 
     communicator_.reset();
 
     local_spikes_->current().clear();
     local_spikes_->previous().clear();
+    spike_stats_ = spike_volume_stats{};
 }
 
 time_type simulation_state::run(time_type tfinal, time_type dt) {
@@ -210,35 +231,71 @@ time_type simulation_state::run(time_type tfinal, time_type dt) {
     // to overlap communication and computation.
     const time_type t_interval = min_delay_/2;
 
-    // task that updates cell state in parallel.
+    // If the communicator does not exchange all spikes, the global set of
+    // spikes is gathered separately for the global export callback. This is
+    // a collective operation, so it is performed if the callback is set on
+    // any domain.
+    const bool gather_global_spikes = !communicator_.exchanges_all_spikes() &&
+        communicator_.any_domain(bool(global_export_callback_));
+
+    // update cell state in parallel.
     auto update_cells = [&] () {
         foreach_group_index(
             [&](cell_group_ptr& group, int i) {
-                auto queues = util::subrange_view(event_lanes(epoch_.id), communicator_.group_queue_range(i));
+                auto r = communicator_.group_queue_range(i);
+                auto queues = event_lanes(epoch_.id).subrange(r.first, r.second);
+                group->set_spike_sink(&local_spikes_->current().sink(i));
                 group->advance(epoch_, dt, queues);
 
                 PE(advance_spikes);
-                local_spikes_->current().insert(group->spikes());
-                group->clear_spikes();
+                local_spikes_->current().sort(i);
                 PL();
             });
     };
 
-    // task that performs spike exchange with the spikes generated in
-    // the previous integration period, generating the postsynaptic
-    // events that must be delivered at the start of the next
-    // integration period at the latest.
-    auto exchange = [&] () {
+    // Spike exchange is split in two phases, so that the collective
+    // communication is overlapped with the cell update:
+    //
+    // start_exchange gathers the spikes generated in the previous
+    // integration period, and starts their exchange.
+    //
+    // complete_exchange waits for the exchange to finish, and generates
+    // the postsynaptic events that must be delivered at the start of the
+    // next integration period at the latest. It is called on the main
+    // thread once the cell update has finished, so that no pool thread
+    // is blocked waiting for the exchange.
+    std::vector<spike> local_spikes;
+
+    auto start_exchange = [&] () {
         PE(communication_exchange_gatherlocal);
-        auto local_spikes = local_spikes_->previous().gather();
+        auto& store = local_spikes_->previous();
+        local_spikes = store.gather();
+        // There are no spikes to exchange before the first interval.
+        if (epoch_.id>0) {
+            store.record(spike_stats_);
+        }
+        store.clear();
         PL();
-        auto global_spikes = communicator_.exchange(local_spikes);
+        communicator_.start_exchange(local_spikes);
 
         PE(communication_spikeio);
         if (local_export_callback_) {
             local_export_callback_(local_spikes);
         }
-        if (global_export_callback_) {
+        PL();
+    };
+
+    auto complete_exchange = [&] () {
+        auto global_spikes = communicator_.complete_exchange();
+
+        PE(communication_spikeio);
+        if (gather_global_spikes) {
+            auto all_spikes = communicator_.gather_spikes(local_spikes);
+            if (global_export_callback_) {
+                global_export_callback_(all_spikes.values());
+            }
+        }
+        else if (global_export_callback_) {
             global_export_callback_(global_spikes.values());
         }
         PL();
@@ -262,12 +319,9 @@ time_type simulation_state::run(time_type tfinal, time_type dt) {
         // these buffers will store the new spikes generated in update_cells.
         local_spikes_->current().clear();
 
-        // run the tasks, overlapping if the threading model and number of
-        // available threads permits it.
-        threading::task_group g(task_system_.get());
-        g.run(exchange);
-        g.run(update_cells);
-        g.wait();
+        start_exchange();
+        update_cells();
+        complete_exchange();
 
         t_ = tuntil;
 
@@ -277,7 +331,12 @@ time_type simulation_state::run(time_type tfinal, time_type dt) {
 
     // Run the exchange one last time to ensure that all spikes are output to file.
     local_spikes_->exchange();
-    exchange();
+    start_exchange();
+    complete_exchange();
+
+    // The global spike count is reduced once per run in the sparse exchange
+    // mode, rather than with a collective in every epoch.
+    communicator_.reduce_num_spikes();
 
     return t_;
 }
@@ -291,56 +350,134 @@ auto split_sorted_range(Seq&& seq, const Value& v, Less cmp = Less{}) {
         util::make_range(it, seq.end()));
 }
 
-// Populate the event lanes for epoch+1 (i.e event_lanes_[epoch+1)]
-// Update each lane in parallel, if supported by the threading backend.
-// On completion event_lanes[epoch+1] will contain sorted lists of events with
-// delivery times due in or after epoch+1. The events will be taken from the
-// following sources:
-//      event_lanes[epoch]: take all events ≥ t_from
-//      event_generators  : take all events < t_to
-//      pending_events    : take all events
+// Number of events in the lane for the next epoch of a cell without event
+// generators.
+std::size_t count_cell_events(
+    time_type t_from,
+    event_span old_events,
+    event_span pending)
+{
+    old_events = split_sorted_range(old_events, t_from, event_time_less()).second;
+    return old_events.size()+pending.size();
+}
 
-// merge_cell_events() is a separate function for unit testing purposes.
+// Merge the events of a cell without event generators into the sequence
+// starting at out, which must hold count_cell_events() events.
 void merge_cell_events(
     time_type t_from,
-    time_type t_to,
     event_span old_events,
     event_span pending,
-    std::vector<event_generator>& generators,
-    pse_vector& new_events)
+    spike_event* out)
 {
-    PE(communication_enqueue_setup);
-    new_events.clear();
+    PE(communication_enqueue_merge);
     old_events = split_sorted_range(old_events, t_from, event_time_less()).second;
+    std::merge(pending.begin(), pending.end(), old_events.begin(), old_events.end(), out);
     PL();
+}
 
-    if (!generators.empty()) {
-        PE(communication_enqueue_setup);
-        // Tree-merge events in [t_from, t_to) from old, pending and generator events.
-
-        std::vector<event_span> spanbuf;
-        spanbuf.reserve(2+generators.size());
+// Number of events in the lane for the next epoch of a cell with generators
+// that are all countable.
+std::size_t count_cell_events(
+    time_type t_from,
+    time_type t_to,
+    event_span old_events,
+    event_span pending,
+    std::vector<event_generator>& generators)
+{
+    std::size_t n = count_cell_events(t_from, old_events, pending);
+    for (auto& g: generators) {
+        n += g.count(t_from, t_to);
+    }
+    return n;
+}
 
-        auto old_split = split_sorted_range(old_events, t_to, event_time_less());
-        auto pending_split = split_sorted_range(pending, t_to, event_time_less());
+bool countable(const std::vector<event_generator>& generators) {
+    return std::all_of(generators.begin(), generators.end(),
+        [](const event_generator& g) { return g.countable(); });
+}
 
-        spanbuf.push_back(old_split.first);
-        spanbuf.push_back(pending_split.first);
+// Refill a source of the tree merge with the next block of events of its
+// generator, if any.
+event_refill generator_refill(generator_merge_buffer& buf) {
+    return [&buf](unsigned i) {
+        auto g = buf.source_gen[i];
+        return g? event_span(g->stream(buf.t_from, buf.t_to)): event_span();
+    };
+}
 
-        for (auto& g: generators) {
-            event_span evs = g.events(t_from, t_to);
-            if (!evs.empty()) {
-                spanbuf.push_back(evs);
-            }
+// Set up the sources of the tree merge of the events of a cell with
+// generators: the old and pending events before t_to, and the first block of
+// events of each generator. The old and pending events at or after t_to are
+// left in old_events and pending.
+//
+// The events of the generators are streamed into the tree merge in blocks,
+// so that they are not stored other than in the output of the merge.
+void setup_generator_merge(
+    event_span& old_events,
+    event_span& pending,
+    std::vector<event_generator>& generators,
+    generator_merge_buffer& buf)
+{
+    PE(communication_enqueue_setup);
+    auto old_split = split_sorted_range(old_events, buf.t_to, event_time_less());
+    auto pending_split = split_sorted_range(pending, buf.t_to, event_time_less());
+
+    buf.sources.clear();
+    buf.sources.push_back(old_split.first);
+    buf.sources.push_back(pending_split.first);
+    buf.source_gen.assign(2, nullptr);
+
+    for (auto& g: generators) {
+        auto evs = g.stream(buf.t_from, buf.t_to);
+        if (evs.first!=evs.second) {
+            buf.sources.push_back(evs);
+            buf.source_gen.push_back(&g);
         }
-        PL();
+    }
 
-        PE(communication_enqueue_tree);
-        tree_merge_events(spanbuf, new_events);
-        PL();
+    old_events = old_split.second;
+    pending = pending_split.second;
+    PL();
+}
+
+// Merge the events of a cell with generators into the sequence starting at
+// out, which must hold count_cell_events() events.
+void merge_cell_events(
+    event_span old_events,
+    event_span pending,
+    std::vector<event_generator>& generators,
+    generator_merge_buffer& buf,
+    const event_refill& refill,
+    spike_event* out)
+{
+    PE(communication_enqueue_setup);
+    old_events = split_sorted_range(old_events, buf.t_from, event_time_less()).second;
+    PL();
+
+    setup_generator_merge(old_events, pending, generators, buf);
+    out = tree_merge_events(buf.sources, out, refill);
 
-        old_events = old_split.second;
-        pending = pending_split.second;
+    PE(communication_enqueue_merge);
+    std::merge(pending.begin(), pending.end(), old_events.begin(), old_events.end(), out);
+    PL();
+}
+
+// Append the events of a cell for the next epoch to new_events.
+void append_cell_events(
+    event_span old_events,
+    event_span pending,
+    std::vector<event_generator>& generators,
+    generator_merge_buffer& buf,
+    const event_refill& refill,
+    pse_vector& new_events)
+{
+    PE(communication_enqueue_setup);
+    old_events = split_sorted_range(old_events, buf.t_from, event_time_less()).second;
+    PL();
+
+    if (!generators.empty()) {
+        setup_generator_merge(old_events, pending, generators, buf);
+        tree_merge_events(buf.sources, new_events, refill);
     }
 
     // Merge (remaining) old and pending events.
@@ -351,20 +488,109 @@ void merge_cell_events(
     PL();
 }
 
+// merge_cell_events() into a vector is a separate function for unit testing
+// purposes.
+void merge_cell_events(
+    time_type t_from,
+    time_type t_to,
+    event_span old_events,
+    event_span pending,
+    std::vector<event_generator>& generators,
+    pse_vector& new_events)
+{
+    generator_merge_buffer buf;
+    buf.t_from = t_from;
+    buf.t_to = t_to;
+
+    new_events.clear();
+    append_cell_events(old_events, pending, generators, buf, generator_refill(buf), new_events);
+}
+
+// Populate the event lanes for epoch+1 (i.e event_lanes_[epoch+1)]
+// Update each lane in parallel, if supported by the threading backend.
+// On completion event_lanes[epoch+1] will contain sorted lists of events with
+// delivery times due in or after epoch+1. The events will be taken from the
+// following sources:
+//      event_lanes[epoch]: take all events ≥ t_from
+//      event_generators  : take all events < t_to
+//      pending_events    : take all events
+//
+// The lanes are filled in two passes over blocks of cells. The first pass
+// sorts the pending events and counts the events of each lane. The second
+// pass merges the events of each cell directly into its lane.
+//
+// The events of cells with generators that are not all countable, such as
+// Poisson schedules drawn from a sequential engine, can not be counted before
+// they are drawn: these are merged in the first pass, into the staging buffer
+// of the block, and copied into their lanes in the second pass.
 void simulation_state::setup_events(time_type t_from, time_type t_to, std::size_t epoch) {
-    const auto n = communicator_.num_local_cells();
-    threading::parallel_for::apply(0, n, task_system_.get(),
-        [&](cell_size_type i) {
-            PE(communication_enqueue_sort);
-            util::sort(pending_events_[i]);
-            PL();
-
-            event_span pending = util::range_pointer_view(pending_events_[i]);
-            event_span old_events = util::range_pointer_view(event_lanes(epoch)[i]);
-
-            merge_cell_events(t_from, t_to, old_events, pending, event_generators_[i], event_lanes(epoch+1)[i]);
-            pending_events_[i].clear();
-            });
+    const cell_size_type n = communicator_.num_local_cells();
+    const auto& old_lanes = event_lanes(epoch);
+    auto& new_lanes = event_lanes(epoch+1);
+
+    const cell_size_type n_blocks = std::min<cell_size_type>(n, 8*task_system_->get_num_threads());
+    auto block = [&](cell_size_type b) {
+        return util::make_span(std::uint64_t(b)*n/n_blocks, std::uint64_t(b+1)*n/n_blocks);
+    };
+    staged_events_.resize(n_blocks);
+    merge_buffers_.resize(n_blocks);
+
+    new_lanes.clear();
+    threading::parallel_for::apply(0, n_blocks, task_system_.get(),
+        [&](cell_size_type b) {
+            auto& staged = staged_events_[b];
+            staged.clear();
+
+            auto& buf = merge_buffers_[b];
+            buf.t_from = t_from;
+            buf.t_to = t_to;
+            auto refill = generator_refill(buf);
+
+            for (cell_size_type i: block(b)) {
+                PE(communication_enqueue_sort);
+                pending_sorter_.sort(pending_events_.lane(i));
+                PL();
+
+                auto& generators = event_generators_[i];
+                if (generators.empty()) {
+                    new_lanes.add_count(i, count_cell_events(t_from, old_lanes[i], pending_events_[i]));
+                }
+                else if (countable(generators)) {
+                    new_lanes.add_count(i, count_cell_events(t_from, t_to, old_lanes[i], pending_events_[i], generators));
+                }
+                else {
+                    auto k = staged.size();
+                    append_cell_events(old_lanes[i], pending_events_[i], generators, buf, refill, staged);
+                    new_lanes.add_count(i, staged.size()-k);
+                }
+            }
+        });
+
+    new_lanes.allocate();
+    threading::parallel_for::apply(0, n_blocks, task_system_.get(),
+        [&](cell_size_type b) {
+            auto staged = staged_events_[b].begin();
+
+            auto& buf = merge_buffers_[b];
+            auto refill = generator_refill(buf);
+
+            for (cell_size_type i: block(b)) {
+                auto lane = new_lanes.lane(i);
+                auto& generators = event_generators_[i];
+                if (generators.empty()) {
+                    merge_cell_events(t_from, old_lanes[i], pending_events_[i], lane.begin());
+                }
+                else if (countable(generators)) {
+                    merge_cell_events(old_lanes[i], pending_events_[i], generators, buf, refill, lane.begin());
+                }
+                else {
+                    std::copy(staged, staged+lane.size(), lane.begin());
+                    staged += lane.size();
+                }
+            }
+        });
+
+    pending_events_.clear();
 }
 
 sampler_association_handle simulation_state::add_sampler(
@@ -381,6 +607,20 @@ sampler_association_handle simulation_state::add_sampler(
     return h;
 }
 
+sampler_association_handle simulation_state::add_bulk_sampler(
+        cell_member_predicate probe_ids,
+        schedule sched,
+        bulk_sampler_function f,
+        sampling_policy policy)
+{
+    sampler_association_handle h = sassoc_handles_.acquire();
+
+    foreach_group(
+        [&](cell_group_ptr& group) { group->add_bulk_sampler(h, probe_ids, sched, f, policy); });
+
+    return h;
+}
+
 void simulation_state::remove_sampler(sampler_association_handle h) {
     foreach_group(
         [h](cell_group_ptr& group) { group->remove_sampler(h); });
@@ -401,17 +641,38 @@ void simulation_state::set_binning_policy(binning_kind policy, time_type bin_int
 }
 
 void simulation_state::inject_events(const pse_vector& events) {
-    // Push all events that are to be delivered to local cells into the
-    // pending event list for the event's target cell.
+    // Append all events that are to be delivered to local cells to the
+    // pending event lane for the event's target cell. Events are injected
+    // rarely, so the pending lanes are rebuilt.
+    std::vector<std::pair<cell_size_type, spike_event>> local_events;
     for (auto& e: events) {
         if (e.time<t_) {
             throw bad_event_time(e.time, t_);
         }
         // gid_to_local_ maps gid to index into local set of cells.
         if (auto lidx = util::value_by_key(gid_to_local_, e.target.gid)) {
-            pending_events_[*lidx].push_back(e);
+            local_events.push_back({*lidx, e});
         }
     }
+
+    const auto n = pending_events_.size();
+    event_lane_store lanes(n);
+    for (auto i: util::make_span(n)) {
+        lanes.add_count(i, pending_events_[i].size());
+    }
+    for (auto& e: local_events) {
+        lanes.add_count(e.first, 1);
+    }
+    lanes.allocate();
+
+    std::vector<spike_event*> cursor(n);
+    for (auto i: util::make_span(n)) {
+        cursor[i] = std::copy(pending_events_[i].begin(), pending_events_[i].end(), lanes.lane(i).begin());
+    }
+    for (auto& e: local_events) {
+        *cursor[e.first]++ = e.second;
+    }
+    pending_events_ = std::move(lanes);
 }
 
 // Simulation class implementations forward to implementation class.
@@ -441,6 +702,15 @@ sampler_association_handle simulation::add_sampler(
     return impl_->add_sampler(std::move(probe_ids), std::move(sched), std::move(f), policy);
 }
 
+sampler_association_handle simulation::add_bulk_sampler(
+    cell_member_predicate probe_ids,
+    schedule sched,
+    bulk_sampler_function f,
+    sampling_policy policy)
+{
+    return impl_->add_bulk_sampler(std::move(probe_ids), std::move(sched), std::move(f), policy);
+}
+
 void simulation::remove_sampler(sampler_association_handle h) {
     impl_->remove_sampler(h);
 }
@@ -453,6 +723,10 @@ std::size_t simulation::num_spikes() const {
     return impl_->num_spikes();
 }
 
+spike_volume_stats simulation::local_spike_stats() const {
+    return impl_->local_spike_stats();
+}
+
 void simulation::set_binning_policy(binning_kind policy, time_type bin_interval) {
     impl_->set_binning_policy(policy, bin_interval);
 }
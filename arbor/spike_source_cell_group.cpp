@@ -37,7 +37,7 @@ void spike_source_cell_group::advance(epoch ep, time_type dt, const event_lane_s
         const auto gid = gids_[i];
 
         for (auto t: util::make_range(time_sequences_[i].events(t_, ep.tfinal))) {
-            spikes_.push_back({{gid, 0u}, t});
+            spike_sink().push_back({{gid, 0u}, t});
         }
     }
     t_ = ep.tfinal;
@@ -54,12 +54,16 @@ void spike_source_cell_group::reset() {
     clear_spikes();
 }
 
+void spike_source_cell_group::set_spike_sink(std::vector<spike>* sink) {
+    sink_ = sink;
+}
+
 const std::vector<spike>& spike_source_cell_group::spikes() const {
-    return spikes_;
+    return sink_? *sink_: spikes_;
 }
 
 void spike_source_cell_group::clear_spikes() {
-    spikes_.clear();
+    spike_sink().clear();
 }
 
 void spike_source_cell_group::add_sampler(sampler_association_handle, cell_member_predicate, schedule, sampler_function, sampling_policy) {
@@ -25,6 +25,8 @@ public:
 
     void set_binning_policy(binning_kind policy, time_type bin_interval) override {}
 
+    void set_spike_sink(std::vector<spike>* sink) override;
+
     const std::vector<spike>& spikes() const override;
 
     void clear_spikes() override;
@@ -36,8 +38,12 @@ public:
     void remove_all_samplers() override {}
 
 private:
+    // The sink set by set_spike_sink(), or spikes_.
+    std::vector<spike>& spike_sink() { return sink_? *sink_: spikes_; }
+
     time_type t_ = 0;
     std::vector<spike> spikes_;
+    std::vector<spike>* sink_ = nullptr;
     std::vector<cell_gid_type> gids_;
     std::vector<schedule> time_sequences_;
 };
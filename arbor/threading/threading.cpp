@@ -8,110 +8,199 @@ using namespace arb::threading::impl;
 using namespace arb::threading;
 using namespace arb;
 
-task notification_queue::try_pop() {
-    task tsk;
-    lock q_lock{q_mutex_, std::try_to_lock};
-    if (q_lock && !q_tasks_.empty()) {
-        tsk = std::move(q_tasks_.front());
-        q_tasks_.pop_front();
+namespace {
+// Identifies the task system (if any) for which the current thread is a worker.
+struct worker_identity {
+    const task_system* system = nullptr;
+    int index = -1;
+};
+
+thread_local worker_identity this_worker;
+} // anonymous namespace
+
+void* task_arena::allocate(std::size_t n) {
+    n = (n+alignment-1)/alignment*alignment;
+
+    if (n>block_size) {
+        large_.emplace_back(new char[n]);
+        return large_.back().get();
     }
-    return tsk;
-}
 
-task notification_queue::pop() {
-    task tsk;
-    lock q_lock{q_mutex_};
-    while (q_tasks_.empty() && !quit_) {
-        q_tasks_available_.wait(q_lock);
+    if (n>available_) {
+        if (block_==blocks_.size()) {
+            blocks_.emplace_back(new char[block_size]);
+        }
+        next_ = blocks_[block_++].get();
+        available_ = block_size;
     }
-    if (!q_tasks_.empty()) {
-        tsk = std::move(q_tasks_.front());
-        q_tasks_.pop_front();
+
+    void* p = next_;
+    next_ += n;
+    available_ -= n;
+    return p;
+}
+
+void task_arena::clear() {
+    while (head_) {
+        task_base* next = head_->next_;
+        head_->~task_base();
+        head_ = next;
     }
-    return tsk;
+    large_.clear();
+    block_ = 0;
+    next_ = reinterpret_cast<char*>(&inline_);
+    available_ = inline_size;
 }
 
-bool notification_queue::try_push(task& tsk) {
-    {
-        lock q_lock{q_mutex_, std::try_to_lock};
-        if (!q_lock) return false;
-        q_tasks_.push_back(std::move(tsk));
-        tsk = 0;
+bool backoff::operator()() {
+    if (round<spin_rounds) {
+        for (unsigned k = 0; k<(1u<<round); ++k) {
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        }
+    }
+    else if (round<yield_rounds) {
+        std::this_thread::yield();
     }
-    q_tasks_available_.notify_all();
+    else {
+        return false;
+    }
+    ++round;
     return true;
 }
 
-void notification_queue::push(task&& tsk) {
-    {
-        lock q_lock{q_mutex_};
-        q_tasks_.push_back(std::move(tsk));
+int task_system::current_index() const {
+    if (this_worker.system==this) return this_worker.index;
+    if (std::this_thread::get_id()==main_thread_id_) return 0;
+    return -1;
+}
+
+task_base* task_system::find_task(int i) {
+    task_base* tsk = nullptr;
+
+    if (i>=0 && (tsk = deques_[i]->pop())) return tsk;
+
+    if (num_injected_.load(std::memory_order_relaxed)) {
+        lock q_lock{injected_mutex_};
+        if (!injected_.empty()) {
+            tsk = injected_.front();
+            injected_.pop_front();
+            --num_injected_;
+            return tsk;
+        }
     }
-    q_tasks_available_.notify_all();
+
+    unsigned first = i>=0? i+1: 0;
+    for (unsigned n = 0; n != count_; n++) {
+        auto victim = (first + n) % count_;
+        if ((int)victim==i) continue;
+        if ((tsk = deques_[victim]->steal())) return tsk;
+    }
+    return nullptr;
 }
 
-void notification_queue::quit() {
-    {
-        lock q_lock{q_mutex_};
-        quit_ = true;
+bool task_system::work_available() const {
+    if (num_injected_.load()) return true;
+    for (auto& d: deques_) {
+        if (!d->empty()) return true;
+    }
+    return false;
+}
+
+void task_system::notify() {
+    // Pairs with the increment of num_parked_ in park(): either the
+    // parking thread sees the new task, or we see the parked thread.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (num_parked_.load()) {
+        lock p_lock{park_mutex_};
+        park_cv_.notify_one();
+    }
+}
+
+void task_system::park() {
+    lock p_lock{park_mutex_};
+    ++num_parked_;
+    if (!quit_ && !work_available()) {
+        park_cv_.wait(p_lock);
     }
-    q_tasks_available_.notify_all();
+    --num_parked_;
 }
 
 void task_system::run_tasks_loop(int i){
+    this_worker.system = this;
+    this_worker.index = i;
+
+    backoff idle;
     while (true) {
-        task tsk;
-        for (unsigned n = 0; n != count_; n++) {
-            tsk = q_[(i + n) % count_].try_pop();
-            if (tsk) break;
+        if (auto tsk = find_task(i)) {
+            tsk->execute();
+            idle.reset();
+        }
+        else if (quit_) {
+            break;
+        }
+        else if (!idle()) {
+            park();
+            idle.reset();
         }
-        if (!tsk) tsk = q_[i].pop();
-        if (!tsk) break;
-        tsk();
     }
 }
 
 void task_system::try_run_task() {
-    auto nthreads = get_num_threads();
-    task tsk;
-    for (int n = 0; n != nthreads; n++) {
-        tsk = q_[n % nthreads].try_pop();
-        if (tsk) {
-            tsk();
-            break;
-        }
+    if (auto tsk = find_task(current_index())) {
+        tsk->execute();
     }
 }
 
 task_system::task_system(): task_system(num_threads_init()) {}
 
-task_system::task_system(int nthreads): count_(nthreads), q_(nthreads) {
+task_system::task_system(int nthreads): count_(nthreads) {
     if (nthreads <= 0)
         throw std::runtime_error("Non-positive number of threads in thread pool");
 
+    for (unsigned i = 0; i < count_; i++) {
+        deques_.emplace_back(new work_stealing_deque<task_base>());
+    }
+
     // Main thread
-    auto tid = std::this_thread::get_id();
-    thread_ids_[tid] = 0;
+    main_thread_id_ = std::this_thread::get_id();
+    thread_ids_[main_thread_id_] = 0;
 
     for (unsigned i = 1; i < count_; i++) {
         threads_.emplace_back([this, i]{run_tasks_loop(i);});
-        tid = threads_.back().get_id();
+        auto tid = threads_.back().get_id();
         thread_ids_[tid] = i;
     }
 }
 
 task_system::~task_system() {
-    for (auto& e: q_) e.quit();
+    {
+        lock p_lock{park_mutex_};
+        quit_ = true;
+    }
+    park_cv_.notify_all();
     for (auto& e: threads_) e.join();
+
+    // Finish any remaining detached tasks.
+    while (auto tsk = find_task(0)) {
+        tsk->execute();
+    }
 }
 
 void task_system::async(task tsk) {
-    auto i = index_++;
+    submit(new detached_task<task>(std::move(tsk)));
+}
 
-    for (unsigned n = 0; n != count_; n++) {
-        if (q_[(i + n) % count_].try_push(tsk)) return;
+void task_system::submit(task_base* tsk) {
+    auto i = current_index();
+    if (i>=0) {
+        deques_[i]->push(tsk);
+    }
+    else {
+        lock q_lock{injected_mutex_};
+        injected_.push_back(tsk);
+        ++num_injected_;
     }
-    q_[i % count_].push(std::move(tsk));
+    notify();
 }
 
 int task_system::get_num_threads() {
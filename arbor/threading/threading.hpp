@@ -7,15 +7,21 @@
 #include <cstddef>
 #include <deque>
 #include <functional>
+#include <iterator>
+#include <memory>
 #include <mutex>
+#include <new>
 #include <string>
 #include <thread>
+#include <type_traits>
 #include <vector>
 #include <unordered_map>
 #include <utility>
 
 #include <arbor/execution_context.hpp>
 
+#include "threading/work_stealing_deque.hpp"
+
 namespace arb {
 namespace threading {
 
@@ -28,31 +34,100 @@ using std::condition_variable;
 using task = std::function<void()>;
 
 namespace impl {
-class notification_queue {
-private:
-    // FIFO of pending tasks.
-    std::deque<task> q_tasks_;
 
-    // Lock and signal on task availability change this is the crucial bit.
-    mutex q_mutex_;
-    condition_variable q_tasks_available_;
+// Type-erased unit of work held by the scheduler. Tasks are referenced by
+// pointer in the work-stealing deques, so the scheduler itself never
+// allocates on the task submission path.
+struct task_base {
+    virtual void execute() = 0;
+    virtual ~task_base() = default;
 
-    // Flag to handle exit from all threads.
-    bool quit_ = false;
+    // Intrusive link used by task_arena for deferred destruction.
+    task_base* next_ = nullptr;
+};
+
+// Task owned by an arena: executed once, destroyed by the arena.
+template <typename F>
+struct task_node: task_base {
+    F f;
+
+    explicit task_node(F&& other): f(std::move(other)) {}
+
+    void execute() override { f(); }
+};
+
+// Heap-allocated task that deletes itself after execution; used for
+// tasks submitted through task_system::async that are not tied to a group.
+template <typename F>
+struct detached_task: task_base {
+    F f;
+
+    explicit detached_task(F&& other): f(std::move(other)) {}
+
+    void execute() override {
+        f();
+        delete this;
+    }
+};
+
+// Bump allocator for the tasks of a task_group. Memory is handed out first
+// from a small buffer inside the arena, then from fixed size blocks that are
+// retained across clear(), so that a task group that is reused (e.g. each
+// epoch) does not allocate once warmed up, and short-lived groups with only
+// a few tasks never allocate.
+//
+// Not thread safe: tasks must be created by a single thread, and clear()
+// may only be called once all allocated tasks have completed.
+class task_arena {
+    static constexpr std::size_t alignment = alignof(std::max_align_t);
+    static constexpr std::size_t inline_size = 256;
+    static constexpr std::size_t block_size = 4096;
+
+    typename std::aligned_storage<inline_size, alignment>::type inline_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    std::vector<std::unique_ptr<char[]>> large_;
+    std::size_t block_ = 0;      // number of blocks in use
+    char* next_ = reinterpret_cast<char*>(&inline_);
+    std::size_t available_ = inline_size;
+    task_base* head_ = nullptr;
+
+    void* allocate(std::size_t n);
 
 public:
-    // Pops a task from the task queue returns false when queue is empty.
-    task try_pop();
-    task pop();
+    task_arena() = default;
+    task_arena(const task_arena&) = delete;
+    task_arena& operator=(const task_arena&) = delete;
+
+    ~task_arena() { clear(); }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(alignof(T)<=alignment, "over-aligned task type");
+        T* t = new (allocate(sizeof(T))) T(std::forward<Args>(args)...);
+        t->next_ = head_;
+        head_ = t;
+        return t;
+    }
+
+    // Destroy all tasks and recycle the storage.
+    void clear();
+};
 
-    // Pushes a task into the task queue and increases task group counter.
-    void push(task&& tsk); // TODO: need to use value?
-    bool try_push(task& tsk);
+// Idle workers spin with exponentially increasing back off, then yield,
+// before parking on the task system's condition variable.
+struct backoff {
+    static constexpr unsigned spin_rounds = 6;
+    static constexpr unsigned yield_rounds = 16;
 
-    // Finish popping all waiting tasks on queue then stop trying to pop new tasks
-    void quit();
+    unsigned round = 0;
+
+    // Returns false when the caller should park.
+    bool operator()();
+
+    void reset() { round = 0; }
 };
-}// namespace impl
+
+} // namespace impl
 
 class task_system {
 private:
@@ -60,14 +135,41 @@ private:
 
     std::vector<std::thread> threads_;
 
-    // queue of tasks
-    std::vector<impl::notification_queue> q_;
+    // Per-thread work-stealing deques; deque i is owned by thread i, where
+    // index 0 is the thread that constructed the task_system.
+    std::vector<std::unique_ptr<impl::work_stealing_deque<impl::task_base>>> deques_;
+
+    // Tasks submitted from threads that do not belong to the task system.
+    std::deque<impl::task_base*> injected_;
+    std::atomic<std::size_t> num_injected_{0};
+    mutex injected_mutex_;
+
+    // Parking of idle worker threads.
+    std::atomic<unsigned> num_parked_{0};
+    mutex park_mutex_;
+    condition_variable park_cv_;
+
+    // Flag to handle exit from all threads.
+    std::atomic<bool> quit_{false};
 
     // threads -> index
     std::unordered_map<std::thread::id, std::size_t> thread_ids_;
+    std::thread::id main_thread_id_;
+
+    // Index of the calling thread in the task system, or -1.
+    int current_index() const;
+
+    // Find a task: pop from own deque, then take injected tasks, then steal.
+    impl::task_base* find_task(int i);
 
-    // total number of tasks pushed in all queues
-    std::atomic<unsigned> index_{0};
+    // Is there any work visible to an idle thread?
+    bool work_available() const;
+
+    // Wake a parked worker, if any.
+    void notify();
+
+    // Block worker until work is available or the task system quits.
+    void park();
 
 public:
     task_system();
@@ -80,9 +182,13 @@ public:
 
     ~task_system();
 
-    // Pushes tasks into notification queue.
+    // Wraps task in a self-deleting task object and submits it.
     void async(task tsk);
 
+    // Push task onto the deque of the calling thread. The task must
+    // remain valid until it has been executed.
+    void submit(impl::task_base* tsk);
+
     // Runs tasks until quit is true.
     void run_tasks_loop(int i);
 
@@ -153,6 +259,8 @@ private:
     /// We use a raw pointer here instead of a shared_ptr to avoid a race condition
     /// on the destruction of a task_system that would lead to a thread trying to join itself
     task_system* task_system_;
+    // Storage for the tasks of this group, recycled on each wait().
+    impl::task_arena arena_;
 
 public:
     task_group(task_system* ts):
@@ -202,10 +310,12 @@ public:
         return wrap<callable<F>>(std::forward<F>(f), c);
     }
 
+    // Tasks must be added to a group from a single thread.
     template<typename F>
     void run(F&& f) {
+        using node = impl::task_node<wrap<callable<F>>>;
         ++in_flight_;
-        task_system_->async(make_wrapped_function(std::forward<F>(f), in_flight_));
+        task_system_->submit(arena_.make<node>(make_wrapped_function(std::forward<F>(f), in_flight_)));
     }
 
     // wait till all tasks in this group are done
@@ -213,6 +323,7 @@ public:
         while (in_flight_) {
             task_system_->try_run_task();
         }
+        arena_.clear();
     }
 
     // Make sure that all tasks are done before clean up
@@ -224,15 +335,138 @@ public:
 ///////////////////////////////////////////////////////////////////////
 // algorithms
 ///////////////////////////////////////////////////////////////////////
+namespace impl {
+
+// Apply f(first, last) to subranges of [left, right) of at most grain
+// indices. The range is split recursively: at each level the upper half is
+// spawned as a task and the lower half is processed by the calling thread,
+// so that idle threads steal large chunks first.
+template <typename F>
+void parallel_for_range(int left, int right, int grain, task_system* ts, const F& f) {
+    task_group g(ts);
+    while (right-left>grain) {
+        int mid = left+(right-left)/2;
+        g.run([=, &f] { parallel_for_range(mid, right, grain, ts, f); });
+        right = mid;
+    }
+    f(left, right);
+    g.wait();
+}
+
+template <typename T, typename F, typename Op>
+T parallel_reduce_range(int left, int right, int grain, task_system* ts, const T& identity, const F& f, const Op& op) {
+    if (right-left<=grain) {
+        T acc = identity;
+        for (int i = left; i < right; ++i) {
+            acc = op(acc, f(i));
+        }
+        return acc;
+    }
+
+    int mid = left+(right-left)/2;
+    T upper = identity;
+    task_group g(ts);
+    g.run([&] { upper = parallel_reduce_range(mid, right, grain, ts, identity, f, op); });
+    T lower = parallel_reduce_range(left, mid, grain, ts, identity, f, op);
+    g.wait();
+    return op(lower, upper);
+}
+
+template <typename RandomIt, typename Less>
+void parallel_sort_range(RandomIt first, RandomIt last, std::ptrdiff_t grain, task_system* ts, const Less& less) {
+    auto n = last-first;
+    if (n<=grain) {
+        std::sort(first, last, less);
+        return;
+    }
+
+    auto mid = first+n/2;
+    task_group g(ts);
+    g.run([=, &less] { parallel_sort_range(mid, last, grain, ts, less); });
+    parallel_sort_range(first, mid, grain, ts, less);
+    g.wait();
+    std::inplace_merge(first, mid, last, less);
+}
+
+} // namespace impl
+
 struct parallel_for {
+    // Grain size for a range of n indices that gives each thread a few
+    // chunks, enough for stealing to balance uneven work. With one thread
+    // the whole range is a single chunk.
+    static int auto_grain(int n, task_system* ts) {
+        const int nthreads = ts->get_num_threads();
+        if (nthreads==1) return std::max(n, 1);
+        return std::max(n/(8*nthreads), 1);
+    }
+
+    // Apply f(first, last) over disjoint subranges [first, last) of at
+    // most grain indices that together cover [left, right).
+    template <typename F>
+    static void apply_range(int left, int right, int grain, task_system* ts, F f) {
+        if (left>=right) return;
+        impl::parallel_for_range(left, right, std::max(grain, 1), ts, f);
+    }
+
+    // Apply f(i) for i in [left, right), in chunks of at most grain indices.
+    template <typename F>
+    static void apply(int left, int right, int grain, task_system* ts, F f) {
+        apply_range(left, right, grain, ts,
+            [&f](int first, int last) {
+                for (int i = first; i < last; ++i) {
+                    f(i);
+                }
+            });
+    }
+
+    // Apply f(i) for i in [left, right) with an automatically chosen grain size.
     template <typename F>
     static void apply(int left, int right, task_system* ts, F f) {
-        task_group g(ts);
-        for (int i = left; i < right; ++i) {
-          g.run([=] {f(i);});
-        }
-        g.wait();
+        apply(left, right, auto_grain(right-left, ts), ts, std::move(f));
+    }
+};
+
+struct parallel_reduce {
+    // Returns op(...op(op(identity, f(left)), f(left+1))..., f(right-1)),
+    // evaluated in parallel over chunks of at most grain indices.
+    //
+    // op must be associative, and identity must be an identity for op.
+    // The grouping of the partial results depends only on the range and
+    // the grain size, so for a fixed grain the result is deterministic.
+    template <typename T, typename F, typename Op>
+    static T apply(int left, int right, int grain, task_system* ts, T identity, F f, Op op) {
+        if (left>=right) return identity;
+        return impl::parallel_reduce_range(left, right, std::max(grain, 1), ts, identity, f, op);
+    }
+
+    template <typename T, typename F, typename Op>
+    static T apply(int left, int right, task_system* ts, T identity, F f, Op op) {
+        return apply(left, right, parallel_for::auto_grain(right-left, ts), ts,
+                     std::move(identity), std::move(f), std::move(op));
     }
 };
+
+struct parallel_sort {
+    // Smallest subrange sorted by a single task.
+    static constexpr std::ptrdiff_t min_grain = 4096;
+
+    // Sort [first, last): subranges are sorted in parallel with std::sort,
+    // then merged pairwise with std::inplace_merge. Not stable.
+    template <typename RandomIt, typename Less = std::less<>>
+    static void apply(RandomIt first, RandomIt last, task_system* ts, Less less = Less{}) {
+        auto n = last-first;
+        if (n<2) return;
+
+        std::ptrdiff_t grain = std::max<std::ptrdiff_t>(parallel_for::auto_grain(n, ts), min_grain);
+        impl::parallel_sort_range(first, last, grain, ts, less);
+    }
+
+    // Sort sequence, e.g. a std::vector, in place.
+    template <typename Seq, typename Less = std::less<>>
+    static void apply(Seq& seq, task_system* ts, Less less = Less{}) {
+        apply(std::begin(seq), std::end(seq), ts, std::move(less));
+    }
+};
+
 } // namespace threading
 } // namespace arb
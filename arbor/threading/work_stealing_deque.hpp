@@ -0,0 +1,162 @@
+#pragma once
+
+// Lock-free work-stealing deque of pointers.
+//
+// Chase-Lev deque as formulated for weak memory models in:
+//     N. M. Lê, A. Pop, A. Cohen and F. Zappa Nardelli,
+//     "Correct and efficient work-stealing for weak memory models",
+//     PPoPP 2013.
+//
+// The owning thread pushes and pops at the bottom of the deque (LIFO);
+// any other thread may steal from the top (FIFO). Only the owner may
+// call push() and pop().
+//
+// The circular buffer grows when full. Buffers that have been replaced
+// are retained until the deque is destroyed, as a concurrent thief may
+// still be reading from them.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace arb {
+namespace threading {
+namespace impl {
+
+template <typename T>
+class work_stealing_deque {
+    using index_type = std::int64_t;
+
+    struct ring_buffer {
+        explicit ring_buffer(index_type capacity):
+            capacity_(capacity),
+            mask_(capacity-1),
+            data_(new std::atomic<T*>[capacity])
+        {}
+
+        index_type capacity() const { return capacity_; }
+
+        T* get(index_type i) const {
+            return data_[i&mask_].load(std::memory_order_relaxed);
+        }
+
+        void put(index_type i, T* x) {
+            data_[i&mask_].store(x, std::memory_order_relaxed);
+        }
+
+        ring_buffer* grow(index_type bottom, index_type top) const {
+            auto r = new ring_buffer(2*capacity_);
+            for (auto i = top; i!=bottom; ++i) {
+                r->put(i, get(i));
+            }
+            return r;
+        }
+
+    private:
+        index_type capacity_;
+        index_type mask_;
+        std::unique_ptr<std::atomic<T*>[]> data_;
+    };
+
+    // Padding keeps top_ (written by thieves) and bottom_ (written by the
+    // owner) on separate cache lines; alignas would require C++17 aligned new.
+    static constexpr std::size_t cache_line = 64;
+
+    std::atomic<index_type> top_;
+    char pad0_[cache_line-sizeof(std::atomic<index_type>)];
+    std::atomic<index_type> bottom_;
+    char pad1_[cache_line-sizeof(std::atomic<index_type>)];
+    std::atomic<ring_buffer*> buffer_;
+
+    // Owned by the deque owner: all buffers ever allocated.
+    std::vector<std::unique_ptr<ring_buffer>> buffers_;
+
+public:
+    // Initial capacity must be a power of two.
+    explicit work_stealing_deque(index_type capacity = 1024):
+        top_(0), bottom_(0)
+    {
+        buffers_.emplace_back(new ring_buffer(capacity));
+        buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+    }
+
+    work_stealing_deque(const work_stealing_deque&) = delete;
+    work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+    // Owner only: push x onto the bottom of the deque.
+    void push(T* x) {
+        index_type b = bottom_.load(std::memory_order_relaxed);
+        index_type t = top_.load(std::memory_order_acquire);
+        ring_buffer* a = buffer_.load(std::memory_order_relaxed);
+
+        if (b-t > a->capacity()-1) {
+            buffers_.emplace_back(a->grow(b, t));
+            a = buffers_.back().get();
+            buffer_.store(a, std::memory_order_release);
+        }
+
+        a->put(b, x);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b+1, std::memory_order_relaxed);
+    }
+
+    // Owner only: pop from the bottom of the deque; returns nullptr if empty.
+    T* pop() {
+        index_type b = bottom_.load(std::memory_order_relaxed)-1;
+        ring_buffer* a = buffer_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        index_type t = top_.load(std::memory_order_relaxed);
+
+        T* x = nullptr;
+        if (t<=b) {
+            x = a->get(b);
+            if (t==b) {
+                // Last element: race against thieves.
+                if (!top_.compare_exchange_strong(t, t+1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                    x = nullptr;
+                }
+                bottom_.store(b+1, std::memory_order_relaxed);
+            }
+        }
+        else {
+            bottom_.store(b+1, std::memory_order_relaxed);
+        }
+        return x;
+    }
+
+    // Any thread: steal from the top of the deque; returns nullptr if
+    // the deque is empty or the steal lost a race.
+    T* steal() {
+        index_type t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        index_type b = bottom_.load(std::memory_order_acquire);
+
+        if (t<b) {
+            ring_buffer* a = buffer_.load(std::memory_order_acquire);
+            T* x = a->get(t);
+            if (!top_.compare_exchange_strong(t, t+1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                return nullptr;
+            }
+            return x;
+        }
+        return nullptr;
+    }
+
+    // Approximate emptiness test, safe to call from any thread.
+    bool empty() const {
+        index_type b = bottom_.load(std::memory_order_seq_cst);
+        index_type t = top_.load(std::memory_order_seq_cst);
+        return b<=t;
+    }
+};
+
+} // namespace impl
+} // namespace threading
+} // namespace arb
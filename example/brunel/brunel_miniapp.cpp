@@ -60,8 +60,10 @@ std::vector<cell_gid_type> sample_subset(cell_gid_type gid, cell_gid_type start,
 class brunel_recipe: public recipe {
 public:
     brunel_recipe(cell_size_type nexc, cell_size_type ninh, cell_size_type next, double in_degree_prop,
-                  float weight, float delay, float rel_inh_strength, double poiss_lambda, int seed = 42):
-        ncells_exc_(nexc), ncells_inh_(ninh), ncells_ext_(next), delay_(delay), seed_(seed) {
+                  float weight, float delay, float rel_inh_strength, double poiss_lambda, int seed = 42,
+                  lif_integration integration = lif_integration::exact):
+        ncells_exc_(nexc), ncells_inh_(ninh), ncells_ext_(next), delay_(delay), seed_(seed),
+        integration_(integration) {
         // Make sure that in_degree_prop in the interval (0, 1]
         if (in_degree_prop <= 0.0 || in_degree_prop > 1.0) {
             std::out_of_range("The proportion of incoming connections should be in the interval (0, 1].");
@@ -115,6 +117,7 @@ public:
         cell.V_m = 0;
         cell.V_reset = 0;
         cell.t_ref = 2;
+        cell.integration = integration_;
         return cell;
     }
 
@@ -180,6 +183,9 @@ private:
 
     // Seed used for the Poisson spikes generation.
     int seed_;
+
+    // Integration of the membrane potential of the cells.
+    lif_integration integration_;
 };
 
 int main(int argc, char** argv) {
@@ -232,7 +238,9 @@ int main(int argc, char** argv) {
 
         unsigned seed = options.seed;
 
-        brunel_recipe recipe(nexc, ninh, next, in_degree_prop, w, d, rel_inh_strength, poiss_lambda, seed);
+        auto integration = options.stepped? lif_integration::stepped: lif_integration::exact;
+
+        brunel_recipe recipe(nexc, ninh, next, in_degree_prop, w, d, rel_inh_strength, poiss_lambda, seed, integration);
 
         partition_hint_map hints;
         hints[cell_kind::lif_neuron].cpu_group_size = group_size;
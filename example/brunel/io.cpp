@@ -126,7 +126,7 @@ namespace io {
                  false, defopts.tfinal, "time", cmd);
 
             TCLAP::ValueArg<double> dt_arg
-                ("s", "delta-t", "simulation time step [ms] (this parameter is ignored)",
+                ("s", "delta-t", "simulation time step [ms] (only used with --stepped)",
                  false, defopts.dt, "time", cmd);
 
             TCLAP::ValueArg<uint32_t> group_size_arg
@@ -137,6 +137,9 @@ namespace io {
                 ("S", "seed", "seed for poisson spike generators",
                  false, defopts.seed, "integer", cmd);
 
+            TCLAP::SwitchArg stepped_arg
+                ("P", "stepped", "integrate cells with fixed time steps instead of the exact solution", cmd, false);
+
             TCLAP::SwitchArg spike_output_arg
                 ("f","spike-file-output","save spikes to file", cmd, false);
 
@@ -165,6 +168,7 @@ namespace io {
             update_option(options.dt, dt_arg);
             update_option(options.group_size, group_size_arg);
             update_option(options.seed, seed_arg);
+            update_option(options.stepped, stepped_arg);
             update_option(options.spike_file_output, spike_output_arg);
             update_option(options.profile_only_zero, profile_only_zero_arg);
 
@@ -203,6 +207,7 @@ namespace io {
         o << "  dt                                                         : " << options.dt << "\n";
         o << "  group size                                                 : " << options.group_size << "\n";
         o << "  seed                                                       : " << options.seed << "\n";
+        o << "  integration                                                : " << (options.stepped? "stepped": "exact") << "\n";
         return o;
     }
 } // namespace io
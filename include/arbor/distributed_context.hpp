@@ -2,7 +2,10 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 
+#include <arbor/assert.hpp>
+#include <arbor/common_types.hpp>
 #include <arbor/spike.hpp>
 #include <arbor/communication/gathered_vector.hpp>
 #include <arbor/util/pp_util.hpp>
@@ -29,6 +32,63 @@ namespace arb {
 
 #define ARB_COLLECTIVE_TYPES_ float, double, int, unsigned, long, unsigned long, long long, unsigned long long
 
+// Strategy used by the communicator to exchange spikes between domains:
+//   allgather: every spike is sent to every domain;
+//   sparse:    spikes are sent point-to-point, only to the domains that
+//              have connections from the source of the spike.
+enum class spike_exchange_mode {
+    allgather,
+    sparse
+};
+
+// Handle to a spike exchange that has been started, but not completed.
+//
+// Contexts that exchange spikes asynchronously return a handle to a
+// request that is completed by complete(); other contexts perform the
+// exchange when it is started, and return a handle to the result.
+class spike_exchange_handle {
+public:
+    struct request {
+        // Block until the exchange has finished; return the spikes received.
+        virtual gathered_vector<arb::spike> complete() = 0;
+        virtual ~request() {}
+    };
+
+    spike_exchange_handle() = default;
+
+    explicit spike_exchange_handle(std::unique_ptr<request> r):
+        request_(std::move(r))
+    {}
+
+    explicit spike_exchange_handle(gathered_vector<arb::spike> spikes):
+        request_(new completed_request(std::move(spikes)))
+    {}
+
+    bool pending() const {
+        return bool(request_);
+    }
+
+    // May be called once for each exchange.
+    gathered_vector<arb::spike> complete() {
+        arb_assert(pending());
+        auto r = std::move(request_);
+        return r->complete();
+    }
+
+private:
+    struct completed_request: request {
+        explicit completed_request(gathered_vector<arb::spike> s): spikes(std::move(s)) {}
+
+        gathered_vector<arb::spike> complete() override {
+            return std::move(spikes);
+        }
+
+        gathered_vector<arb::spike> spikes;
+    };
+
+    std::unique_ptr<request> request_;
+};
+
 // Defines the concept/interface for a distributed communication context.
 //
 // Uses value-semantic type erasure to define the interface, so that
@@ -37,10 +97,23 @@ namespace arb {
 //
 // For the simplest example of a distributed_context implementation,
 // see local_context, which is the default context.
+//
+// Point-to-point exchanges send the values in the range
+// [send_partition[i], send_partition[i+1]) of the local values to domain i,
+// and return the values received, partitioned by the domain they were sent
+// from.
+//
+// The start_ variants of the spike collectives begin the collective and
+// return a handle to complete it, so that computation can be overlapped
+// with communication. The local spikes need not outlive the call; as with
+// the blocking collectives, every domain must start and complete the same
+// sequence of collectives.
 
 class distributed_context {
 public:
     using spike_vector = std::vector<arb::spike>;
+    using gid_vector = std::vector<cell_gid_type>;
+    using partition_vector = std::vector<unsigned>;
 
     // default constructor uses a local context: see below.
     distributed_context();
@@ -57,6 +130,31 @@ public:
         return impl_->gather_spikes(local_spikes);
     }
 
+    gathered_vector<arb::spike> exchange_spikes(const spike_vector& local_spikes, const partition_vector& send_partition) const {
+        return impl_->exchange_spikes(local_spikes, send_partition);
+    }
+
+    gathered_vector<cell_gid_type> exchange_gids(const gid_vector& local_gids, const partition_vector& send_partition) const {
+        return impl_->exchange_gids(local_gids, send_partition);
+    }
+
+    spike_exchange_handle start_gather_spikes(const spike_vector& local_spikes) const {
+        return impl_->start_gather_spikes(local_spikes);
+    }
+
+    spike_exchange_handle start_exchange_spikes(const spike_vector& local_spikes, const partition_vector& send_partition) const {
+        return impl_->start_exchange_spikes(local_spikes, send_partition);
+    }
+
+    // The spike exchange mode is read by the communicator on construction.
+    spike_exchange_mode spike_exchange() const {
+        return spike_exchange_;
+    }
+
+    void set_spike_exchange(spike_exchange_mode mode) {
+        spike_exchange_ = mode;
+    }
+
     int id() const {
         return impl_->id();
     }
@@ -83,6 +181,14 @@ private:
     struct interface {
         virtual gathered_vector<arb::spike>
             gather_spikes(const spike_vector& local_spikes) const = 0;
+        virtual gathered_vector<arb::spike>
+            exchange_spikes(const spike_vector& local_spikes, const partition_vector& send_partition) const = 0;
+        virtual gathered_vector<cell_gid_type>
+            exchange_gids(const gid_vector& local_gids, const partition_vector& send_partition) const = 0;
+        virtual spike_exchange_handle
+            start_gather_spikes(const spike_vector& local_spikes) const = 0;
+        virtual spike_exchange_handle
+            start_exchange_spikes(const spike_vector& local_spikes, const partition_vector& send_partition) const = 0;
         virtual int id() const = 0;
         virtual int size() const = 0;
         virtual void barrier() const = 0;
@@ -103,6 +209,22 @@ private:
         gather_spikes(const spike_vector& local_spikes) const override {
             return wrapped.gather_spikes(local_spikes);
         }
+        gathered_vector<arb::spike>
+        exchange_spikes(const spike_vector& local_spikes, const partition_vector& send_partition) const override {
+            return wrapped.exchange_spikes(local_spikes, send_partition);
+        }
+        gathered_vector<cell_gid_type>
+        exchange_gids(const gid_vector& local_gids, const partition_vector& send_partition) const override {
+            return wrapped.exchange_gids(local_gids, send_partition);
+        }
+        spike_exchange_handle
+        start_gather_spikes(const spike_vector& local_spikes) const override {
+            return wrapped.start_gather_spikes(local_spikes);
+        }
+        spike_exchange_handle
+        start_exchange_spikes(const spike_vector& local_spikes, const partition_vector& send_partition) const override {
+            return wrapped.start_exchange_spikes(local_spikes, send_partition);
+        }
         int id() const override {
             return wrapped.id();
         }
@@ -126,6 +248,7 @@ private:
     };
 
     std::unique_ptr<interface> impl_;
+    spike_exchange_mode spike_exchange_ = spike_exchange_mode::allgather;
 };
 
 struct local_context {
@@ -138,6 +261,26 @@ struct local_context {
         );
     }
 
+    gathered_vector<arb::spike>
+    exchange_spikes(const std::vector<arb::spike>& local_spikes, const std::vector<unsigned>& send_partition) const {
+        return exchange(local_spikes, send_partition);
+    }
+
+    gathered_vector<cell_gid_type>
+    exchange_gids(const std::vector<cell_gid_type>& local_gids, const std::vector<unsigned>& send_partition) const {
+        return exchange(local_gids, send_partition);
+    }
+
+    spike_exchange_handle
+    start_gather_spikes(const std::vector<arb::spike>& local_spikes) const {
+        return spike_exchange_handle(gather_spikes(local_spikes));
+    }
+
+    spike_exchange_handle
+    start_exchange_spikes(const std::vector<arb::spike>& local_spikes, const std::vector<unsigned>& send_partition) const {
+        return spike_exchange_handle(exchange_spikes(local_spikes, send_partition));
+    }
+
     int id() const { return 0; }
 
     int size() const { return 1; }
@@ -157,6 +300,16 @@ struct local_context {
     void barrier() const {}
 
     std::string name() const { return "local"; }
+
+private:
+    template <typename T>
+    static gathered_vector<T> exchange(const std::vector<T>& values, const std::vector<unsigned>& send_partition) {
+        using count_type = typename gathered_vector<T>::count_type;
+        return gathered_vector<T>(
+            std::vector<T>(values.begin()+send_partition[0], values.begin()+send_partition[1]),
+            {0u, static_cast<count_type>(send_partition[1]-send_partition[0])}
+        );
+    }
 };
 
 inline distributed_context::distributed_context():
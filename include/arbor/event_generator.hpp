@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <random>
 
@@ -42,6 +43,27 @@ namespace arb {
 // and `events(t2, t3)` to the same event generator must satisfy
 // 0 ≤ t0 ≤ t1 ≤ t2 ≤ t3.
 //
+// `event_seq event_generator::stream(time_type t0, time_type t1)`
+//
+//     Provide a view on to the next block of events in the time interval
+//     [t0, t1), or an empty view if all of the events in the interval
+//     have been provided. Repeated calls with the same interval count as
+//     one call for the purpose of monotonicity. Each view is invalidated
+//     by the following call.
+//
+//     Streaming allows the events of a generator to be merged with other
+//     events without storing all of the events in the interval. An
+//     implementation class may provide a `stream` method; otherwise the
+//     first call returns all of the events in the interval, as `events`.
+//
+// `bool event_generator::countable()`
+// `std::size_t event_generator::count(time_type t0, time_type t1)`
+//
+//     A generator is countable if it can count the events that streaming
+//     the interval [t0, t1) would provide, without changing the events that
+//     later calls provide. An implementation class may provide these
+//     methods; otherwise the generator is not countable.
+//
 // `event_generator` objects have value semantics, and use type erasure
 // to wrap implementation details. An `event_generator` can be constructed
 // from an onbject of an implementation class Impl that is copy-constructible
@@ -50,7 +72,9 @@ namespace arb {
 //
 // Some pre-defined event generators are included:
 //  - `empty_generator`: produces no events
-//  - `schedule_generator`: events to a fixed target according to a time schedule
+//  - `schedule_generator`: events to a fixed target according to a time schedule;
+//    regular and Poisson schedules are streamed in blocks, and regular and
+//    counter-based Poisson schedules are countable.
 
 using event_seq = std::pair<const spike_event*, const spike_event*>;
 
@@ -97,10 +121,25 @@ public:
         return impl_->events(t0, t1);
     }
 
+    event_seq stream(time_type t0, time_type t1) {
+        return impl_->stream(t0, t1);
+    }
+
+    bool countable() const {
+        return impl_->countable();
+    }
+
+    std::size_t count(time_type t0, time_type t1) {
+        return impl_->count(t0, t1);
+    }
+
 private:
     struct interface {
         virtual void reset() = 0;
         virtual event_seq events(time_type, time_type) = 0;
+        virtual event_seq stream(time_type, time_type) = 0;
+        virtual bool countable() const = 0;
+        virtual std::size_t count(time_type, time_type) = 0;
         virtual std::unique_ptr<interface> clone() = 0;
         virtual ~interface() {}
     };
@@ -116,15 +155,70 @@ private:
             return wrapped.events(t0, t1);
         }
 
+        event_seq stream(time_type t0, time_type t1) override {
+            return stream_impl(wrapped, t0, t1, 0);
+        }
+
+        bool countable() const override {
+            return countable_impl(wrapped, 0);
+        }
+
+        std::size_t count(time_type t0, time_type t1) override {
+            return count_impl(wrapped, t0, t1, 0);
+        }
+
         void reset() override {
+            streamed_to_ = std::numeric_limits<time_type>::lowest();
             wrapped.reset();
         }
 
         std::unique_ptr<interface> clone() override {
-            return std::unique_ptr<interface>(new wrap<Impl>(wrapped));
+            auto w = new wrap<Impl>(wrapped);
+            w->streamed_to_ = streamed_to_;
+            return std::unique_ptr<interface>(w);
+        }
+
+        // Use the stream method of the implementation if it has one,
+        // otherwise provide all of the events in one block.
+        template <typename T>
+        auto stream_impl(T& impl, time_type t0, time_type t1, int) -> decltype(impl.stream(t0, t1)) {
+            return impl.stream(t0, t1);
+        }
+
+        template <typename T>
+        event_seq stream_impl(T& impl, time_type t0, time_type t1, long) {
+            if (t1<=streamed_to_) {
+                return {nullptr, nullptr};
+            }
+            streamed_to_ = t1;
+            return impl.events(t0, t1);
+        }
+
+        // Use the countable and count methods of the implementation if it
+        // has them, otherwise the generator is not countable.
+        template <typename T>
+        static auto countable_impl(const T& impl, int) -> decltype(impl.countable()) {
+            return impl.countable();
+        }
+
+        template <typename T>
+        static bool countable_impl(const T&, long) {
+            return false;
+        }
+
+        template <typename T>
+        auto count_impl(T& impl, time_type t0, time_type t1, int) -> decltype(impl.count(t0, t1)) {
+            return impl.count(t0, t1);
+        }
+
+        template <typename T>
+        std::size_t count_impl(T&, time_type, time_type, long) {
+            arb_assert(false && "event generator is not countable");
+            return 0;
         }
 
         Impl wrapped;
+        time_type streamed_to_ = std::numeric_limits<time_type>::lowest();
     };
 };
 
@@ -154,6 +248,25 @@ struct schedule_generator {
         return {events_.data(), events_.data()+events_.size()};
     }
 
+    event_seq stream(time_type t0, time_type t1) {
+        auto ts = sched_.stream(t0, t1);
+
+        events_.clear();
+        for (auto i = ts.first; i!=ts.second; ++i) {
+            events_.push_back(spike_event{target_, *i, weight_});
+        }
+
+        return {events_.data(), events_.data()+events_.size()};
+    }
+
+    bool countable() const {
+        return sched_.countable();
+    }
+
+    std::size_t count(time_type t0, time_type t1) {
+        return sched_.count(t0, t1);
+    }
+
 private:
     pse_vector events_;
     cell_member_type target_;
@@ -176,6 +289,12 @@ inline event_generator poisson_generator(
     return schedule_generator(target, weight, poisson_schedule(tstart, rate_kHz, rng));
 }
 
+inline event_generator counter_poisson_generator(
+    cell_member_type target, float weight, time_type tstart, time_type rate_kHz, std::uint64_t seed)
+{
+    return schedule_generator(target, weight, counter_poisson_schedule(tstart, rate_kHz, seed));
+}
+
 
 // Generate events from a predefined sorted event sequence.
 
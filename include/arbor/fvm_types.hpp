@@ -1,6 +1,7 @@
 #pragma once
 
 #include <arbor/common_types.hpp>
+#include <arbor/fvm_state_type.hpp>
 
 // Basic types shared across FVM implementations/backends.
 
@@ -10,4 +11,11 @@ using fvm_value_type = double;
 using fvm_size_type = cell_local_size_type;
 using fvm_index_type = int;
 
+// fvm_state_type, the type of the mechanism state variables and parameters,
+// and of the ion concentrations, in the multicore back end, is defined in
+// the generated header fvm_state_type.hpp: float if arbor is built with
+// ARB_FLOAT_STATE, or else fvm_value_type. The voltage, currents and the
+// matrix system are always stored as fvm_value_type, and the mechanism
+// kernels compute in fvm_value_type.
+
 } // namespace arb
@@ -2,7 +2,25 @@
 
 namespace arb {
 
+// Integration of the membrane potential of a leaky integrate and fire neuron:
+//   exact:   the exact solution is evaluated at the time of each event, and
+//            spikes are generated at the time of the event that crosses
+//            the threshold.
+//   stepped: the membrane potential is advanced in time steps of dt, and
+//            the events that arrive in a step are delivered at its end,
+//            where the threshold is tested. The refractory period is
+//            measured from the end of the step of the spike, and events
+//            delivered before it ends are lost. Cheaper than the exact
+//            solution when cells receive many events per time step.
+enum class lif_integration {
+    exact,
+    stepped
+};
+
 // Model parameteres of leaky integrate and fire neuron model.
+//
+// Each probe on a LIF cell samples its membrane potential [mV], as a double;
+// the probe address is not used.
 struct lif_cell {
     // Neuronal parameters.
     double tau_m = 10;    // Membrane potential decaying constant [ms].
@@ -12,6 +30,8 @@ struct lif_cell {
     double V_m = E_L;     // Initial value of the Membrane potential [mV].
     double V_reset = E_L; // Reset potential [mV].
     double t_ref = 2;     // Refractory period [ms].
+
+    lif_integration integration = lif_integration::exact;
 };
 
 } // namespace arb
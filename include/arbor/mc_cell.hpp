@@ -40,6 +40,11 @@ struct segment_location {
 };
 
 // Current clamp description for stimulus specification.
+//
+// The clamp is on for times t in [delay, delay+duration). With a frequency of
+// zero the current is constant, otherwise it is sinusoidal:
+//     amplitude*sin(2π·frequency·(t-delay) + phase).
+// Piecewise-constant waveforms are described by a sequence of clamps.
 
 struct i_clamp {
     using value_type = double;
@@ -47,9 +52,13 @@ struct i_clamp {
     value_type delay = 0;      // [ms]
     value_type duration = 0;   // [ms]
     value_type amplitude = 0;  // [nA]
+    value_type frequency = 0;  // [kHz]
+    value_type phase = 0;      // [rad]
 
-    i_clamp(value_type delay, value_type duration, value_type amplitude):
-        delay(delay), duration(duration), amplitude(amplitude)
+    i_clamp(value_type delay, value_type duration, value_type amplitude,
+            value_type frequency = 0, value_type phase = 0):
+        delay(delay), duration(duration), amplitude(amplitude),
+        frequency(frequency), phase(phase)
     {}
 };
 
@@ -64,6 +73,19 @@ struct cell_probe_address {
     probe_kind kind;
 };
 
+// Numbering of the CVs within each cell.
+
+enum class cv_ordering {
+    // CVs of each segment in turn, in segment order.
+    segment,
+
+    // Segments in depth-first order from the soma. The children of a segment
+    // are visited grouped by their set of mechanisms, starting with those
+    // that have the same mechanisms as their parent, so that the CVs of the
+    // mechanism instances and of the matrix rows are close together.
+    depth_first
+};
+
 // Global parameter type for cell descriptions.
 
 struct mc_cell_global_properties {
@@ -73,6 +95,17 @@ struct mc_cell_global_properties {
     // during integration.
     double membrane_voltage_limit_mV = 0;
 
+    // If true, density mechanisms that support it update their state and
+    // compute their currents for the next step in a single pass, after the
+    // ion concentration update. The result is the same up to the order in
+    // which current contributions are summed.
+    bool fuse_mechanism_kernels = false;
+
+    // Numbering of the CVs within each cell. The ordering affects only the
+    // memory layout of the cell state, and the simulation is the same up to
+    // rounding.
+    cv_ordering cv_order = cv_ordering::segment;
+
     // TODO: consider making some/all of the following parameters
     // cell or even segment-local.
     // 
@@ -67,6 +67,13 @@ public:
     virtual void deliver_events() {};
     virtual void write_ions() = 0;
 
+    // Fused integration: the state update of a step followed by the current
+    // computation of the next, in one pass over the instance. It may be used
+    // in place of nrn_state() and nrn_current() only if fusible() is true;
+    // see mc_cell_global_properties::fuse_mechanism_kernels.
+    virtual bool fusible() const { return false; }
+    virtual void nrn_state_current() { nrn_state(); nrn_current(); }
+
     virtual ~mechanism() = default;
 
     // Per-cell group identifier for an instantiated mechanism.
@@ -23,12 +23,44 @@ struct sample_record {
 
 using sampler_function = std::function<void (cell_member_type, probe_tag, std::size_t, const sample_record*)>;
 
+// Bulk samplers are passed the samples of all of the probes of a sampler
+// association over an integration period in one call, as columns of sample
+// times and values. The samples of probe_id[i] are the entries in
+// [offset[i], offset[i+1]) of time and value.
+//
+// The probes of all cell kinds take scalar samples of type double.
+
+struct sample_columns {
+    std::size_t n_probe = 0;
+    const cell_member_type* probe_id = nullptr;
+    const probe_tag* tag = nullptr;
+    const std::size_t* offset = nullptr;
+    const time_type* time = nullptr;
+    const double* value = nullptr;
+};
+
+using bulk_sampler_function = std::function<void (const sample_columns&)>;
+
 using sampler_association_handle = std::size_t;
 
+// Sampling policies determine how the samples of cells that are integrated
+// in discrete time steps relate to the sample times of a schedule:
+//
+// lax:          take the sample from the state at the start of the step that
+//               contains the sample time, and report the time of that state.
+// interpolated: interpolate linearly between the states at the start and the
+//               end of the step that contains the sample time. Currents are
+//               constant over a step, so current probes report the value at
+//               the start of the step.
+// exact:        shorten the step that contains the sample time so that it
+//               ends at the sample time, and take the sample from that state.
+//
+// Cell kinds without discrete time steps sample exactly for any policy.
+
 enum class sampling_policy {
     lax,
-    // interpolated, // placeholder: unsupported
-    // exact         // placeholder: unsupported
+    interpolated,
+    exact
 };
 
 } // namespace arb
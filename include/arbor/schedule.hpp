@@ -1,7 +1,9 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <random>
 #include <utility>
@@ -25,6 +27,20 @@ inline time_event_span as_time_event_span(const std::vector<time_type>& v) {
 // are queried monotonically in time: if two method calls `events(t0, t1)` 
 // and `events(t2, t3)` are made without an intervening call to `reset()`,
 // then 0 ≤ _t0_ ≤ _t1_ ≤ _t2_ ≤ _t3_.
+//
+// The times in an interval can also be streamed in blocks: each call to
+// `stream(t0, t1)` returns the next block of times in [t0, t1), and an empty
+// block once all have been returned. Repeated calls with the same interval
+// count as one query for the purpose of monotonicity. Schedules that would
+// otherwise store all of the times in an interval generate them
+// in blocks of at most `schedule_stream_block_size` times; for other
+// schedules, the first call returns all of the times.
+//
+// Regular and counter-based Poisson schedules are also countable: `count(t0,
+// t1)` gives the number of times that streaming [t0, t1) would return, and
+// leaves the times returned by later calls unchanged.
+
+constexpr std::size_t schedule_stream_block_size = 64;
 
 class schedule {
 public:
@@ -53,11 +69,26 @@ public:
         return impl_->events(t0, t1);
     }
 
+    time_event_span stream(time_type t0, time_type t1) {
+        return impl_->stream(t0, t1);
+    }
+
+    bool countable() const {
+        return impl_->countable();
+    }
+
+    std::size_t count(time_type t0, time_type t1) {
+        return impl_->count(t0, t1);
+    }
+
     void reset() { impl_->reset(); }
 
 private:
     struct interface {
         virtual time_event_span events(time_type t0, time_type t1) = 0;
+        virtual time_event_span stream(time_type t0, time_type t1) = 0;
+        virtual bool countable() const = 0;
+        virtual std::size_t count(time_type t0, time_type t1) = 0;
         virtual void reset() = 0;
         virtual std::unique_ptr<interface> clone() = 0;
         virtual ~interface() {}
@@ -74,15 +105,69 @@ private:
             return wrapped.events(t0, t1);
         }
 
+        virtual time_event_span stream(time_type t0, time_type t1) {
+            return stream_impl(wrapped, t0, t1, 0);
+        }
+
+        virtual bool countable() const {
+            return countable_impl(0);
+        }
+
+        virtual std::size_t count(time_type t0, time_type t1) {
+            return count_impl(wrapped, t0, t1, 0);
+        }
+
         virtual void reset() {
+            streamed_to_ = std::numeric_limits<time_type>::lowest();
             wrapped.reset();
         }
 
         virtual std::unique_ptr<interface> clone() {
-            return std::unique_ptr<interface>(new wrap<Impl>(wrapped));
+            auto w = new wrap<Impl>(wrapped);
+            w->streamed_to_ = streamed_to_;
+            return std::unique_ptr<interface>(w);
+        }
+
+        // Use the stream method of the implementation if it has one,
+        // otherwise return all of the times in one block.
+        template <typename T>
+        auto stream_impl(T& impl, time_type t0, time_type t1, int) -> decltype(impl.stream(t0, t1)) {
+            return impl.stream(t0, t1);
+        }
+
+        template <typename T>
+        time_event_span stream_impl(T& impl, time_type t0, time_type t1, long) {
+            if (t1<=streamed_to_) {
+                return {nullptr, nullptr};
+            }
+            streamed_to_ = t1;
+            return impl.events(t0, t1);
+        }
+
+        // A schedule is countable if the implementation has a count method.
+        template <typename T = Impl>
+        static auto countable_impl(int) -> decltype(std::declval<T&>().count(0, 0), bool()) {
+            return true;
+        }
+
+        template <typename T = Impl>
+        static bool countable_impl(long) {
+            return false;
+        }
+
+        template <typename T>
+        auto count_impl(T& impl, time_type t0, time_type t1, int) -> decltype(impl.count(t0, t1)) {
+            return impl.count(t0, t1);
+        }
+
+        template <typename T>
+        std::size_t count_impl(T&, time_type, time_type, long) {
+            arb_assert(false && "schedule is not countable");
+            return 0;
         }
 
         Impl wrapped;
+        time_type streamed_to_ = std::numeric_limits<time_type>::lowest();
     };
 };
 
@@ -110,13 +195,21 @@ public:
         if (t0_<0) t0_ = 0;
     };
 
-    void reset() {}
+    void reset() {
+        stream_from_ = 0;
+    }
+
     time_event_span events(time_type t0, time_type t1);
+    time_event_span stream(time_type t0, time_type t1);
+    std::size_t count(time_type t0, time_type t1) const;
 
 private:
     time_type t0_, t1_, dt_;
     time_type oodt_;
 
+    // Start of the next block of times to be streamed.
+    time_type stream_from_ = 0;
+
     std::vector<time_type> times_;
 };
 
@@ -201,6 +294,21 @@ public:
         return as_time_event_span(times_);
     }
 
+    time_event_span stream(time_type t0, time_type t1) {
+        times_.clear();
+
+        while (next_<t0) {
+            step();
+        }
+
+        while (next_<t1 && times_.size()<schedule_stream_block_size) {
+            times_.push_back(next_);
+            step();
+        }
+
+        return as_time_event_span(times_);
+    }
+
 private:
     void step() {
         next_ += exp_(rng_);
@@ -224,4 +332,75 @@ inline schedule poisson_schedule(time_type tstart, time_type rate_kHz, const Ran
     return schedule(poisson_schedule_impl<RandomNumberEngine>(tstart, rate_kHz, rng));
 }
 
+// Schedule at Poisson point process with rate rate_kHz from tstart, drawn
+// from a counter-based random number generator with the given seed.
+//
+// Time is divided into windows from tstart, each with an expected
+// `events_per_window` events. The events in a window are generated by
+// drawing exponentially distributed intervals from the start of the window,
+// where the ith interval is a function of the seed, the window and i only.
+// As a Poisson process in disjoint intervals is independent, the result is a
+// Poisson process; the windows make it possible to reset the schedule, or
+// to advance it to any time, without drawing the events of earlier windows.
+//
+// The intervals are drawn in blocks, with the logarithms evaluated with SIMD
+// instructions where available, and so the times can depend in the last bits
+// on the instruction set.
+class counter_poisson_schedule_impl {
+public:
+    static constexpr unsigned events_per_window = 64;
+
+    counter_poisson_schedule_impl(time_type tstart, time_type rate_kHz, std::uint64_t seed);
+
+    void reset();
+    time_event_span events(time_type t0, time_type t1);
+    time_event_span stream(time_type t0, time_type t1);
+
+    // Counts the times with a dry pass over the draws.
+    std::size_t count(time_type t0, time_type t1);
+
+private:
+    static constexpr unsigned block_size = 16;
+
+    // Move to the start of window w.
+    void start_window(std::uint64_t w);
+
+    // Draw the next block of events in the current window, moving to the
+    // next window when the current one is exhausted; a block can be empty.
+    void draw_block();
+
+    // Skip the events before t.
+    void seek(time_type t);
+
+    // Time of the next event.
+    time_type next() {
+        while (block_pos_==block_n_) draw_block();
+        return block_[block_pos_];
+    }
+
+    double tstart_;
+    double rate_;
+    double window_;
+    std::uint64_t seed_;
+
+    std::uint64_t window_index_ = 0;
+    std::uint64_t draw_ = 0;    // Number of intervals drawn in the window.
+    double window_t_ = 0;       // Time of the last event drawn in the window.
+    bool window_done_ = false;
+
+    time_type block_[block_size];
+    unsigned block_pos_ = 0;
+    unsigned block_n_ = 0;
+
+    std::vector<time_type> times_;
+};
+
+inline schedule counter_poisson_schedule(time_type rate_kHz, std::uint64_t seed) {
+    return schedule(counter_poisson_schedule_impl(0., rate_kHz, seed));
+}
+
+inline schedule counter_poisson_schedule(time_type tstart, time_type rate_kHz, std::uint64_t seed) {
+    return schedule(counter_poisson_schedule_impl(tstart, rate_kHz, seed));
+}
+
 } // namespace arb
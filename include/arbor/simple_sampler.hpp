@@ -7,6 +7,7 @@
 
 #include <stdexcept>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include <arbor/common_types.hpp>
@@ -49,4 +50,60 @@ inline simple_sampler<V> make_simple_sampler(trace_data<V>& trace) {
     return simple_sampler<V>(trace);
 }
 
+// Recorder of the samples given to a bulk sampler, in separate time and
+// value columns for each probe. The columns of the probes to be recorded are
+// created, with capacity for the expected number of samples, on construction:
+// the recorder may then be used by cell groups on different threads.
+
+struct trace_columns {
+    std::vector<time_type> time;
+    std::vector<double> value;
+};
+
+class columnar_recorder {
+public:
+    columnar_recorder(const std::vector<cell_member_type>& probe_ids, std::size_t n_samples) {
+        for (auto pid: probe_ids) {
+            auto& c = columns_[pid];
+            c.time.reserve(n_samples);
+            c.value.reserve(n_samples);
+        }
+    }
+
+    // The sampler refers to the recorder, which must outlive it.
+    bulk_sampler_function sampler() {
+        return [this](const sample_columns& samples) { record(samples); };
+    }
+
+    void record(const sample_columns& samples) {
+        for (std::size_t i = 0; i<samples.n_probe; ++i) {
+            auto it = columns_.find(samples.probe_id[i]);
+            if (it==columns_.end()) {
+                throw std::runtime_error("unexpected probe in columnar_recorder");
+            }
+
+            auto& c = it->second;
+            const auto b = samples.offset[i];
+            const auto e = samples.offset[i+1];
+            c.time.insert(c.time.end(), samples.time+b, samples.time+e);
+            c.value.insert(c.value.end(), samples.value+b, samples.value+e);
+        }
+    }
+
+    const trace_columns& trace(cell_member_type probe_id) const {
+        return columns_.at(probe_id);
+    }
+
+    // Discard the recorded samples, keeping the capacity of the columns.
+    void clear() {
+        for (auto& entry: columns_) {
+            entry.second.time.clear();
+            entry.second.value.clear();
+        }
+    }
+
+private:
+    std::unordered_map<cell_member_type, trace_columns> columns_;
+};
+
 } // namespace arb
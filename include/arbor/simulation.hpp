@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -17,6 +18,17 @@ namespace arb {
 
 using spike_export_function = std::function<void(const std::vector<spike>&)>;
 
+// Volume of the spikes generated on the local domain, over the integration
+// intervals since construction or the last reset.
+struct spike_volume_stats {
+    std::uint64_t num_intervals = 0;
+    std::uint64_t num_spikes = 0;
+    // Largest number of spikes generated in one interval.
+    std::uint64_t max_interval_spikes = 0;
+    // Largest number of spikes generated by one cell group in one interval.
+    std::uint64_t max_group_interval_spikes = 0;
+};
+
 // simulation_state comprises private implentation for simulation class.
 class simulation_state;
 
@@ -34,12 +46,22 @@ public:
     sampler_association_handle add_sampler(cell_member_predicate probe_ids,
         schedule sched, sampler_function f, sampling_policy policy = sampling_policy::lax);
 
+    // Bulk samplers are passed the samples of all the probes of the
+    // association in one call; the association is removed as above.
+    sampler_association_handle add_bulk_sampler(cell_member_predicate probe_ids,
+        schedule sched, bulk_sampler_function f, sampling_policy policy = sampling_policy::lax);
+
     void remove_sampler(sampler_association_handle);
 
     void remove_all_samplers();
 
+    // Number of spikes generated on all domains, up to the end of the last
+    // call to run().
     std::size_t num_spikes() const;
 
+    // Statistics of the spikes generated on the local domain.
+    spike_volume_stats local_spike_stats() const;
+
     // Set event binning policy on all our groups.
     void set_binning_policy(binning_kind policy, time_type bin_interval);
 
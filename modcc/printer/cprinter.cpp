@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <map>
 #include <regex>
 #include <string>
 #include <unordered_set>
@@ -27,18 +29,17 @@ constexpr bool with_profiling() {
 void emit_procedure_proto(std::ostream&, ProcedureExpression*, const std::string& qualified = "");
 void emit_simd_procedure_proto(std::ostream&, ProcedureExpression*, const std::string& qualified = "");
 
-void emit_api_body(std::ostream&, APIMethod*);
-void emit_simd_api_body(std::ostream&, APIMethod*, moduleKind);
+void emit_api_body(std::ostream&, const std::vector<APIMethod*>&);
+void emit_simd_api_body(std::ostream&, const std::vector<APIMethod*>&, moduleKind);
 
 void emit_index_initialize(std::ostream& out, const std::unordered_set<std::string>& indices,
                            simd_expr_constraint constraint);
 
-void emit_body_for_loop(std::ostream& out, BlockExpression* body, const std::vector<LocalVariable*>& indexed_vars,
+void emit_body_for_loop(std::ostream& out, const std::vector<APIMethod*>& methods,
                    const std::unordered_set<std::string>& indices, const simd_expr_constraint& read_constraint,
                    const simd_expr_constraint& write_constraint);
 
-void emit_for_loop_per_constraint(std::ostream& out, BlockExpression* body,
-                                  const std::vector<LocalVariable*>& indexed_vars,
+void emit_for_loop_per_constraint(std::ostream& out, const std::vector<APIMethod*>& methods,
                                   const std::unordered_set<std::string>& indices,
                                   const simd_expr_constraint& read_constraint,
                                   const simd_expr_constraint& write_constraint,
@@ -95,6 +96,7 @@ std::string emit_cpp_source(const Module& module_, const printer_options& opt) {
     APIMethod* write_ions_api = find_api_method(module_, "write_ions");
 
     bool with_simd = opt.simd.abi!=simd_spec::none;
+    bool fusible = fusible_state_current(module_);
 
     // init_api, state_api, current_api methods are mandatory:
 
@@ -135,6 +137,7 @@ std::string emit_cpp_source(const Module& module_, const printer_options& opt) {
         "#include <cmath>\n"
         "#include <cstddef>\n"
         "#include <memory>\n"
+        "#include <type_traits>\n"
         "#include <" << arb_private_header_prefix() << "backends/multicore/mechanism.hpp>\n"
         "#include <" << arb_header_prefix() << "math.hpp>\n";
 
@@ -151,6 +154,7 @@ std::string emit_cpp_source(const Module& module_, const printer_options& opt) {
         "using backend = ::arb::multicore::backend;\n"
         "using base = ::arb::multicore::mechanism;\n"
         "using value_type = base::value_type;\n"
+        "using state_type = base::state_type;\n"
         "using size_type = base::size_type;\n"
         "using index_type = base::index_type;\n"
         "using ::arb::math::exprelr;\n"
@@ -190,6 +194,11 @@ std::string emit_cpp_source(const Module& module_, const printer_options& opt) {
         out <<
             "using simd_value = S::simd<fvm_value_type, simd_width_, " << abi << ">;\n"
             "using simd_index = S::simd<fvm_index_type, simd_width_, " << abi << ">;\n"
+            "\n"
+            "// State variables and ion concentrations are loaded and stored through\n"
+            "// simd_state, and converted to and from simd_value for arithmetic.\n"
+            "using simd_state = std::conditional_t<std::is_same<state_type, value_type>::value,\n"
+            "    simd_value, S::simd<state_type, simd_width_>>;\n"
             "\n";
     }
 
@@ -209,6 +218,10 @@ std::string emit_cpp_source(const Module& module_, const printer_options& opt) {
         "void nrn_current() override;\n"
         "void write_ions() override;\n";
 
+    fusible && out <<
+        "bool fusible() const override { return true; }\n"
+        "void nrn_state_current() override;\n";
+
     net_receive && out <<
         "void deliver_events(deliverable_event_stream::state events) override;\n"
         "void net_receive(int i_, value_type weight);\n";
@@ -286,7 +299,7 @@ std::string emit_cpp_source(const Module& module_, const printer_options& opt) {
         out << "value_type " << scalar->name() <<  " = " << as_c_double(scalar->value()) << ";\n";
     }
     for (const auto& array: vars.arrays) {
-        out << "value_type* " << array->name() << ";\n";
+        out << "state_type* " << array->name() << ";\n";
     }
     for (const auto& dep: ion_deps) {
         out << "ion_state_view " << ion_state_field(dep.name) << ";\n";
@@ -327,33 +340,41 @@ std::string emit_cpp_source(const Module& module_, const printer_options& opt) {
         cprint(net_receive->body()) << popindent <<
         "}\n\n";
 
-    auto emit_body = [&](APIMethod *p) {
+    auto emit_body = [&](const std::vector<APIMethod*>& ps) {
         if (with_simd) {
-            emit_simd_api_body(out, p, module_.kind());
+            emit_simd_api_body(out, ps, module_.kind());
         }
         else {
-            emit_api_body(out, p);
+            emit_api_body(out, ps);
         }
     };
 
     out << "void " << class_name << "::nrn_init() {\n" << indent;
-    emit_body(init_api);
+    emit_body({init_api});
     out << popindent << "}\n\n";
 
     out << "void " << class_name << "::nrn_state() {\n" << indent;
     out << profiler_enter("advance_integrate_state");
-    emit_body(state_api);
+    emit_body({state_api});
     out << profiler_leave();
     out << popindent << "}\n\n";
 
     out << "void " << class_name << "::nrn_current() {\n" << indent;
     out << profiler_enter("advance_integrate_current");
-    emit_body(current_api);
+    emit_body({current_api});
     out << profiler_leave();
     out << popindent << "}\n\n";
 
+    if (fusible) {
+        out << "void " << class_name << "::nrn_state_current() {\n" << indent;
+        out << profiler_enter("advance_integrate_state_current");
+        emit_body({state_api, current_api});
+        out << profiler_leave();
+        out << popindent << "}\n\n";
+    }
+
     out << "void " << class_name << "::write_ions() {\n" << indent;
-    emit_body(write_ions_api);
+    emit_body({write_ions_api});
     out << popindent << "}\n\n";
 
     // Mechanism procedures
@@ -463,22 +484,95 @@ void emit_state_update(std::ostream& out, Symbol* from, IndexedVariable* externa
     out << cprint(external) << op << from->name() << ";\n";
 }
 
-void emit_api_body(std::ostream& out, APIMethod* method) {
-    auto body = method->body();
-    auto indexed_vars = indexed_locals(method->scope());
+// The bodies of several API methods are emitted in turn in one loop over
+// the instance, each in its own scope. Methods with empty bodies are skipped.
+
+static std::vector<APIMethod*> nonempty_api_methods(const std::vector<APIMethod*>& methods) {
+    std::vector<APIMethod*> nonempty;
+    for (auto method: methods) {
+        if (!method->body()->statements().empty()) {
+            nonempty.push_back(method);
+        }
+    }
+    return nonempty;
+}
+
+static std::string index_i_name(const std::string& index_var) {
+    return index_var+"i_";
+}
+
+// Indexed variables that are read by more than one of the methods are read
+// once, before the method scopes, into a local named after the data; each
+// method initializes its own local from it. The data may alias the data
+// written by a method, so the compiler can not merge the reads itself.
+
+static std::string shared_read_key(LocalVariable* local) {
+    auto v = decode_indexed_variable(local->external_variable());
+    return v.data_var+"["+v.index_var+"]";
+}
 
-    if (!body->statements().empty()) {
+static std::string shared_read_name(LocalVariable* local) {
+    auto name = decode_indexed_variable(local->external_variable()).data_var;
+    std::replace(name.begin(), name.end(), '.', '_');
+    return index_i_name(name);
+}
+
+// Returns the first local of each shared read, keyed by shared_read_key().
+static std::map<std::string, LocalVariable*> shared_indexed_reads(const std::vector<APIMethod*>& methods) {
+    std::map<std::string, unsigned> n_reads;
+    std::map<std::string, LocalVariable*> first_read;
+    for (auto method: methods) {
+        for (auto& sym: indexed_locals(method->scope())) {
+            if (sym->is_read()) {
+                auto key = shared_read_key(sym);
+                ++n_reads[key];
+                first_read.insert({key, sym});
+            }
+        }
+    }
+
+    std::map<std::string, LocalVariable*> shared;
+    for (auto& entry: first_read) {
+        if (n_reads[entry.first]>1) {
+            shared.insert(entry);
+        }
+    }
+    return shared;
+}
+
+void emit_api_body(std::ostream& out, const std::vector<APIMethod*>& all_methods) {
+    auto methods = nonempty_api_methods(all_methods);
+    bool scoped = methods.size()>1;
+    auto shared = shared_indexed_reads(methods);
+
+    if (!methods.empty()) {
         out <<
             "int n_ = width_;\n"
             "for (int i_ = 0; i_ < n_; ++i_) {\n" << indent;
 
-        for (auto& sym: indexed_vars) {
-            emit_state_read(out, sym);
+        for (auto& entry: shared) {
+            out << "value_type " << shared_read_name(entry.second) << " = "
+                << cprint(entry.second->external_variable()) << ";\n";
         }
-        out << cprint(body);
 
-        for (auto& sym: indexed_vars) {
-            emit_state_update(out, sym, sym->external_variable());
+        for (auto method: methods) {
+            auto indexed_vars = indexed_locals(method->scope());
+            scoped && out << "{\n" << indent;
+
+            for (auto& sym: indexed_vars) {
+                if (sym->is_read() && shared.count(shared_read_key(sym))) {
+                    out << "value_type " << cprint(sym) << " = " << shared_read_name(sym) << ";\n";
+                }
+                else {
+                    emit_state_read(out, sym);
+                }
+            }
+            out << cprint(method->body());
+
+            for (auto& sym: indexed_vars) {
+                emit_state_update(out, sym, sym->external_variable());
+            }
+            scoped && out << popindent << "}\n";
         }
         out << popindent << "}\n";
     }
@@ -486,10 +580,6 @@ void emit_api_body(std::ostream& out, APIMethod* method) {
 
 // SIMD printing:
 
-static std::string index_i_name(const std::string& index_var) {
-    return index_var+"i_";
-}
-
 void SimdPrinter::visit(IdentifierExpression *e) {
     e->symbol()->accept(this);
 }
@@ -500,10 +590,11 @@ void SimdPrinter::visit(LocalVariable* sym) {
 
 void SimdPrinter::visit(VariableExpression *sym) {
     if (sym->is_range()) {
-        if(is_indirect_index_)
-            out_ << "simd_value(" << sym->name() << "+index_)";
-        else
-            out_ << "simd_value(" << sym->name() << "+i_)";
+        // Mechanism fields are stored as state_type, the weights as value_type.
+        bool state = sym->linkage()==linkageKind::local;
+        out_ << (state? "simd_value(simd_state(": "simd_value(")
+             << sym->name() << (is_indirect_index_? "+index_": "+i_")
+             << (state? "))": ")");
     }
     else {
         out_ << sym->name();
@@ -518,12 +609,12 @@ void SimdPrinter::visit(AssignmentExpression* e) {
     Symbol* lhs = e->lhs()->is_identifier()->symbol();
 
     if (lhs->is_variable() && lhs->is_variable()->is_range()) {
-        out_ << "simd_value(";
+        out_ << "simd_state(simd_value(";
         e->rhs()->accept(this);
         if(is_indirect_index_)
-            out_ << ").copy_to(" << lhs->name() << "+index_)";
+            out_ << ")).copy_to(" << lhs->name() << "+index_)";
         else
-            out_ << ").copy_to(" << lhs->name() << "+i_)";
+            out_ << ")).copy_to(" << lhs->name() << "+i_)";
     }
     else {
         out_ << lhs->name() << " = ";
@@ -544,7 +635,9 @@ void SimdPrinter::visit(IndexedVariable *sym) {
 }
 
 void SimdPrinter::visit(CallExpression* e) {
-    out_ << e->name() << "(i_";
+    // Within the per-constraint loops of an API method, the offset of the
+    // SIMD chunk is index_, not the loop counter i_.
+    out_ << e->name() << (is_indirect_index_? "(index_": "(i_");
     for (auto& arg: e->args()) {
         out_ << ", ";
         arg->accept(this);
@@ -585,19 +678,25 @@ void emit_simd_procedure_proto(std::ostream& out, ProcedureExpression* e, const
     out << ")";
 }
 
-void emit_simd_state_read(std::ostream& out, LocalVariable* local, simd_expr_constraint constraint) {
-    out << "simd_value " << local->name();
+void emit_simd_state_read(std::ostream& out, LocalVariable* local, simd_expr_constraint constraint,
+                          const std::string& name) {
+    out << "simd_value " << name;
 
     if (local->is_read()) {
         indexed_variable_info v = decode_indexed_variable(local->external_variable());
+
+        // Vector loads of state data are converted from simd_state.
+        const char* load_open = v.state? "(simd_state(": "(";
+        const char* load_close = v.state? "));\n": ");\n";
+
         if (v.scalar()) {
             out << "(" << v.data_var
                 << "[0]);\n";
         }
         else if (constraint == simd_expr_constraint::contiguous) {
-            out << "(" <<  v.data_var
+            out << load_open <<  v.data_var
                 << " + " << v.index_var
-                << "[index_]);\n";
+                << "[index_]" << load_close;
         }
         else if (constraint == simd_expr_constraint::constant) {
             out << "(" << v.data_var
@@ -605,7 +704,7 @@ void emit_simd_state_read(std::ostream& out, LocalVariable* local, simd_expr_con
                 << "element0]);\n";
         }
         else {
-            out << "(" <<  simdprint(local->external_variable()) << ");\n";
+            out << load_open <<  simdprint(local->external_variable()) << load_close;
         }
     }
     else {
@@ -623,14 +722,18 @@ void emit_simd_state_update(std::ostream& out, Symbol* from, IndexedVariable* ex
         throw compiler_exception("Cannot assign to global scalar: "+external->to_string());
     }
     else {
+        // Updates of state data are converted to simd_state.
+        std::string simd_type = v.state? "simd_state": "simd_value";
+        std::string value = v.state? "simd_state("+from->name()+")": from->name();
+
         if (constraint == simd_expr_constraint::contiguous) {
-            out << "simd_value t_"<< external->name() <<"(" << v.data_var << " + " << v.index_var << "[index_]);\n";
-            out << "t_" << external->name() << op << from->name() << ";\n";
+            out << simd_type << " t_"<< external->name() <<"(" << v.data_var << " + " << v.index_var << "[index_]);\n";
+            out << "t_" << external->name() << op << value << ";\n";
             out << "t_" << external->name() << ".copy_to(" << v.data_var << " + " << v.index_var << "[index_]);\n";
 
         }
         else {
-            out << simdprint(external) << op << from->name() << ";\n";
+            out << simdprint(external) << op << value << ";\n";
         }
     }
 }
@@ -656,27 +759,43 @@ void emit_index_initialize(std::ostream& out, const std::unordered_set<std::stri
     }
 }
 
-void emit_body_for_loop(std::ostream& out, BlockExpression* body, const std::vector<LocalVariable*>& indexed_vars,
+void emit_body_for_loop(std::ostream& out, const std::vector<APIMethod*>& methods,
                         const std::unordered_set<std::string>& indices, const simd_expr_constraint& read_constraint,
                         const simd_expr_constraint& write_constraint) {
     emit_index_initialize(out, indices, read_constraint);
 
-    for (auto& sym: indexed_vars) {
-        emit_simd_state_read(out, sym, read_constraint);
+    auto shared = shared_indexed_reads(methods);
+    for (auto& entry: shared) {
+        emit_simd_state_read(out, entry.second, read_constraint, shared_read_name(entry.second));
     }
 
-    simdprint printer(body);
-    printer.set_indirect_index();
+    bool scoped = methods.size()>1;
+    for (auto method: methods) {
+        auto indexed_vars = indexed_locals(method->scope());
+        scoped && out << "{\n" << indent;
 
-    out << printer;
+        for (auto& sym: indexed_vars) {
+            if (sym->is_read() && shared.count(shared_read_key(sym))) {
+                out << "simd_value " << sym->name() << "(" << shared_read_name(sym) << ");\n";
+            }
+            else {
+                emit_simd_state_read(out, sym, read_constraint, sym->name());
+            }
+        }
 
-    for (auto& sym: indexed_vars) {
-        emit_simd_state_update(out, sym, sym->external_variable(), write_constraint);
+        simdprint printer(method->body());
+        printer.set_indirect_index();
+
+        out << printer;
+
+        for (auto& sym: indexed_vars) {
+            emit_simd_state_update(out, sym, sym->external_variable(), write_constraint);
+        }
+        scoped && out << popindent << "}\n";
     }
 }
 
-void emit_for_loop_per_constraint(std::ostream& out, BlockExpression* body,
-                                  const std::vector<LocalVariable*>& indexed_vars,
+void emit_for_loop_per_constraint(std::ostream& out, const std::vector<APIMethod*>& methods,
                                   const std::unordered_set<std::string>& indices,
                                   const simd_expr_constraint& read_constraint,
                                   const simd_expr_constraint& write_constraint,
@@ -689,28 +808,26 @@ void emit_for_loop_per_constraint(std::ostream& out, BlockExpression* body,
 
     out << "index_type index_ = index_constraints_." << underlying_constraint_name << "[i_];\n";
 
-    emit_body_for_loop(out, body, indexed_vars, indices, read_constraint, write_constraint);
+    emit_body_for_loop(out, methods, indices, read_constraint, write_constraint);
 
     out << popindent << "}\n";
 }
 
-void emit_simd_api_body(std::ostream& out, APIMethod* method, moduleKind module_kind) {
-    auto body = method->body();
-    auto indexed_vars = indexed_locals(method->scope());
+void emit_simd_api_body(std::ostream& out, const std::vector<APIMethod*>& all_methods, moduleKind module_kind) {
+    auto methods = nonempty_api_methods(all_methods);
+    bool scoped = methods.size()>1;
 
-    std::vector<LocalVariable*> scalar_indexed_vars;
     std::unordered_set<std::string> indices;
-    for (auto& sym: indexed_vars) {
-        auto info = decode_indexed_variable(sym->external_variable());
-        if (!info.scalar()) {
-            indices.insert(info.index_var);
-        }
-        else {
-            scalar_indexed_vars.push_back(sym);
+    for (auto method: methods) {
+        for (auto& sym: indexed_locals(method->scope())) {
+            auto info = decode_indexed_variable(sym->external_variable());
+            if (!info.scalar()) {
+                indices.insert(info.index_var);
+            }
         }
     }
 
-    if (!body->statements().empty()) {
+    if (!methods.empty()) {
         if (!indices.empty()) {
             for (auto& index: indices) {
                 out << "simd_index " << index_i_name(index) << ";\n";
@@ -722,21 +839,21 @@ void emit_simd_api_body(std::ostream& out, APIMethod* method, moduleKind module_
             simd_expr_constraint constraint = simd_expr_constraint::contiguous;
             std::string underlying_constraint = "contiguous";
 
-            emit_for_loop_per_constraint(out, body, indexed_vars, indices, constraint,
+            emit_for_loop_per_constraint(out, methods, indices, constraint,
                                          constraint, underlying_constraint);
 
             //Generate for loop for all independent simd_vectors
             constraint = simd_expr_constraint::other;
             underlying_constraint = "independent";
 
-            emit_for_loop_per_constraint(out, body, indexed_vars, indices, constraint,
+            emit_for_loop_per_constraint(out, methods, indices, constraint,
                                          constraint, underlying_constraint);
 
             //Generate for loop for all simd_vectors that have no optimizing constraints
             constraint = simd_expr_constraint::other;
             underlying_constraint = "none";
 
-            emit_for_loop_per_constraint(out, body, indexed_vars, indices, constraint,
+            emit_for_loop_per_constraint(out, methods, indices, constraint,
                                          constraint, underlying_constraint);
 
             //Generate for loop for all constant simd_vectors
@@ -744,21 +861,36 @@ void emit_simd_api_body(std::ostream& out, APIMethod* method, moduleKind module_
             simd_expr_constraint write_constraint = simd_expr_constraint::other;
             underlying_constraint = "constant";
 
-            emit_for_loop_per_constraint(out, body, indexed_vars, indices, read_constraint,
+            emit_for_loop_per_constraint(out, methods, indices, read_constraint,
                                          write_constraint, underlying_constraint);
 
         }
         else {
-            // We may nonetheless need to read a global scalar indexed variable.
-            for (auto& sym: scalar_indexed_vars) {
-                emit_simd_state_read(out, sym, simd_expr_constraint::other);
+            // We may nonetheless need to read a global scalar indexed variable;
+            // with more than one method, these are read in the method's scope.
+            auto emit_scalar_reads = [&](APIMethod* method) {
+                for (auto& sym: indexed_locals(method->scope())) {
+                    emit_simd_state_read(out, sym, simd_expr_constraint::other, sym->name());
+                }
+            };
+
+            if (!scoped) {
+                emit_scalar_reads(methods.front());
             }
 
             out <<
                 "unsigned n_ = width_;\n\n"
-                "for (unsigned i_ = 0; i_ < n_; i_ += simd_width_) {\n" << indent <<
-                simdprint(body) << popindent <<
-                "}\n";
+                "for (unsigned i_ = 0; i_ < n_; i_ += simd_width_) {\n" << indent;
+
+            for (auto method: methods) {
+                if (scoped) {
+                    out << "{\n" << indent;
+                    emit_scalar_reads(method);
+                }
+                out << simdprint(method->body());
+                scoped && out << popindent << "}\n";
+            }
+            out << popindent << "}\n";
         }
     }
 }
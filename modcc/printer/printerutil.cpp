@@ -113,9 +113,37 @@ NetReceiveExpression* find_net_receive(const Module& m) {
     return it==m.symbols().end()? nullptr: it->second->is_net_receive();
 }
 
+bool fusible_state_current(const Module& m) {
+    if (m.kind()!=moduleKind::density || find_net_receive(m)) return false;
+
+    APIMethod* write_ions_api = find_api_method(m, "write_ions");
+    if (write_ions_api && !write_ions_api->body()->statements().empty()) return false;
+
+    if (APIMethod* state_api = find_api_method(m, "nrn_state")) {
+        for (auto local: indexed_locals(state_api->scope())) {
+            auto src = local->external_variable()->data_source();
+            if (src!=sourceKind::voltage && src!=sourceKind::dt && src!=sourceKind::temperature) {
+                return false;
+            }
+        }
+    }
+
+    if (APIMethod* current_api = find_api_method(m, "nrn_current")) {
+        for (auto local: indexed_locals(current_api->scope())) {
+            auto src = local->external_variable()->data_source();
+            if (local->is_read() && (src==sourceKind::current || src==sourceKind::ion_current)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 indexed_variable_info decode_indexed_variable(IndexedVariable* sym) {
     std::string data_var, ion_pfx;
     std::string index_var = "node_index_";
+    bool state = false;
 
     if (sym->is_ion()) {
         ion_pfx = "ion_"+to_string(sym->ion_channel())+"_";
@@ -140,9 +168,11 @@ indexed_variable_info decode_indexed_variable(IndexedVariable* sym) {
         break;
     case sourceKind::ion_iconc:
         data_var=ion_pfx+".internal_concentration";
+        state = true;
         break;
     case sourceKind::ion_econc:
         data_var=ion_pfx+".external_concentration";
+        state = true;
         break;
     case sourceKind::temperature:
         data_var="temperature_degC_";
@@ -152,5 +182,5 @@ indexed_variable_info decode_indexed_variable(IndexedVariable* sym) {
         throw compiler_exception(pprintf("unrecognized indexed data source: %", sym), sym->location());
     }
 
-    return {data_var, index_var};
+    return {data_var, index_var, state};
 }
@@ -114,9 +114,22 @@ APIMethod* find_api_method(const Module& m, const char* which);
 
 NetReceiveExpression* find_net_receive(const Module& m);
 
+// Can the state update of an integration step and the current computation
+// of the next be fused into one pass over the mechanism instance?
+//
+// The fused pass follows the ion concentration update of the step, and
+// precedes the current computation of the other mechanisms, so the state
+// update may read only the voltage, time step and temperature, and the
+// current computation may not read currents. The mechanism must be a
+// density mechanism that does not write ion concentrations.
+
+bool fusible_state_current(const Module& m);
+
 struct indexed_variable_info {
     std::string data_var;
     std::string index_var;
+    // Data is stored with the mechanism state type (ion concentrations).
+    bool state = false;
     bool scalar() const { return index_var.empty(); }
 };
 
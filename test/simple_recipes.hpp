@@ -50,6 +50,10 @@ public:
         return catalogue_;
     }
 
+    mc_cell_global_properties& cell_global_properties() {
+        return cell_gprop_;
+    }
+
 protected:
     std::unordered_map<cell_gid_type, std::vector<probe_info>> probes_;
     mc_cell_global_properties cell_gprop_;
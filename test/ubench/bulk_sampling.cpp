@@ -0,0 +1,127 @@
+// Compare the cost of sampling every CV of a cell with many compartments
+// at every time step, through:
+//
+//   none:    no sampler, for the cost of the integration alone;
+//   records: a sampler_function called for each probe, which any_casts each
+//            sample record and appends it to a trace, as simple_sampler does;
+//   columns: a bulk sampler called once per epoch for all of the probes,
+//            recording with a columnar_recorder.
+//
+// The cell is a soma with hh and a dendrite with pas, with a probe on the
+// voltage of each CV, integrated with dt 0.025 ms in epochs of 1 ms.
+
+#include <unordered_map>
+#include <vector>
+
+#include <arbor/mc_cell.hpp>
+#include <arbor/recipe.hpp>
+#include <arbor/sampling.hpp>
+#include <arbor/schedule.hpp>
+#include <arbor/simple_sampler.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include "epoch.hpp"
+#include "fvm_lowered_cell.hpp"
+#include "mc_cell_group.hpp"
+#include "util/span.hpp"
+
+using namespace arb;
+
+constexpr time_type dt = 0.025;
+constexpr time_type t_epoch = 1;
+constexpr unsigned n_epochs = 10;
+
+class sampled_recipe: public recipe {
+public:
+    explicit sampled_recipe(unsigned ncomp): ncomp_(ncomp) {}
+
+    cell_size_type num_cells() const override { return 1; }
+    cell_kind get_cell_kind(cell_gid_type) const override { return cell_kind::cable1d_neuron; }
+
+    util::unique_any get_cell_description(cell_gid_type) const override {
+        mc_cell c;
+        c.add_soma(6)->add_mechanism("hh");
+        auto dend = c.add_cable(0, section_kind::dendrite, 0.5, 0.5, 2000);
+        dend->add_mechanism("pas");
+        dend->set_compartments(ncomp_);
+        c.add_stimulus({1, 1}, {1, 1000, 0.2});
+        return c;
+    }
+
+    cell_size_type num_probes(cell_gid_type) const override { return ncomp_; }
+
+    probe_info get_probe(cell_member_type id) const override {
+        segment_location loc(1, (id.index+1.)/ncomp_);
+        return {id, 0, cell_probe_address{loc, cell_probe_address::membrane_voltage}};
+    }
+
+private:
+    unsigned ncomp_;
+};
+
+enum class sampler_kind { none, records, columns };
+
+void run_sampling(benchmark::State& state, sampler_kind kind) {
+    const unsigned ncomp = state.range(0);
+    execution_context context;
+    sampled_recipe rec(ncomp);
+
+    std::vector<cell_member_type> probe_ids;
+    for (auto i: util::make_span(ncomp)) {
+        probe_ids.push_back({0, i});
+    }
+
+    const std::size_t n_samples = n_epochs*t_epoch/dt+1;
+    std::unordered_map<cell_member_type, trace_data<double>> traces;
+    for (auto pid: probe_ids) {
+        traces[pid].reserve(n_samples);
+    }
+    columnar_recorder recorder(probe_ids, n_samples);
+
+    mc_cell_group group({0}, rec, make_fvm_lowered_cell(backend_kind::multicore, context));
+    if (kind==sampler_kind::records) {
+        group.add_sampler(0, all_probes, regular_schedule(dt),
+            [&](cell_member_type pid, probe_tag, std::size_t n, const sample_record* recs) {
+                auto& trace = traces.at(pid);
+                for (std::size_t i = 0; i<n; ++i) {
+                    trace.push_back({recs[i].time, *util::any_cast<const double*>(recs[i].data)});
+                }
+            },
+            sampling_policy::lax);
+    }
+    else if (kind==sampler_kind::columns) {
+        group.add_bulk_sampler(0, all_probes, regular_schedule(dt), recorder.sampler(), sampling_policy::lax);
+    }
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        group.reset();
+        for (auto& t: traces) t.second.clear();
+        recorder.clear();
+        state.ResumeTiming();
+
+        for (auto i: util::make_span(n_epochs)) {
+            group.advance(epoch(i, (i+1)*t_epoch), dt, {});
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+void none(benchmark::State& state) {
+    run_sampling(state, sampler_kind::none);
+}
+
+void records(benchmark::State& state) {
+    run_sampling(state, sampler_kind::records);
+}
+
+void columns(benchmark::State& state) {
+    run_sampling(state, sampler_kind::columns);
+}
+
+BENCHMARK(none)->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+BENCHMARK(records)->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+BENCHMARK(columns)->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
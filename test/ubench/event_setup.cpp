@@ -15,10 +15,15 @@
 #include <vector>
 #include <algorithm>
 
+#include <arbor/event_generator.hpp>
+
 #include <benchmark/benchmark.h>
 
 #include "event_queue.hpp"
 #include "backends/event.hpp"
+#include "merge_events.hpp"
+#include "threading/threading.hpp"
+#include "util/rangeutil.hpp"
 
 using namespace arb;
 
@@ -190,6 +195,61 @@ void n_vector(benchmark::State& state) {
     }
 }
 
+// The per-cell work of simulation_state::setup_events: sort the pending
+// events of each cell and merge them into the cell's event lane.
+// state.range(0): number of cells
+// state.range(1): mean number of events per cell
+// state.range(2): grain size of the parallel_for; 0 for automatic.
+void setup_events(benchmark::State& state) {
+    const std::size_t ncells = state.range(0);
+    const std::size_t ev_per_cell = state.range(1);
+    const int grain = state.range(2);
+
+    auto input_events = generate_inputs(ncells, ev_per_cell);
+
+    threading::task_system ts;
+    std::vector<pse_vector> pending(ncells);
+    std::vector<pse_vector> old_lanes(ncells);
+    std::vector<pse_vector> new_lanes(ncells);
+    std::vector<std::vector<event_generator>> generators(ncells);
+
+    auto body = [&](std::size_t i) {
+        util::sort(pending[i]);
+        merge_cell_events(0, 1,
+            util::range_pointer_view(old_lanes[i]),
+            util::range_pointer_view(pending[i]),
+            generators[i], new_lanes[i]);
+        pending[i].clear();
+    };
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        for (const auto& e: input_events) {
+            pending[e.target.gid].push_back(e);
+        }
+        state.ResumeTiming();
+
+        if (grain) {
+            threading::parallel_for::apply(0, ncells, grain, &ts, body);
+        }
+        else {
+            threading::parallel_for::apply(0, ncells, &ts, body);
+        }
+
+        benchmark::ClobberMemory();
+    }
+}
+
+void setup_events_arguments(benchmark::internal::Benchmark* b) {
+    for (auto ncells: {10000, 1000000}) {
+        for (auto ev_per_cell: {4, 16}) {
+            for (auto grain: {1, 0}) {
+                b->Args({ncells, ev_per_cell, grain});
+            }
+        }
+    }
+}
+
 void run_custom_arguments(benchmark::internal::Benchmark* b) {
     for (auto ncells: {1, 10, 100, 1000, 10000}) {
         for (auto ev_per_cell: {128, 256, 512, 1024, 2048, 4096}) {
@@ -202,5 +262,6 @@ void run_custom_arguments(benchmark::internal::Benchmark* b) {
 BENCHMARK(single_queue)->Apply(run_custom_arguments);
 BENCHMARK(n_queue)->Apply(run_custom_arguments);
 BENCHMARK(n_vector)->Apply(run_custom_arguments);
+BENCHMARK(setup_events)->Apply(setup_events_arguments)->Unit(benchmark::kMillisecond);
 
 BENCHMARK_MAIN();
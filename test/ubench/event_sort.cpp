@@ -0,0 +1,78 @@
+// Compare methods for sorting the pending events of each cell in the
+// "event-setup" step: a comparison sort, and the bucket sort on delivery time
+// used by simulation_state::setup_events.
+//
+// The pending events of all cells are stored contiguously, as in the
+// event_lane_store, with delivery times drawn uniformly from a window of
+// width one.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <arbor/spike_event.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include "event_queue.hpp"
+#include "event_sort.hpp"
+#include "util/rangeutil.hpp"
+
+using namespace arb;
+
+pse_vector generate_lanes(std::size_t ncells, std::size_t ev_per_cell) {
+    std::mt19937 gen;
+    std::uniform_real_distribution<float> time_dist(10.f, 11.f);
+    std::uniform_int_distribution<cell_lid_type> target_dist(0u, 99u);
+
+    pse_vector events;
+    events.reserve(ncells*ev_per_cell);
+    for (std::size_t i=0; i<ncells; ++i) {
+        for (std::size_t j=0; j<ev_per_cell; ++j) {
+            events.push_back({{cell_gid_type(i), target_dist(gen)}, time_dist(gen), 0.f});
+        }
+    }
+    return events;
+}
+
+template <typename Sort>
+void run_sort(benchmark::State& state, Sort&& sort) {
+    const std::size_t ncells = state.range(0);
+    const std::size_t ev_per_cell = state.range(1);
+
+    const auto input = generate_lanes(ncells, ev_per_cell);
+    auto events = input;
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        std::copy(input.begin(), input.end(), events.begin());
+        state.ResumeTiming();
+
+        for (std::size_t i=0; i<ncells; ++i) {
+            auto first = events.data()+i*ev_per_cell;
+            sort(event_range(first, first+ev_per_cell));
+        }
+
+        benchmark::ClobberMemory();
+    }
+}
+
+void comparison_sort(benchmark::State& state) {
+    run_sort(state, [](event_range lane) { std::sort(lane.begin(), lane.end()); });
+}
+
+void bucket_sort(benchmark::State& state) {
+    event_sort_buffer buffer;
+    run_sort(state, [&](event_range lane) { bucket_sort_events(lane, buffer); });
+}
+
+void sort_arguments(benchmark::internal::Benchmark* b) {
+    for (auto ev_per_cell: {16, 64, 256, 1024, 4096}) {
+        b->Args({(1<<20)/ev_per_cell, ev_per_cell});
+    }
+}
+
+BENCHMARK(comparison_sort)->Apply(sort_arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(bucket_sort)->Apply(sort_arguments)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
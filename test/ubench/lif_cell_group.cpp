@@ -0,0 +1,180 @@
+// Compare implementations of the update of a group of LIF cells:
+//
+//   cell_exact:  the exact solution, one cell at a time, with the cell
+//                state in an array of lif_cell structs (the former
+//                implementation of lif_cell_group);
+//   group_exact: lif_cell_group with the exact solution, vectorized across
+//                the cells of the group;
+//   group_stepped: lif_cell_group with fixed time steps of 0.1 ms;
+//   group_exact_sampled: group_exact, with the membrane potential of every
+//                cell sampled every 0.1 ms.
+//
+// Each cell receives Poisson input at the given number of events per ms,
+// delivered in epochs of 1 ms over 100 ms.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <arbor/lif_cell.hpp>
+#include <arbor/recipe.hpp>
+#include <arbor/sampling.hpp>
+#include <arbor/schedule.hpp>
+#include <arbor/spike.hpp>
+#include <arbor/spike_event.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include "epoch.hpp"
+#include "event_lanes.hpp"
+#include "lif_cell_group.hpp"
+#include "util/rangeutil.hpp"
+#include "util/span.hpp"
+
+using namespace arb;
+
+constexpr unsigned ncells = 10000;
+constexpr time_type t_epoch = 1;
+constexpr unsigned n_epochs = 100;
+constexpr time_type dt = 0.1;
+
+class lif_recipe: public recipe {
+public:
+    lif_recipe(lif_integration integration): integration_(integration) {}
+
+    cell_size_type num_cells() const override { return ncells; }
+    cell_kind get_cell_kind(cell_gid_type) const override { return cell_kind::lif_neuron; }
+
+    util::unique_any get_cell_description(cell_gid_type) const override {
+        lif_cell cell;
+        cell.integration = integration_;
+        return cell;
+    }
+
+    cell_size_type num_probes(cell_gid_type) const override { return 1; }
+    probe_info get_probe(cell_member_type id) const override { return {id, 0, {}}; }
+
+private:
+    lif_integration integration_;
+};
+
+// The event lanes of each epoch, with the weight of the excitatory synapses
+// of the Brunel network: more than 150 events are needed to reach the
+// threshold from rest, and cells fire for rates above about 17 events per ms.
+std::vector<event_lane_store> make_event_lanes(double events_per_ms) {
+    std::mt19937 gen;
+    std::exponential_distribution<double> interval(events_per_ms);
+
+    std::vector<event_lane_store> lanes(n_epochs, event_lane_store(ncells));
+    std::vector<std::vector<pse_vector>> events(n_epochs, std::vector<pse_vector>(ncells));
+    for (cell_gid_type i = 0; i<ncells; ++i) {
+        for (double t = interval(gen); t<n_epochs*t_epoch; t += interval(gen)) {
+            events[unsigned(t/t_epoch)][i].push_back({{i, 0}, time_type(t), 1.2f});
+        }
+    }
+    for (unsigned e = 0; e<n_epochs; ++e) {
+        for (unsigned i = 0; i<ncells; ++i) {
+            lanes[e].add_count(i, events[e][i].size());
+        }
+        lanes[e].allocate();
+        for (unsigned i = 0; i<ncells; ++i) {
+            std::copy(events[e][i].begin(), events[e][i].end(), lanes[e].lane(i).begin());
+        }
+    }
+    return lanes;
+}
+
+void run_group(benchmark::State& state, lif_integration integration, bool sampled = false) {
+    auto lanes = make_event_lanes(state.range(0));
+    std::vector<cell_gid_type> gids = util::assign_from(util::make_span(ncells));
+    lif_cell_group group(gids, lif_recipe(integration));
+
+    double sum = 0;
+    if (sampled) {
+        group.add_sampler(0, all_probes, regular_schedule(dt),
+            [&sum](cell_member_type, probe_tag, std::size_t n, const sample_record* recs) {
+                for (std::size_t i = 0; i<n; ++i) {
+                    sum += *util::any_cast<const double*>(recs[i].data);
+                }
+            },
+            sampling_policy::lax);
+    }
+
+    while (state.KeepRunning()) {
+        group.reset();
+        epoch ep;
+        for (auto& l: lanes) {
+            ep.advance(ep.tfinal+t_epoch);
+            group.advance(ep, dt, l.subrange(0, ncells));
+            group.clear_spikes();
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+}
+
+void cell_exact(benchmark::State& state) {
+    auto lanes = make_event_lanes(state.range(0));
+    std::vector<lif_cell> cells(ncells);
+    std::vector<time_type> t_last(ncells);
+    std::vector<spike> spikes;
+
+    while (state.KeepRunning()) {
+        std::fill(cells.begin(), cells.end(), lif_cell());
+        std::fill(t_last.begin(), t_last.end(), 0);
+        epoch ep;
+        for (auto& l: lanes) {
+            ep.advance(ep.tfinal+t_epoch);
+            for (unsigned lid = 0; lid<ncells; ++lid) {
+                auto lane = l[lid];
+                auto& cell = cells[lid];
+                auto t = t_last[lid];
+                for (unsigned i = 0; i<lane.size(); ++i) {
+                    const auto time = lane[i].time;
+                    auto weight = lane[i].weight;
+                    if (time<t) continue;
+                    if (time>=ep.tfinal) break;
+                    while (i+1<lane.size() && lane[i+1].time<=time) {
+                        weight += lane[++i].weight;
+                    }
+                    cell.V_m *= std::exp(-(time-t)/cell.tau_m);
+                    cell.V_m += weight/cell.C_m;
+                    t = time;
+                    if (cell.V_m>=cell.V_th) {
+                        spikes.push_back({{lid, 0}, t});
+                        t += cell.t_ref;
+                        cell.V_m = cell.E_L;
+                    }
+                }
+                t_last[lid] = t;
+            }
+            spikes.clear();
+        }
+    }
+}
+
+void group_exact(benchmark::State& state) {
+    run_group(state, lif_integration::exact);
+}
+
+void group_stepped(benchmark::State& state) {
+    run_group(state, lif_integration::stepped);
+}
+
+void group_exact_sampled(benchmark::State& state) {
+    run_group(state, lif_integration::exact, true);
+}
+
+// Events per ms per cell.
+void rate_arguments(benchmark::internal::Benchmark* b) {
+    for (auto rate: {1, 10, 100}) {
+        b->Args({rate});
+    }
+}
+
+BENCHMARK(cell_exact)->Apply(rate_arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(group_exact)->Apply(rate_arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(group_stepped)->Apply(rate_arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(group_exact_sampled)->Apply(rate_arguments)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,118 @@
+// Compare assembly and solution of the Hines matrices of many small cells
+// with the flat matrix state (one cell at a time) and the interleaved matrix
+// state (one cell per SIMD lane), with separate or fused assembly and solve.
+//
+// Build with the target architecture flags (ARB_ARCH) to enable native SIMD;
+// without native SIMD the interleaved state uses a width of one.
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "backends/multicore/matrix_state.hpp"
+#include "backends/multicore/matrix_state_interleaved.hpp"
+#include "util/span.hpp"
+
+using namespace arb;
+
+using value_type = fvm_value_type;
+using index_type = fvm_index_type;
+
+struct cell_matrices {
+    std::vector<index_type> p;
+    std::vector<index_type> cell_cv_divs = {0};
+    std::vector<value_type> cap, cond, area;
+
+    multicore::array dt, voltage, current;
+};
+
+// Build ncells cells of ncv CVs each; with nshapes>1, the cells are given
+// one of nshapes random tree structures.
+cell_matrices make_cells(unsigned ncells, unsigned ncv, unsigned nshapes) {
+    std::minstd_rand R;
+    std::uniform_real_distribution<value_type> U(0.5, 2.);
+
+    std::vector<std::vector<index_type>> shapes(nshapes);
+    for (auto& s: shapes) {
+        s.assign(ncv, 0);
+        for (auto i: util::make_span(1u, ncv)) {
+            s[i] = std::uniform_int_distribution<index_type>(i>8? i-8: 0, i-1)(R);
+        }
+    }
+
+    cell_matrices m;
+    for (auto c: util::make_span(ncells)) {
+        const auto& s = shapes[c%nshapes];
+        auto first = m.cell_cv_divs.back();
+        for (auto j: s) {
+            m.p.push_back(first+j);
+        }
+        m.cell_cv_divs.push_back(first+ncv);
+    }
+
+    const auto n = m.p.size();
+    for (auto i: util::make_span(n)) {
+        (void)i;
+        m.cap.push_back(U(R));
+        m.cond.push_back(U(R));
+        m.area.push_back(U(R));
+    }
+    m.dt = multicore::array(ncells, 0.025);
+    m.voltage = multicore::array(n, -65.);
+    m.current = multicore::array(n, 0.1);
+    return m;
+}
+
+template <typename State, bool fused>
+void run_solve(benchmark::State& state) {
+    auto m = make_cells(state.range(0), state.range(1), state.range(2));
+    State s(m.p, m.cell_cv_divs, m.cap, m.cond, m.area);
+
+    while (state.KeepRunning()) {
+        if (fused) {
+            s.assemble_and_solve(m.dt, m.voltage, m.current);
+        }
+        else {
+            s.assemble(m.dt, m.voltage, m.current);
+            s.solve();
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+using flat_state = multicore::matrix_state<value_type, index_type>;
+using interleaved_state = multicore::matrix_state_interleaved<value_type, index_type>;
+
+void flat(benchmark::State& state) {
+    run_solve<flat_state, false>(state);
+}
+
+void flat_fused(benchmark::State& state) {
+    run_solve<flat_state, true>(state);
+}
+
+void interleaved(benchmark::State& state) {
+    run_solve<interleaved_state, false>(state);
+}
+
+void interleaved_fused(benchmark::State& state) {
+    run_solve<interleaved_state, true>(state);
+}
+
+void run_custom_arguments(benchmark::internal::Benchmark* b) {
+    for (auto ncells: {1000, 10000}) {
+        for (auto ncv: {5, 20, 100}) {
+            for (auto nshapes: {1, 8}) {
+                b->Args({ncells, ncv, nshapes});
+            }
+        }
+    }
+}
+
+BENCHMARK(flat)->Apply(run_custom_arguments);
+BENCHMARK(flat_fused)->Apply(run_custom_arguments);
+BENCHMARK(interleaved)->Apply(run_custom_arguments);
+BENCHMARK(interleaved_fused)->Apply(run_custom_arguments);
+
+BENCHMARK_MAIN();
@@ -208,7 +208,8 @@ void expsyn_1_branch_current(benchmark::State& state) {
     std::vector<target_handle> target_handles;
     probe_association_map<probe_handle> probe_handles;
 
-    fvm_cell cell;
+    execution_context context;
+    fvm_cell cell(context);
     cell.initialize(gids, rec_expsyn_1_branch, target_handles, probe_handles);
 
     auto& m = find_mechanism("expsyn", cell);
@@ -227,7 +228,8 @@ void expsyn_1_branch_state(benchmark::State& state) {
     std::vector<target_handle> target_handles;
     probe_association_map<probe_handle> probe_handles;
 
-    fvm_cell cell;
+    execution_context context;
+    fvm_cell cell(context);
     cell.initialize(gids, rec_expsyn_1_branch, target_handles, probe_handles);
 
     auto& m = find_mechanism("expsyn", cell);
@@ -245,7 +247,8 @@ void pas_1_branch_current(benchmark::State& state) {
     std::vector<target_handle> target_handles;
     probe_association_map<probe_handle> probe_handles;
 
-    fvm_cell cell;
+    execution_context context;
+    fvm_cell cell(context);
     cell.initialize(gids, rec_pas_1_branch, target_handles, probe_handles);
 
     auto& m = find_mechanism("pas", cell);
@@ -263,7 +266,8 @@ void pas_3_branches_current(benchmark::State& state) {
     std::vector<target_handle> target_handles;
     probe_association_map<probe_handle> probe_handles;
 
-    fvm_cell cell;
+    execution_context context;
+    fvm_cell cell(context);
     cell.initialize(gids, rec_pas_3_branches, target_handles, probe_handles);
 
     auto& m = find_mechanism("pas", cell);
@@ -281,7 +285,8 @@ void hh_1_branch_state(benchmark::State& state) {
     std::vector<target_handle> target_handles;
     probe_association_map<probe_handle> probe_handles;
 
-    fvm_cell cell;
+    execution_context context;
+    fvm_cell cell(context);
     cell.initialize(gids, rec_hh_1_branch, target_handles, probe_handles);
 
     auto& m = find_mechanism("hh", cell);
@@ -299,7 +304,8 @@ void hh_1_branch_current(benchmark::State& state) {
     std::vector<target_handle> target_handles;
     probe_association_map<probe_handle> probe_handles;
 
-    fvm_cell cell;
+    execution_context context;
+    fvm_cell cell(context);
     cell.initialize(gids, rec_hh_1_branch, target_handles, probe_handles);
 
     auto& m = find_mechanism("hh", cell);
@@ -317,7 +323,8 @@ void hh_3_branches_state(benchmark::State& state) {
     std::vector<target_handle> target_handles;
     probe_association_map<probe_handle> probe_handles;
 
-    fvm_cell cell;
+    execution_context context;
+    fvm_cell cell(context);
     cell.initialize(gids, rec_hh_3_branches, target_handles, probe_handles);
 
     auto& m = find_mechanism("hh", cell);
@@ -335,7 +342,8 @@ void hh_3_branches_current(benchmark::State& state) {
     std::vector<target_handle> target_handles;
     probe_association_map<probe_handle> probe_handles;
 
-    fvm_cell cell;
+    execution_context context;
+    fvm_cell cell(context);
     cell.initialize(gids, rec_hh_3_branches, target_handles, probe_handles);
 
     auto& m = find_mechanism("hh", cell);
@@ -345,6 +353,85 @@ void hh_3_branches_current(benchmark::State& state) {
     }
 }
 
+// Density mechanisms hh and pas on every CV: compare separate state update
+// and current computation passes with the fused pass.
+
+class recipe_hh_pas_3_branches: public recipe {
+    unsigned num_comp_;
+public:
+    recipe_hh_pas_3_branches(unsigned num_comp): num_comp_(num_comp) {}
+
+    cell_size_type num_cells() const override {
+        return 1;
+    }
+
+    virtual util::unique_any get_cell_description(cell_gid_type gid) const override {
+        mc_cell c;
+
+        c.add_soma(12.6157/2.0);
+        c.add_cable(0, section_kind::dendrite, 1.0/2, 1.0/2, 200.0);
+        c.add_cable(1, section_kind::dendrite, 1.0/2, 1.0/2, 200.0);
+        c.add_cable(1, section_kind::dendrite, 1.0/2, 1.0/2, 200.0);
+
+        for (auto& seg: c.segments()) {
+            seg->add_mechanism("hh");
+            seg->add_mechanism("pas");
+            if (seg->is_dendrite()) {
+                seg->set_compartments(num_comp_-1);
+            }
+        }
+        return std::move(c);
+    }
+
+    virtual cell_kind get_cell_kind(cell_gid_type) const override {
+        return cell_kind::cable1d_neuron;
+    }
+};
+
+void hh_pas_3_branches_separate(benchmark::State& state) {
+    const unsigned ncomp = state.range(0);
+    recipe_hh_pas_3_branches rec_hh_pas_3_branches(ncomp);
+
+    std::vector<cell_gid_type> gids = {0};
+    std::vector<target_handle> target_handles;
+    probe_association_map<probe_handle> probe_handles;
+
+    execution_context context;
+    fvm_cell cell(context);
+    cell.initialize(gids, rec_hh_pas_3_branches, target_handles, probe_handles);
+
+    auto& hh = find_mechanism("hh", cell);
+    auto& pas = find_mechanism("pas", cell);
+
+    while (state.KeepRunning()) {
+        hh->nrn_state();
+        pas->nrn_state();
+        hh->nrn_current();
+        pas->nrn_current();
+    }
+}
+
+void hh_pas_3_branches_fused(benchmark::State& state) {
+    const unsigned ncomp = state.range(0);
+    recipe_hh_pas_3_branches rec_hh_pas_3_branches(ncomp);
+
+    std::vector<cell_gid_type> gids = {0};
+    std::vector<target_handle> target_handles;
+    probe_association_map<probe_handle> probe_handles;
+
+    execution_context context;
+    fvm_cell cell(context);
+    cell.initialize(gids, rec_hh_pas_3_branches, target_handles, probe_handles);
+
+    auto& hh = find_mechanism("hh", cell);
+    auto& pas = find_mechanism("pas", cell);
+
+    while (state.KeepRunning()) {
+        hh->nrn_state_current();
+        pas->nrn_state_current();
+    }
+}
+
 void run_custom_arguments(benchmark::internal::Benchmark* b) {
     for (auto ncomps: {10, 100, 1000, 10000, 100000, 1000000, 10000000}) {
         b->Args({ncomps});
@@ -363,4 +450,6 @@ BENCHMARK(hh_1_branch_state)->Apply(run_custom_arguments);
 BENCHMARK(pas_3_branches_current)->Apply(run_custom_arguments);
 BENCHMARK(hh_3_branches_current)->Apply(run_custom_arguments);
 BENCHMARK(hh_3_branches_state)->Apply(run_custom_arguments);
+BENCHMARK(hh_pas_3_branches_separate)->Apply(run_custom_arguments);
+BENCHMARK(hh_pas_3_branches_fused)->Apply(run_custom_arguments);
 BENCHMARK_MAIN();
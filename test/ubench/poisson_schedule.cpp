@@ -0,0 +1,77 @@
+// Compare Poisson schedules driven by a sequential random number engine
+// (poisson_schedule with std::mt19937_64) and by a counter-based generator
+// (counter_poisson_schedule), for a population of 10000 cells.
+//
+// The events of each schedule are drawn in intervals of 10 ms over 10 s of
+// simulated time, after a reset, as in a simulation that is run repeatedly.
+// The cost of the reset alone is measured separately.
+
+#include <random>
+#include <vector>
+
+#include <arbor/schedule.hpp>
+
+#include <benchmark/benchmark.h>
+
+using namespace arb;
+
+constexpr unsigned ncells = 10000;
+constexpr time_type t_end = 10000;
+constexpr time_type dt = 10;
+
+std::vector<schedule> make_schedules(bool counter, time_type rate_kHz) {
+    std::vector<schedule> schedules;
+    for (unsigned i = 0; i<ncells; ++i) {
+        schedules.push_back(counter?
+            counter_poisson_schedule(rate_kHz, i):
+            poisson_schedule(rate_kHz, std::mt19937_64(i)));
+    }
+    return schedules;
+}
+
+void run_generate(benchmark::State& state, bool counter) {
+    const time_type rate_kHz = state.range(0)*1e-3;
+    auto schedules = make_schedules(counter, rate_kHz);
+
+    while (state.KeepRunning()) {
+        std::size_t n = 0;
+        for (auto& s: schedules) {
+            s.reset();
+            for (time_type t = 0; t<t_end; t += dt) {
+                auto ev = s.events(t, t+dt);
+                n += ev.second-ev.first;
+            }
+        }
+        benchmark::DoNotOptimize(n);
+    }
+}
+
+void run_reset(benchmark::State& state, bool counter) {
+    auto schedules = make_schedules(counter, 0.01);
+
+    while (state.KeepRunning()) {
+        for (auto& s: schedules) {
+            s.reset();
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+void generate_std_engine(benchmark::State& state) { run_generate(state, false); }
+void generate_counter(benchmark::State& state) { run_generate(state, true); }
+void reset_std_engine(benchmark::State& state) { run_reset(state, false); }
+void reset_counter(benchmark::State& state) { run_reset(state, true); }
+
+// Rates in Hz.
+void rate_arguments(benchmark::internal::Benchmark* b) {
+    for (auto rate: {10, 100, 1000}) {
+        b->Args({rate});
+    }
+}
+
+BENCHMARK(generate_std_engine)->Apply(rate_arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(generate_counter)->Apply(rate_arguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(reset_std_engine)->Unit(benchmark::kMillisecond);
+BENCHMARK(reset_counter)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,90 @@
+// Measure the cost of many current clamps which are idle on almost every
+// step, as in protocol-driven runs: each cell receives a train of short
+// pulses, each described by its own clamp.
+//
+//   pulses:      pulses of constant amplitude;
+//   sine_pulses: pulses with a sinusoidal waveform.
+//
+// Each of 100 cells is a soma and a dendrite of ten CVs with pas, integrated
+// with dt 0.025 ms for 100 ms. The argument is the number of clamps per cell,
+// with pulses of 0.05 ms spread evenly over the run.
+
+#include <vector>
+
+#include <arbor/mc_cell.hpp>
+#include <arbor/recipe.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include "epoch.hpp"
+#include "fvm_lowered_cell.hpp"
+#include "mc_cell_group.hpp"
+#include "util/span.hpp"
+
+using namespace arb;
+
+constexpr cell_size_type n_cells = 100;
+constexpr time_type dt = 0.025;
+constexpr time_type t_end = 100;
+constexpr time_type pulse_duration = 0.05;
+
+class pulse_recipe: public recipe {
+public:
+    pulse_recipe(unsigned n_clamps, double frequency):
+        n_clamps_(n_clamps), frequency_(frequency) {}
+
+    cell_size_type num_cells() const override { return n_cells; }
+    cell_kind get_cell_kind(cell_gid_type) const override { return cell_kind::cable1d_neuron; }
+
+    util::unique_any get_cell_description(cell_gid_type gid) const override {
+        mc_cell c;
+        c.add_soma(6)->add_mechanism("pas");
+        auto dend = c.add_cable(0, section_kind::dendrite, 0.5, 0.5, 200);
+        dend->add_mechanism("pas");
+        dend->set_compartments(10);
+
+        for (auto i: util::make_span(n_clamps_)) {
+            double delay = (i+0.01*gid)*t_end/n_clamps_;
+            c.add_stimulus({1, (i%10+1)/10.}, {delay, pulse_duration, 0.1, frequency_});
+        }
+        return c;
+    }
+
+private:
+    unsigned n_clamps_;
+    double frequency_;
+};
+
+void run_pulses(benchmark::State& state, double frequency) {
+    const unsigned n_clamps = state.range(0);
+    execution_context context;
+    pulse_recipe rec(n_clamps, frequency);
+
+    std::vector<cell_gid_type> gids;
+    for (auto i: util::make_span(n_cells)) {
+        gids.push_back(i);
+    }
+    mc_cell_group group(gids, rec, make_fvm_lowered_cell(backend_kind::multicore, context));
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        group.reset();
+        state.ResumeTiming();
+
+        group.advance(epoch(0, t_end), dt, {});
+        benchmark::ClobberMemory();
+    }
+}
+
+void pulses(benchmark::State& state) {
+    run_pulses(state, 0);
+}
+
+void sine_pulses(benchmark::State& state) {
+    run_pulses(state, 1);
+}
+
+BENCHMARK(pulses)->Arg(0)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+BENCHMARK(sine_pulses)->Arg(0)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -1,10 +1,23 @@
-// Test performance of vectorization for mechanism implementations.
+// Test overheads of the threading task system.
 //
-// Start with pas (passive dendrite) mechanism
+// task_test:  tasks that sleep for a fixed time; measures scheduling
+//             efficiency for coarse tasks.
+// task_empty: tasks with trivial bodies; measures per-task overhead of
+//             task creation, submission and stealing.
+//
+// Per-task overhead of task_empty with 100000 tasks, before and after
+// replacing the mutex/condition variable queues with work-stealing deques
+// (see README.md for platform details):
+//
+//     threads | notification_queue | work-stealing
+//     --------|--------------------|--------------
+//        1    |     327 ns         |    185 ns
+//        4    |    2029 ns         |    239 ns
 
 #include <chrono>
 #include <iostream>
 #include <thread>
+#include <vector>
 
 #include <arbor/version.hpp>
 
@@ -33,11 +46,31 @@ void task_test(benchmark::State& state) {
     }
 }
 
+void task_empty(benchmark::State& state) {
+    const unsigned num_tasks = state.range(0);
+    arb::threading::task_system ts;
+    std::vector<unsigned> v(num_tasks);
+
+    while (state.KeepRunning()) {
+        arb::threading::parallel_for::apply(
+                0, num_tasks, &ts,
+                [&](unsigned i){v[i] += i;});
+        benchmark::ClobberMemory();
+    }
+}
+
 void us_per_task(benchmark::internal::Benchmark *b) {
     for (auto ncomps: {100, 250, 500, 1000, 10000}) {
         b->Args({ncomps});
     }
 }
 
+void num_tasks(benchmark::internal::Benchmark *b) {
+    for (auto n: {1000, 10000, 100000}) {
+        b->Args({n});
+    }
+}
+
 BENCHMARK(task_test)->Apply(us_per_task);
+BENCHMARK(task_empty)->Apply(num_tasks);
 BENCHMARK_MAIN();
@@ -0,0 +1,128 @@
+// Compare the cost of testing spike detectors each step, when no detector
+// crosses its threshold, as is the case on almost every step:
+//
+//   scalar:     the detector state machine, with a loop over the detectors
+//               that reads the value of each through its CV index;
+//   vectorized: multicore::threshold_watcher, which gathers the values in
+//               SIMD blocks, and only visits the detectors of blocks with a
+//               crossing.
+//
+// Each cell has ten CVs, with a detector on its first CV.
+
+#include <random>
+#include <vector>
+
+#include <arbor/execution_context.hpp>
+#include <arbor/fvm_types.hpp>
+#include <arbor/math.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include "backends/multicore/threshold_watcher.hpp"
+#include "backends/threshold_crossing.hpp"
+
+using namespace arb;
+
+constexpr unsigned cv_per_cell = 10;
+constexpr unsigned n_steps = 1000;
+
+struct watch_state {
+    std::vector<fvm_index_type> cv_to_cell;
+    std::vector<fvm_value_type> t_before;
+    std::vector<fvm_value_type> t_after;
+    std::vector<fvm_value_type> values;
+    std::vector<fvm_index_type> cv_index;
+    std::vector<fvm_value_type> thresholds;
+
+    explicit watch_state(unsigned ncell) {
+        std::minstd_rand gen;
+        std::uniform_real_distribution<fvm_value_type> v_dist(-70., -60.);
+
+        for (unsigned i = 0; i<ncell; ++i) {
+            for (unsigned j = 0; j<cv_per_cell; ++j) {
+                cv_to_cell.push_back(i);
+                values.push_back(v_dist(gen));
+            }
+            cv_index.push_back(i*cv_per_cell);
+            thresholds.push_back(-10);
+        }
+        t_before.assign(ncell, 0);
+        t_after.assign(ncell, 0.025);
+    }
+};
+
+class scalar_watcher {
+public:
+    scalar_watcher(const watch_state& s):
+        s_(s), n_(s.cv_index.size()), is_crossed_(n_), v_prev_(n_)
+    {
+        for (unsigned i = 0; i<n_; ++i) {
+            v_prev_[i] = s.values[s.cv_index[i]];
+            is_crossed_[i] = v_prev_[i]>=s.thresholds[i];
+        }
+    }
+
+    void test() {
+        for (fvm_size_type i = 0; i<n_; ++i) {
+            auto cv     = s_.cv_index[i];
+            auto cell   = s_.cv_to_cell[cv];
+            auto v_prev = v_prev_[i];
+            auto v      = s_.values[cv];
+            auto thresh = s_.thresholds[i];
+
+            if (!is_crossed_[i]) {
+                if (v>=thresh) {
+                    auto pos = (thresh - v_prev)/(v - v_prev);
+                    auto crossing_time = math::lerp(s_.t_before[cell], s_.t_after[cell], pos);
+                    crossings_.push_back({i, crossing_time});
+                    is_crossed_[i] = true;
+                }
+            }
+            else {
+                if (v<thresh) {
+                    is_crossed_[i] = false;
+                }
+            }
+            v_prev_[i] = v;
+        }
+    }
+
+    void clear_crossings() { crossings_.clear(); }
+
+private:
+    const watch_state& s_;
+    fvm_size_type n_;
+    std::vector<fvm_size_type> is_crossed_;
+    std::vector<fvm_value_type> v_prev_;
+    std::vector<threshold_crossing> crossings_;
+};
+
+template <typename Watcher>
+void run_watcher(benchmark::State& state, Watcher& watcher) {
+    while (state.KeepRunning()) {
+        for (unsigned i = 0; i<n_steps; ++i) {
+            watcher.test();
+        }
+        watcher.clear_crossings();
+        benchmark::ClobberMemory();
+    }
+}
+
+void scalar(benchmark::State& state) {
+    watch_state s(state.range(0));
+    scalar_watcher watcher(s);
+    run_watcher(state, watcher);
+}
+
+void vectorized(benchmark::State& state) {
+    execution_context context;
+    watch_state s(state.range(0));
+    multicore::threshold_watcher watcher(s.cv_to_cell.data(), s.t_before.data(), s.t_after.data(),
+        s.values.data(), s.cv_index, s.thresholds, context);
+    run_watcher(state, watcher);
+}
+
+BENCHMARK(scalar)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(vectorized)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
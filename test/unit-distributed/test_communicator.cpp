@@ -1,6 +1,7 @@
 #include "../gtest.h"
 #include "test.hpp"
 
+#include <random>
 #include <stdexcept>
 #include <vector>
 
@@ -10,6 +11,7 @@
 #include <threading/threading.hpp>
 
 #include "communication/communicator.hpp"
+#include "event_lanes.hpp"
 #include "util/filter.hpp"
 #include "util/rangeutil.hpp"
 #include "util/span.hpp"
@@ -321,7 +323,7 @@ test_ring(const domain_decomposition& D, communicator& C, F&& f) {
     }
 
     // generate the events
-    std::vector<arb::pse_vector> queues(C.num_local_cells());
+    arb::event_lane_store queues(C.num_local_cells());
     C.make_event_queues(global_spikes, queues);
 
     // Assert that all the correct events were generated.
@@ -334,7 +336,7 @@ test_ring(const domain_decomposition& D, communicator& C, F&& f) {
         if (f(src)) {
             auto expected = expected_event_ring(gid, D.num_global_cells);
             auto grp = group_map[gid];
-            auto& q = queues[grp];
+            auto q = queues[grp];
             if (std::find(q.begin(), q.end(), expected)==q.end()) {
                 return ::testing::AssertionFailure()
                     << "expected event " << expected << " was not found";
@@ -346,8 +348,7 @@ test_ring(const domain_decomposition& D, communicator& C, F&& f) {
     // Assert that only the expected events were produced. The preceding test
     // showed that all expected events were generated, so this only requires
     // that the number of generated events is as expected.
-    int num_events = std::accumulate(queues.begin(), queues.end(), 0,
-            [](int l, decltype(queues.front())& r){return l + r.size();});
+    int num_events = queues.num_events();
 
     if (expected_count!=num_events) {
         return ::testing::AssertionFailure() <<
@@ -412,7 +413,7 @@ test_all2all(const domain_decomposition& D, communicator& C, F&& f) {
     }
 
     // generate the events
-    std::vector<arb::pse_vector> queues(C.num_local_cells());
+    arb::event_lane_store queues(C.num_local_cells());
     C.make_event_queues(global_spikes, queues);
     if (queues.size() != D.groups.size()) { // one queue for each cell group
         return ::testing::AssertionFailure()
@@ -426,7 +427,7 @@ test_all2all(const domain_decomposition& D, communicator& C, F&& f) {
     int expected_count = 0;
     for (auto gid: gids) {
         // get the event queue that this gid belongs to
-        auto& q = queues[group_map[gid]];
+        auto q = queues[group_map[gid]];
         for (auto src: spike_gids) {
             auto expected = expected_event_all2all(gid, src);
             if (std::find(q.begin(), q.end(), expected)==q.end()) {
@@ -441,8 +442,7 @@ test_all2all(const domain_decomposition& D, communicator& C, F&& f) {
     // Assert that only the expected events were produced. The preceding test
     // showed that all expected events were generated, so this only requires
     // that the number of generated events is as expected.
-    int num_events = std::accumulate(queues.begin(), queues.end(), 0,
-            [](int l, decltype(queues.front())& r){return l + r.size();});
+    int num_events = queues.num_events();
 
     if (expected_count!=num_events) {
         return ::testing::AssertionFailure() <<
@@ -478,3 +478,97 @@ TEST(communicator, all2all)
     // odd-numbered cells fire
     EXPECT_TRUE(test_all2all(D, C, [](cell_gid_type g){return g%2==1;}));
 }
+
+namespace {
+    // Population of spike sources, where each cell receives connections
+    // from random sources, from either of two detectors on the source.
+    // Only every stride-th cell is a source.
+    class random_recipe: public recipe {
+    public:
+        random_recipe(cell_size_type s, cell_size_type stride, cell_size_type fan_in):
+            size_(s), stride_(stride), fan_in_(fan_in)
+        {}
+
+        cell_size_type num_cells() const override {
+            return size_;
+        }
+
+        util::unique_any get_cell_description(cell_gid_type) const override {
+            return {};
+        }
+
+        cell_kind get_cell_kind(cell_gid_type gid) const override {
+            return cell_kind::spike_source;
+        }
+
+        cell_size_type num_sources(cell_gid_type) const override { return 2; }
+        cell_size_type num_targets(cell_gid_type) const override { return fan_in_; }
+        cell_size_type num_probes(cell_gid_type) const override { return 0; }
+
+        std::vector<cell_connection> connections_on(cell_gid_type gid) const override {
+            std::minstd_rand R(gid);
+            std::uniform_int_distribution<cell_gid_type> source(0, (size_-1)/stride_);
+
+            std::vector<cell_connection> cons;
+            for (auto i: util::make_span(0, fan_in_)) {
+                cell_member_type src = {source(R)*stride_, cell_lid_type(R()%2)};
+                cell_member_type dst = {gid, i};
+                cons.push_back(cell_connection(src, dst, float(i), 1.0f+i%3));
+            }
+            return cons;
+        }
+
+    private:
+        cell_size_type size_;
+        cell_size_type stride_;
+        cell_size_type fan_in_;
+    };
+}
+
+// Compare events generated with the connection lookup against those found
+// by searching all connections, for both the dense and hashed source index,
+// and with enough spikes to divide work between threads.
+TEST(communicator, event_queues_lookup)
+{
+    execution_context ctx;
+    ctx.distributed = g_context.distributed;
+    ctx.thread_pool = arb::make_thread_pool(4);
+
+    const unsigned N = g_context.distributed->size();
+
+    for (cell_size_type stride: {1u, 16u}) {
+        auto R = random_recipe(3000*N, stride, 20);
+        const auto D = partition_load_balance(R, local_allocation(ctx), ctx);
+        auto C = communicator(R, D, ctx);
+
+        // Spikes from each detector on every fourth source cell, except
+        // for some gids that are not sources when stride>1.
+        std::vector<spike> local_spikes;
+        for (auto gid: get_gids(D)) {
+            if (gid%4==0) {
+                local_spikes.push_back(spike({gid, 0u}, time_type(gid%7)));
+                local_spikes.push_back(spike({gid, 1u}, time_type(gid%5)));
+            }
+        }
+        auto global_spikes = C.exchange(local_spikes);
+
+        event_lane_store queues(C.num_local_cells());
+        C.make_event_queues(global_spikes, queues);
+
+        // Events are expected in order of spikes, then of connections.
+        std::vector<pse_vector> expected(C.num_local_cells());
+        for (auto& spk: global_spikes.values()) {
+            for (auto c: C.connections()) {
+                if (c.source()==spk.source) {
+                    expected[c.index_on_domain()].push_back(c.make_event(spk));
+                }
+            }
+        }
+
+        ASSERT_EQ(expected.size(), queues.size());
+        for (auto i: util::make_span(queues.size())) {
+            auto q = queues[i];
+            EXPECT_EQ(expected[i], pse_vector(q.begin(), q.end()));
+        }
+    }
+}
@@ -8,7 +8,11 @@
 #include "printer/cexpr_emit.hpp"
 #include "printer/cprinter.hpp"
 #include "printer/cudaprinter.hpp"
+#include "printer/printerutil.hpp"
 #include "expression.hpp"
+#include "io/bulkio.hpp"
+#include "module.hpp"
+#include "parser.hpp"
 #include "symdiff.hpp"
 
 // Note: CUDA printer disabled until new implementation finished.
@@ -158,3 +162,75 @@ TEST(CPrinter, proc_body) {
         EXPECT_EQ(strip(tc.expected), strip(text));
     }
 }
+
+// Parse and analyse one of the arbor built-in mechanisms.
+static Module builtin_module(const char* name) {
+    std::string path = DATADIR "/../../mechanisms/mod/"+std::string(name)+".mod";
+    Module m(io::read_all(path), path);
+    EXPECT_FALSE(m.empty());
+
+    Parser p(m, false);
+    EXPECT_TRUE(p.parse());
+    m.semantic();
+    EXPECT_FALSE(m.has_error());
+
+    return m;
+}
+
+TEST(printerutil, fusible_state_current) {
+    auto fusible = [](const char* name) {
+        return fusible_state_current(builtin_module(name));
+    };
+
+    // Density mechanisms whose state depends only on the voltage.
+    EXPECT_TRUE(fusible("hh"));
+    EXPECT_TRUE(fusible("pas"));
+    EXPECT_TRUE(fusible("test_kinlva"));
+
+    // Point mechanism.
+    EXPECT_FALSE(fusible("expsyn"));
+
+    // Reads the calcium current in its state update, and writes the
+    // calcium concentration.
+    EXPECT_FALSE(fusible("test_ca"));
+}
+
+TEST(CPrinter, fused_shared_reads) {
+    // The fused state and current kernel reads the voltage, which is used
+    // by both methods, once per instance.
+    auto fused_body = [](const std::string& text) {
+        auto b = text.find("::nrn_state_current() {");
+        auto e = text.find("\n}\n", b);
+        return text.substr(b, e-b);
+    };
+
+    auto count = [](const std::string& text, const std::string& what) {
+        unsigned n = 0;
+        for (auto i = text.find(what); i!=std::string::npos; i = text.find(what, i+1)) ++n;
+        return n;
+    };
+
+    std::string body = fused_body(emit_cpp_source(builtin_module("hh"), printer_options{}));
+    EXPECT_EQ(1u, count(body, "vec_v_["));
+    EXPECT_EQ(2u, count(body, "value_type v = vec_v_i_;"));
+
+    // The SIMD kernel has a loop for each of the four index constraints.
+    printer_options opt;
+    opt.simd = simd_spec(simd_spec::avx2);
+
+    body = fused_body(emit_cpp_source(builtin_module("hh"), opt));
+    EXPECT_EQ(4u, count(body, "simd_value vec_v_i_"));
+    EXPECT_EQ(8u, count(body, "simd_value v(vec_v_i_);"));
+}
+
+TEST(SimdPrinter, api_procedure_call) {
+    // Procedures called from the loops over the SIMD chunks of each index
+    // constraint class must be passed the offset of the chunk, index_,
+    // rather than the loop counter.
+    printer_options opt;
+    opt.simd = simd_spec(simd_spec::avx2);
+
+    std::string text = emit_cpp_source(builtin_module("hh"), opt);
+    EXPECT_NE(std::string::npos, text.find("rates(index_, v, celsius);"));
+    EXPECT_EQ(std::string::npos, text.find("rates(i_, v, celsius);"));
+}
@@ -18,13 +18,15 @@ using field_table_type = std::vector<std::pair<const char*, fvm_value_type**>>;
 
 // Multicore mechanisms:
 
-ACCESS_BIND(field_table_type (multicore::mechanism::*)(), multicore_field_table_ptr, &multicore::mechanism::field_table)
+using multicore_field_table_type = std::vector<std::pair<const char*, fvm_state_type**>>;
+
+ACCESS_BIND(multicore_field_table_type (multicore::mechanism::*)(), multicore_field_table_ptr, &multicore::mechanism::field_table)
 
 std::vector<fvm_value_type> mechanism_field(multicore::mechanism* m, const std::string& key) {
     auto opt_ptr = util::value_by_key((m->*multicore_field_table_ptr)(), key);
     if (!opt_ptr) throw std::logic_error("internal error: no such field in mechanism");
 
-    const fvm_value_type* field_data = *opt_ptr.value();
+    const fvm_state_type* field_data = *opt_ptr.value();
     return std::vector<fvm_value_type>(field_data, field_data+m->size());
 }
 
@@ -0,0 +1,207 @@
+#pragma once
+
+// Distributed context that simulates a number of ranks in one process.
+//
+// Each simulated rank is run on its own thread with a mock_context that
+// refers to a shared mock_world; collective operations block until all
+// ranks have contributed. As with the MPI context, spikes are exchanged in
+// the packed encoding of spike_codec. Spike exchanges started with
+// start_gather_spikes or start_exchange_spikes are deferred until they are
+// completed.
+//
+//     auto world = std::make_shared<mock_world>(4);
+//     mock_world::run(world, [](arb::distributed_context_handle ctx) { ... });
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <arbor/common_types.hpp>
+#include <arbor/distributed_context.hpp>
+#include <arbor/execution_context.hpp>
+#include <arbor/spike.hpp>
+
+#include "communication/spike_codec.hpp"
+
+class mock_world {
+public:
+    explicit mock_world(int size): size_(size), slots_(size) {}
+
+    int size() const { return size_; }
+
+    // Collective: returns the values contributed by each rank, in rank order.
+    template <typename T>
+    std::vector<T> all_gather(int rank, const T& value) {
+        slots_[rank] = &value;
+        barrier();
+
+        std::vector<T> result;
+        result.reserve(size_);
+        for (auto p: slots_) {
+            result.push_back(*static_cast<const T*>(p));
+        }
+        barrier();
+        return result;
+    }
+
+    void barrier() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto generation = generation_;
+        if (++arrived_==size_) {
+            arrived_ = 0;
+            ++generation_;
+            cv_.notify_all();
+        }
+        else {
+            cv_.wait(lock, [&] { return generation_!=generation; });
+        }
+    }
+
+    // Run f on one thread per rank, with a distributed_context for that rank.
+    static void run(std::shared_ptr<mock_world> world, std::function<void (arb::distributed_context_handle)> f);
+
+private:
+    int size_;
+    std::vector<const void*> slots_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int arrived_ = 0;
+    unsigned generation_ = 0;
+};
+
+struct mock_context {
+    std::shared_ptr<mock_world> world;
+    int rank;
+
+    arb::gathered_vector<arb::spike>
+    gather_spikes(const std::vector<arb::spike>& local_spikes) const {
+        return arb::spike_codec::decode(gather_all(arb::spike_codec::encode(local_spikes)));
+    }
+
+    arb::gathered_vector<arb::spike>
+    exchange_spikes(const std::vector<arb::spike>& local_spikes, const std::vector<unsigned>& send_partition) const {
+        std::vector<unsigned> byte_partition;
+        auto bytes = arb::spike_codec::encode(local_spikes, send_partition, byte_partition);
+        return arb::spike_codec::decode(exchange(bytes, byte_partition));
+    }
+
+    arb::gathered_vector<arb::cell_gid_type>
+    exchange_gids(const std::vector<arb::cell_gid_type>& local_gids, const std::vector<unsigned>& send_partition) const {
+        return exchange(local_gids, send_partition);
+    }
+
+    arb::spike_exchange_handle
+    start_gather_spikes(const std::vector<arb::spike>& local_spikes) const {
+        auto ctx = *this;
+        return deferred([ctx, local_spikes]() { return ctx.gather_spikes(local_spikes); });
+    }
+
+    arb::spike_exchange_handle
+    start_exchange_spikes(const std::vector<arb::spike>& local_spikes, const std::vector<unsigned>& send_partition) const {
+        auto ctx = *this;
+        return deferred([ctx, local_spikes, send_partition]() { return ctx.exchange_spikes(local_spikes, send_partition); });
+    }
+
+    int id() const { return rank; }
+
+    int size() const { return world->size(); }
+
+    template <typename T>
+    T min(T value) const {
+        auto all = world->all_gather(rank, value);
+        return *std::min_element(all.begin(), all.end());
+    }
+
+    template <typename T>
+    T max(T value) const {
+        auto all = world->all_gather(rank, value);
+        return *std::max_element(all.begin(), all.end());
+    }
+
+    template <typename T>
+    T sum(T value) const {
+        auto all = world->all_gather(rank, value);
+        return std::accumulate(all.begin(), all.end(), T{});
+    }
+
+    template <typename T>
+    std::vector<T> gather(T value, int root) const {
+        auto all = world->all_gather(rank, value);
+        return rank==root? all: std::vector<T>{};
+    }
+
+    void barrier() const { world->barrier(); }
+
+    std::string name() const { return "mock"; }
+
+private:
+    using spike_collective = std::function<arb::gathered_vector<arb::spike> ()>;
+
+    // Performs the collective when completed.
+    struct deferred_request: arb::spike_exchange_handle::request {
+        explicit deferred_request(spike_collective f): f(std::move(f)) {}
+
+        arb::gathered_vector<arb::spike> complete() override { return f(); }
+
+        spike_collective f;
+    };
+
+    static arb::spike_exchange_handle deferred(spike_collective f) {
+        return arb::spike_exchange_handle(
+            std::unique_ptr<arb::spike_exchange_handle::request>(new deferred_request(std::move(f))));
+    }
+
+    template <typename T>
+    arb::gathered_vector<T> gather_all(const std::vector<T>& values) const {
+        using count_type = typename arb::gathered_vector<T>::count_type;
+
+        auto all = world->all_gather(rank, &values);
+        std::vector<T> result;
+        std::vector<count_type> partition = {0u};
+        for (auto v: all) {
+            result.insert(result.end(), v->begin(), v->end());
+            partition.push_back(result.size());
+        }
+        world->barrier();
+        return arb::gathered_vector<T>(std::move(result), std::move(partition));
+    }
+
+    template <typename T>
+    arb::gathered_vector<T> exchange(const std::vector<T>& values, const std::vector<unsigned>& send_partition) const {
+        using count_type = typename arb::gathered_vector<T>::count_type;
+        using contribution = std::pair<const std::vector<T>*, const std::vector<unsigned>*>;
+
+        auto all = world->all_gather(rank, contribution(&values, &send_partition));
+        std::vector<T> result;
+        std::vector<count_type> partition = {0u};
+        for (auto c: all) {
+            const auto& v = *c.first;
+            const auto& p = *c.second;
+            result.insert(result.end(), v.begin()+p[rank], v.begin()+p[rank+1]);
+            partition.push_back(result.size());
+        }
+        // Other ranks may still be reading from values.
+        world->barrier();
+        return arb::gathered_vector<T>(std::move(result), std::move(partition));
+    }
+};
+
+inline void mock_world::run(std::shared_ptr<mock_world> world, std::function<void (arb::distributed_context_handle)> f) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i<world->size(); ++i) {
+        threads.emplace_back([=]() {
+            f(std::make_shared<arb::distributed_context>(mock_context{world, i}));
+        });
+    }
+    for (auto& t: threads) {
+        t.join();
+    }
+}
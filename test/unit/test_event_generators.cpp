@@ -124,3 +124,78 @@ TEST(event_generators, poisson) {
     EXPECT_EQ(int1, int2);
 }
 
+
+// Streaming the events of an interval in blocks gives the same events as
+// drawing them in one call.
+TEST(event_generators, stream) {
+    cell_member_type target{4, 2};
+    float weight = 42;
+
+    auto stream = [](event_generator& gen, time_type t0, time_type t1) {
+        pse_vector events;
+        for (auto s = gen.stream(t0, t1); s.first!=s.second; s = gen.stream(t0, t1)) {
+            EXPECT_LE(std::size_t(s.second-s.first), schedule_stream_block_size);
+            util::append(events, as_vector(s));
+        }
+        return events;
+    };
+
+    std::vector<event_generator> generators = {
+        regular_generator(target, weight, 0.5, 0.01),
+        poisson_generator(target, weight, 0.2, 50, std::mt19937_64{}),
+        counter_poisson_generator(target, weight, 0.2, 50, 1234),
+        explicit_generator(pse_vector{{target, 0.3, 1.f}, {target, 2.5, 2.f}, {target, 2.7, 3.f}}),
+    };
+
+    for (auto& g: generators) {
+        const event_generator& orig = g;
+        event_generator ref = orig;
+        for (time_type t: {0., 1., 2., 3., 6.}) {
+            EXPECT_EQ(as_vector(ref.events(t, t+1)), stream(g, t, t+1));
+        }
+
+        // Reset and stream again.
+        g.reset();
+        ref.reset();
+        EXPECT_EQ(as_vector(ref.events(0, 4)), stream(g, 0, 4));
+    }
+}
+
+// Counting the events of an interval gives the number that streaming the
+// interval provides.
+TEST(event_generators, count) {
+    cell_member_type target{4, 2};
+    float weight = 42;
+
+    std::vector<event_generator> countable = {
+        regular_generator(target, weight, 0.5, 0.01),
+        regular_generator(target, weight, 0.3, 0.1, 4.25),
+        counter_poisson_generator(target, weight, 0.2, 50, 1234),
+        counter_poisson_generator(target, weight, 0, 0.3, 99),
+    };
+
+    for (auto& g: countable) {
+        ASSERT_TRUE(g.countable());
+        for (time_type t: {0., 0.35, 0.7, 1., 2., 3.3, 6.}) {
+            time_type t1 = t+0.35;
+            auto n = g.count(t, t1);
+            std::size_t n_streamed = 0;
+            for (auto s = g.stream(t, t1); s.first!=s.second; s = g.stream(t, t1)) {
+                n_streamed += s.second-s.first;
+            }
+            EXPECT_EQ(n_streamed, n);
+        }
+
+        // Nothing remains to be streamed from the last interval.
+        EXPECT_EQ(0u, g.count(6., 6.35));
+    }
+
+    std::vector<event_generator> uncountable = {
+        poisson_generator(target, weight, 0.2, 50, std::mt19937_64{}),
+        explicit_generator(pse_vector{{target, 0.3, 1.f}}),
+    };
+
+    for (auto& g: uncountable) {
+        EXPECT_FALSE(g.countable());
+    }
+}
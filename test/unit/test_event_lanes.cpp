@@ -0,0 +1,90 @@
+#include "../gtest.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <arbor/spike_event.hpp>
+
+#include "event_lanes.hpp"
+#include "event_queue.hpp"
+#include "util/span.hpp"
+
+using namespace arb;
+
+namespace {
+    pse_vector lane_events(event_span lane) {
+        return pse_vector(lane.begin(), lane.end());
+    }
+}
+
+TEST(event_lanes, empty)
+{
+    event_lane_store store(3);
+
+    EXPECT_EQ(3u, store.size());
+    EXPECT_EQ(0u, store.num_events());
+    for (auto i: util::make_span(3)) {
+        EXPECT_TRUE(store[i].empty());
+    }
+
+    event_lane_subrange none;
+    EXPECT_EQ(0u, none.size());
+    EXPECT_TRUE(none.empty());
+}
+
+TEST(event_lanes, fill)
+{
+    std::vector<pse_vector> lanes = {
+        {{{0, 0}, 1, 1}, {{0, 1}, 2, 1}},
+        {},
+        {{{2, 0}, 0.5, 2}},
+        {{{3, 0}, 1, 3}, {{3, 0}, 3, 3}, {{3, 1}, 4, 3}},
+    };
+    const auto n = lanes.size();
+
+    event_lane_store store(n);
+    for (auto i: util::make_span(n)) {
+        store.add_count(i, lanes[i].size());
+    }
+    store.allocate();
+    EXPECT_EQ(6u, store.num_events());
+
+    for (auto i: util::make_span(n)) {
+        auto lane = store.lane(i);
+        ASSERT_EQ(lanes[i].size(), lane.size());
+        std::copy(lanes[i].begin(), lanes[i].end(), lane.begin());
+    }
+
+    for (auto i: util::make_span(n)) {
+        EXPECT_EQ(lanes[i], lane_events(store[i]));
+    }
+
+    // The lanes are contiguous in the buffer.
+    EXPECT_EQ(0u, store.offset(0));
+    EXPECT_EQ(2u, store.offset(2));
+    EXPECT_EQ(6u, store.offset(n));
+    EXPECT_EQ(store.data()+3, store[3].begin());
+
+    auto sub = store.subrange(1, 4);
+    ASSERT_EQ(3u, sub.size());
+    for (auto i: util::make_span(3)) {
+        EXPECT_EQ(lanes[i+1], lane_events(sub[i]));
+    }
+
+    // Clearing the store empties every lane, and the store can be filled
+    // again without reallocating the buffer.
+    auto data = store.data();
+    store.clear();
+    EXPECT_EQ(0u, store.num_events());
+    for (auto i: util::make_span(n)) {
+        EXPECT_TRUE(store[i].empty());
+    }
+
+    store.add_count(3, 2);
+    store.allocate();
+    EXPECT_EQ(data, store.data());
+    EXPECT_EQ(2u, store.num_events());
+    EXPECT_TRUE(store[0].empty());
+    EXPECT_TRUE(store[2].empty());
+    EXPECT_EQ(2u, store[3].size());
+}
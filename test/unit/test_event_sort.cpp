@@ -0,0 +1,102 @@
+#include "../gtest.h"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <arbor/execution_context.hpp>
+#include <arbor/spike_event.hpp>
+
+#include "event_sort.hpp"
+#include "util/rangeutil.hpp"
+
+using namespace arb;
+
+namespace {
+    // Events with times drawn uniformly from [t0, t0+width), with ties in
+    // time broken by target and weight.
+    pse_vector random_events(std::size_t n, time_type t0, time_type width, unsigned seed) {
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution<time_type> time_dist(t0, t0+width);
+        std::uniform_int_distribution<cell_lid_type> target_dist(0, 3);
+
+        pse_vector events;
+        for (std::size_t i = 0; i<n; ++i) {
+            events.push_back({{0, target_dist(gen)}, time_dist(gen), float(i%3)});
+        }
+        // Add some events with identical times.
+        for (std::size_t i = 0; i<n/8; ++i) {
+            auto e = events[i];
+            e.weight = -e.weight;
+            events.push_back(e);
+        }
+        return events;
+    }
+
+    void check_sort(pse_vector events, event_sort_buffer& buffer) {
+        auto expected = events;
+        std::sort(expected.begin(), expected.end());
+
+        bucket_sort_events(util::range_pointer_view(events), buffer);
+        EXPECT_EQ(expected, events);
+    }
+}
+
+TEST(event_sort, bucket_sort)
+{
+    event_sort_buffer buffer;
+
+    check_sort({}, buffer);
+    check_sort({{{0, 0}, 1.f, 0.f}}, buffer);
+
+    for (unsigned seed: {1u, 2u, 3u}) {
+        for (std::size_t n: {2u, 10u, 100u, 1000u}) {
+            check_sort(random_events(n, 10.f, 2.5f, seed), buffer);
+        }
+    }
+}
+
+TEST(event_sort, skewed)
+{
+    event_sort_buffer buffer;
+
+    // All events at the same time.
+    pse_vector same;
+    for (unsigned i = 0; i<200; ++i) {
+        same.push_back({{0, 199-i}, 5.f, 1.f});
+    }
+    check_sort(same, buffer);
+
+    // Most events in one bucket, with an outlier far away.
+    auto clustered = random_events(500, 1.f, 1e-4f, 4);
+    clustered.push_back({{0, 0}, 1e6f, 1.f});
+    check_sort(clustered, buffer);
+
+    // Negative and very large times.
+    auto wide = random_events(300, -1e30f, 1e30f, 5);
+    wide.push_back({{0, 0}, std::numeric_limits<time_type>::max(), 1.f});
+    wide.push_back({{0, 0}, std::numeric_limits<time_type>::lowest(), 1.f});
+    check_sort(wide, buffer);
+
+    // Already sorted.
+    auto sorted = random_events(300, 0.f, 10.f, 6);
+    std::sort(sorted.begin(), sorted.end());
+    check_sort(sorted, buffer);
+}
+
+TEST(event_sort, sorter)
+{
+    execution_context ctx;
+    event_sorter sorter(ctx.thread_pool);
+
+    const std::size_t m = event_sorter::bucket_sort_min_events;
+    for (std::size_t n: {std::size_t(10), m, std::size_t(400)}) {
+        auto events = random_events(n, 0.f, 1.f, n);
+        auto expected = events;
+        std::sort(expected.begin(), expected.end());
+
+        sorter.sort(util::range_pointer_view(events));
+        EXPECT_EQ(expected, events);
+    }
+}
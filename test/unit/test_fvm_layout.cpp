@@ -331,6 +331,115 @@ TEST(fvm_layout, mech_index) {
     EXPECT_EQ(ivec({0,5}), M.ions.at(ionKind::k).cv);
 }
 
+TEST(fvm_layout, density_cv_order) {
+    // Soma (CV 0) with dendrites d1 (CVs 1, 2) and d3 (CVs 5, 6) attached to
+    // the soma, and d2 (CVs 3, 4) attached to the end of d1:
+    //
+    //   s0-d1-d2
+    //     \.
+    //      d3
+    //
+    // With test_ca on d2 and d3 only, the parent CV of d3 (the soma CV)
+    // precedes the CVs of d2; mechanism and ion instances should nonetheless
+    // be ordered by CV.
+
+    std::vector<mc_cell> cells(1);
+    mc_cell& c = cells[0];
+
+    c.add_soma(5);
+    c.add_cable(0, section_kind::dendrite, 0.5, 0.5, 100);
+    c.add_cable(1, section_kind::dendrite, 0.5, 0.5, 100);
+    c.add_cable(0, section_kind::dendrite, 0.5, 0.5, 100);
+
+    for (auto i: {1, 2, 3}) {
+        c.segments()[i]->set_compartments(2);
+    }
+    c.segments()[2]->add_mechanism("test_ca");
+    c.segments()[3]->add_mechanism("test_ca");
+
+    fvm_discretization D = fvm_discretize(cells);
+    fvm_mechanism_data M = fvm_build_mechanism_data(global_default_catalogue(), cells, D);
+
+    using ivec = std::vector<fvm_index_type>;
+
+    auto& config = M.mechanisms.at("test_ca");
+    EXPECT_EQ(ivec({0, 2, 3, 4, 5, 6}), config.cv);
+    EXPECT_EQ(ivec({0, 2, 3, 4, 5, 6}), M.ions.at(ionKind::ca).cv);
+
+    // The soma and the end of d1 are only partially covered by the mechanism;
+    // the remaining CVs are wholly covered.
+
+    ASSERT_EQ(config.cv.size(), config.norm_area.size());
+    EXPECT_GT(config.norm_area[0], 0.);
+    EXPECT_LT(config.norm_area[0], 1.);
+    EXPECT_GT(config.norm_area[1], 0.);
+    EXPECT_LT(config.norm_area[1], 1.);
+    for (auto i: {2, 3, 4, 5}) {
+        EXPECT_DOUBLE_EQ(1., config.norm_area[i]);
+    }
+}
+
+TEST(fvm_layout, cv_ordering) {
+    // Soma with hh, and two dendritic subtrees: d1 and its child d3 with pas,
+    // d2 and its child d4 with hh. Each dendrite has two compartments.
+    //
+    //     d1-d3
+    //    /
+    //  s0
+    //    \.
+    //     d2-d4
+
+    std::vector<mc_cell> cells(1);
+    mc_cell& c = cells[0];
+
+    c.add_soma(5)->add_mechanism("hh");
+    c.add_cable(0, section_kind::dendrite, 0.5, 0.5, 100)->add_mechanism("pas");
+    c.add_cable(0, section_kind::dendrite, 0.4, 0.4, 200)->add_mechanism("hh");
+    c.add_cable(1, section_kind::dendrite, 0.3, 0.3, 150)->add_mechanism("pas");
+    c.add_cable(2, section_kind::dendrite, 0.2, 0.2, 120)->add_mechanism("hh");
+
+    for (auto i: make_span(1, 5)) {
+        c.segments()[i]->set_compartments(2);
+    }
+
+    using ivec = std::vector<fvm_index_type>;
+
+    fvm_discretization D = fvm_discretize(cells, cv_ordering::segment);
+    fvm_mechanism_data M = fvm_build_mechanism_data(global_default_catalogue(), cells, D);
+
+    EXPECT_EQ(ivec({0, 0, 1, 0, 3, 2, 5, 4, 7}), D.parent_cv);
+    EXPECT_EQ(ivec({0, 3, 4, 7, 8}), M.mechanisms.at("hh").cv);
+    EXPECT_EQ(ivec({0, 1, 2, 5, 6}), M.mechanisms.at("pas").cv);
+
+    // Depth-first, with d2 before d1 as it shares the mechanisms of the soma:
+    // segments are numbered in the order s0, d2, d4, d1, d3.
+
+    fvm_discretization D_df = fvm_discretize(cells, cv_ordering::depth_first);
+    fvm_mechanism_data M_df = fvm_build_mechanism_data(global_default_catalogue(), cells, D_df);
+
+    EXPECT_EQ(ivec({0, 0, 1, 2, 3, 0, 5, 6, 7}), D_df.parent_cv);
+    EXPECT_EQ(ivec({0, 1, 2, 3, 4}), M_df.mechanisms.at("hh").cv);
+    EXPECT_EQ(ivec({0, 5, 6, 7, 8}), M_df.mechanisms.at("pas").cv);
+    EXPECT_EQ(ivec({0, 1, 2, 3, 4}), M_df.ions.at(ionKind::na).cv);
+
+    // The CV properties are permuted with the CVs.
+
+    for (auto i: make_span(0, 5)) {
+        const auto& seg = D.segments[i];
+        const auto& seg_df = D_df.segments[i];
+        ASSERT_EQ(seg.distal_cv-seg.proximal_cv, seg_df.distal_cv-seg_df.proximal_cv);
+
+        for (auto k: make_span(0, seg.distal_cv-seg.proximal_cv+1)) {
+            auto cv = seg.proximal_cv+k;
+            auto cv_df = seg_df.proximal_cv+k;
+
+            EXPECT_EQ(D.cv_area[cv], D_df.cv_area[cv_df]);
+            EXPECT_EQ(D.cv_capacitance[cv], D_df.cv_capacitance[cv_df]);
+            EXPECT_EQ(D.face_conductance[cv], D_df.face_conductance[cv_df]);
+        }
+    }
+}
+
 TEST(fvm_layout, synapse_targets) {
     std::vector<mc_cell> cells = two_cell_system();
 
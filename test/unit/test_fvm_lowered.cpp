@@ -1,3 +1,5 @@
+#include <cmath>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -57,7 +59,7 @@ arb::mechanism* find_mechanism(fvm_cell& fvcell, const std::string& name) {
 // Access to mechanism-internal data:
 
 using mechanism_global_table = std::vector<std::pair<const char*, arb::fvm_value_type*>>;
-using mechanism_field_table = std::vector<std::pair<const char*, arb::fvm_value_type**>>;
+using mechanism_field_table = std::vector<std::pair<const char*, arb::fvm_state_type**>>;
 using mechanism_ion_index_table = std::vector<std::pair<arb::ionKind, backend::iarray*>>;
 
 ACCESS_BIND(\
@@ -228,19 +230,99 @@ TEST(fvm_lowered, stimulus) {
     memory::fill(T, 1.);
     stim->nrn_current();
     constexpr double unit_factor = 1e-3; // scale A/m²·µm² to nA
-    EXPECT_DOUBLE_EQ(-0.1, J[soma_cv]*A[soma_cv]*unit_factor);
+    // Stimulus amplitudes are stored with the precision of mechanism state.
+    const double amp_soma = fvm_state_type(0.1);
+    const double amp_tip = fvm_state_type(0.3);
+    EXPECT_DOUBLE_EQ(-amp_soma, J[soma_cv]*A[soma_cv]*unit_factor);
 
     // Test that 0.1 nA is again injected at t=1.5, for a total of 0.2 nA.
     memory::fill(T, 1.);
     stim->nrn_current();
-    EXPECT_DOUBLE_EQ(-0.2, J[soma_cv]*A[soma_cv]*unit_factor);
+    EXPECT_DOUBLE_EQ(-2*amp_soma, J[soma_cv]*A[soma_cv]*unit_factor);
 
     // Test that at t=10, no more current is injected at soma, and that
     // that 0.3 nA is injected at dendrite tip.
     memory::fill(T, 10.);
     stim->nrn_current();
-    EXPECT_DOUBLE_EQ(-0.2, J[soma_cv]*A[soma_cv]*unit_factor);
-    EXPECT_DOUBLE_EQ(-0.3, J[tip_cv]*A[tip_cv]*unit_factor);
+    EXPECT_DOUBLE_EQ(-2*amp_soma, J[soma_cv]*A[soma_cv]*unit_factor);
+    EXPECT_DOUBLE_EQ(-amp_tip, J[tip_cv]*A[tip_cv]*unit_factor);
+}
+
+TEST(fvm_lowered, stimulus_schedule) {
+    // Two ball-and-stick cells with many stimuli, constant and sinusoidal,
+    // including stimuli that are never on, advanced with different times on
+    // each cell. The injected current is compared against a direct evaluation
+    // of every stimulus window.
+
+    execution_context context;
+
+    std::mt19937 gen(17);
+    std::uniform_int_distribution<int> quarter(0, 80);
+    std::uniform_int_distribution<int> coin(0, 2);
+
+    std::vector<mc_cell> cells;
+    for (unsigned c = 0; c<2; ++c) {
+        cells.push_back(make_cell_ball_and_stick(false));
+        for (unsigned k = 0; k<40; ++k) {
+            segment_location loc{k%2, k%2? 0.25*(k%5): 0.5};
+            // Times and parameters are exactly representable in the precision
+            // of mechanism state.
+            double delay = 0.25*quarter(gen);
+            double duration = 0.25*(quarter(gen)/4-2);
+            double amplitude = 0.125*(1+k%7);
+            double frequency = coin(gen)? 0: 0.25;
+            double phase = frequency? 0.5: 0;
+            cells[c].add_stimulus(loc, {delay, duration, amplitude, frequency, phase});
+        }
+    }
+
+    fvm_discretization D = fvm_discretize(cells);
+    const auto& A = D.cv_area;
+
+    std::vector<target_handle> targets;
+    probe_association_map<probe_handle> probe_map;
+
+    fvm_cell fvcell(context);
+    fvcell.initialize({0, 1}, cable1d_recipe(cells), targets, probe_map);
+
+    mechanism* stim = find_mechanism(fvcell, "_builtin_stimulus");
+    ASSERT_TRUE(stim);
+    EXPECT_EQ(80u, stim->size());
+
+    auto& state = *(fvcell.*private_state_ptr).get();
+    auto& J = state.current_density;
+    auto& T = state.time;
+
+    constexpr double unit_factor = 1e-3; // scale A/m²·µm² to nA
+    std::vector<double> t = {0, 0};
+    std::uniform_int_distribution<int> step(0, 4);
+
+    for (unsigned i = 0; i<100; ++i) {
+        for (unsigned c = 0; c<2; ++c) {
+            t[c] += 0.125*step(gen);
+            T[c] = t[c];
+        }
+        memory::fill(J, 0.);
+        stim->nrn_current();
+
+        std::vector<double> expected(D.ncomp, 0.);
+        for (unsigned c = 0; c<2; ++c) {
+            for (const auto& s: cells[c].stimuli()) {
+                const auto& clamp = s.clamp;
+                if (t[c]>=clamp.delay && t[c]<clamp.delay+clamp.duration) {
+                    double a = clamp.amplitude;
+                    if (clamp.frequency) {
+                        a *= std::sin(2*math::pi<double>*clamp.frequency*(t[c]-clamp.delay) + clamp.phase);
+                    }
+                    expected[D.segment_location_cv(c, s.location)] -= a;
+                }
+            }
+        }
+
+        for (unsigned cv = 0; cv<D.ncomp; ++cv) {
+            EXPECT_NEAR(expected[cv], J[cv]*A[cv]*unit_factor, 1e-9);
+        }
+    }
 }
 
 // Test derived mechanism behaviour.
@@ -447,3 +529,149 @@ TEST(fvm_lowered, weighted_write_ion) {
     EXPECT_EQ(expected_iconc, ion_iconc);
 }
 
+// Test that fusing the state update and current computation of the
+// density mechanisms leaves the integration unchanged.
+
+TEST(fvm_lowered, fused_kernels) {
+    // Ball and stick cell with hh on the soma, pas on the dendrite, and a
+    // stimulus. On the dendrite, test_kinlva writes the calcium current read
+    // by test_ca to update the calcium concentration.
+
+    mc_cell c = make_cell_ball_and_stick();
+    c.segment(1)->add_mechanism("test_kinlva");
+    c.segment(1)->add_mechanism("test_ca");
+
+    using fvec = std::vector<fvm_value_type>;
+
+    auto run = [&](bool fuse) {
+        cable1d_recipe rec(c);
+        rec.cell_global_properties().fuse_mechanism_kernels = fuse;
+
+        execution_context context;
+        std::vector<target_handle> targets;
+        probe_association_map<probe_handle> probe_map;
+
+        fvm_cell fvcell(context);
+        fvcell.initialize({0}, rec, targets, probe_map);
+
+        EXPECT_TRUE(find_mechanism(fvcell, "hh")->fusible());
+        EXPECT_TRUE(find_mechanism(fvcell, "pas")->fusible());
+        EXPECT_TRUE(find_mechanism(fvcell, "test_kinlva")->fusible());
+        EXPECT_FALSE(find_mechanism(fvcell, "test_ca")->fusible());
+
+        // Integrate in two parts, so that the fused mechanism currents
+        // carry over from one call to the next.
+        fvcell.integrate(12.3, 0.025, {}, {});
+        fvcell.integrate(30, 0.025, {}, {});
+
+        auto test_ca = dynamic_cast<multicore::mechanism*>(find_mechanism(fvcell, "test_ca"));
+        const fvm_state_type* cai = *util::value_by_key((test_ca->*private_field_table_ptr)(), "cai"s).value();
+
+        auto& state = *(fvcell.*private_state_ptr).get();
+        return std::make_pair(fvec(state.voltage.begin(), state.voltage.end()), fvec(cai, cai+test_ca->size()));
+    };
+
+    auto unfused = run(false);
+    auto fused = run(true);
+
+    // Results differ only by rounding, from the order in which currents
+    // are summed.
+    auto expect_near = [](const fvec& a, const fvec& b) {
+        ASSERT_EQ(a.size(), b.size());
+        for (unsigned i = 0; i<a.size(); ++i) {
+            EXPECT_TRUE(testing::near_relative(a[i], b[i], 1e-10));
+        }
+    };
+    expect_near(unfused.first, fused.first);
+    expect_near(unfused.second, fused.second);
+}
+
+// Test that the SIMD chunks of mechanisms on runs of consecutive CVs are
+// classified as contiguous, and of synapses on a common CV as constant.
+
+TEST(fvm_lowered, index_constraints) {
+    constexpr unsigned simd_width = arb::simd::simd_abi::native_width<fvm_value_type>::value;
+
+    mc_cell c = make_cell_ball_and_stick();
+    c.segment(1)->set_compartments(200);
+    for (unsigned i = 0; i<4*simd_width; ++i) {
+        c.add_synapse({1, 0.5}, "expsyn");
+    }
+
+    cable1d_recipe rec(c);
+    execution_context context;
+    std::vector<target_handle> targets;
+    probe_association_map<probe_handle> probe_map;
+
+    fvm_cell fvcell(context);
+    fvcell.initialize({0}, rec, targets, probe_map);
+
+    auto n_chunks = [](const multicore::constraint_partition& p) {
+        return p.contiguous.size()+p.constant.size()+p.independent.size()+p.none.size();
+    };
+
+    // pas on the CVs of the dendrite and its parent CV, 0 to 200: all but
+    // the padded last chunk are contiguous.
+    auto pas = dynamic_cast<multicore::mechanism*>(find_mechanism(fvcell, "pas"));
+    ASSERT_EQ(201u, pas->size());
+
+    const auto& pas_part = pas->index_constraints();
+    EXPECT_EQ((pas->size()+simd_width-1)/simd_width, n_chunks(pas_part));
+    EXPECT_GE(pas_part.contiguous.size()+1, n_chunks(pas_part));
+
+    auto expsyn = dynamic_cast<multicore::mechanism*>(find_mechanism(fvcell, "expsyn"));
+    const auto& expsyn_part = expsyn->index_constraints();
+    EXPECT_EQ(4u, n_chunks(expsyn_part));
+    EXPECT_EQ(4u, simd_width>1? expsyn_part.constant.size(): expsyn_part.contiguous.size());
+}
+
+// Test that renumbering the CVs leaves the integration unchanged, with
+// probes following their locations.
+
+TEST(fvm_lowered, cv_ordering) {
+    // Soma with hh and two dendritic subtrees, one with pas and one with hh,
+    // which are reordered by the depth-first ordering.
+
+    mc_cell c;
+    c.add_soma(6)->add_mechanism("hh");
+    c.add_cable(0, section_kind::dendrite, 0.5, 0.5, 200)->add_mechanism("pas");
+    c.add_cable(0, section_kind::dendrite, 0.4, 0.4, 200)->add_mechanism("hh");
+    c.add_cable(1, section_kind::dendrite, 0.3, 0.3, 150)->add_mechanism("pas");
+    c.add_cable(2, section_kind::dendrite, 0.3, 0.3, 150)->add_mechanism("hh");
+    for (auto i: util::make_span(1, 5)) {
+        c.segments()[i]->set_compartments(5);
+    }
+    c.add_stimulus({3, 1}, {1., 20., 0.2});
+    c.add_stimulus({4, 0.5}, {5., 20., 0.1});
+
+    auto run = [&](cv_ordering order) {
+        cable1d_recipe rec(c);
+        rec.cell_global_properties().cv_order = order;
+        for (auto i: util::make_span(0, 5)) {
+            rec.add_probe(0, 0, cell_probe_address{{cell_lid_type(i), 0.5}, cell_probe_address::membrane_voltage});
+            rec.add_probe(0, 0, cell_probe_address{{cell_lid_type(i), 1.}, cell_probe_address::membrane_voltage});
+        }
+
+        execution_context context;
+        std::vector<target_handle> targets;
+        probe_association_map<probe_handle> probe_map;
+
+        fvm_cell fvcell(context);
+        fvcell.initialize({0}, rec, targets, probe_map);
+        fvcell.integrate(20, 0.025, {}, {});
+
+        std::vector<fvm_value_type> v;
+        for (auto i: util::make_span(0, rec.num_probes(0))) {
+            v.push_back(*probe_map.at({0, cell_lid_type(i)}).handle);
+        }
+        return v;
+    };
+
+    auto v_segment = run(cv_ordering::segment);
+    auto v_depth_first = run(cv_ordering::depth_first);
+
+    ASSERT_EQ(v_segment.size(), v_depth_first.size());
+    for (auto i: util::count_along(v_segment)) {
+        EXPECT_TRUE(testing::near_relative(v_segment[i], v_depth_first[i], 1e-10));
+    }
+}
@@ -1,14 +1,27 @@
 #include "../gtest.h"
 
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 #include <arbor/domain_decomposition.hpp>
 #include <arbor/lif_cell.hpp>
 #include <arbor/load_balance.hpp>
 #include <arbor/recipe.hpp>
+#include <arbor/sampling.hpp>
 #include <arbor/schedule.hpp>
+#include <arbor/simple_sampler.hpp>
 #include <arbor/simulation.hpp>
 #include <arbor/spike_source_cell.hpp>
 
+#include "epoch.hpp"
+#include "event_lanes.hpp"
 #include "lif_cell_group.hpp"
+#include "util/rangeutil.hpp"
+#include "util/span.hpp"
 
 using namespace arb;
 // Simple ring network of LIF neurons.
@@ -215,6 +228,13 @@ TEST(lif_cell_group, ring)
     // There is one additional fake cell (regularly spiking cell).
     EXPECT_EQ(num_lif_cells + 1u, recipe.num_cells());
 
+    // Spikes are only generated locally.
+    auto stats = sim.local_spike_stats();
+    EXPECT_EQ(sim.num_spikes(), stats.num_spikes);
+    EXPECT_EQ(spike_buffer.size(), stats.num_spikes);
+    EXPECT_LE(stats.max_group_interval_spikes, stats.max_interval_spikes);
+    EXPECT_GT(stats.num_intervals, 0u);
+
     for (auto& spike : spike_buffer) {
         // Assumes that delay = 1
         // We expect that Regular Spiking Cell spiked at time 0s.
@@ -227,3 +247,509 @@ TEST(lif_cell_group, ring)
     }
 }
 
+
+namespace {
+    // LIF cells with the given parameters, with no connections, and one
+    // probe on each cell with tag the gid of the cell.
+    class lif_cells_recipe: public arb::recipe {
+    public:
+        lif_cells_recipe(std::vector<lif_cell> cells): cells_(std::move(cells)) {}
+
+        cell_size_type num_cells() const override {
+            return cells_.size();
+        }
+        cell_kind get_cell_kind(cell_gid_type) const override {
+            return cell_kind::lif_neuron;
+        }
+        util::unique_any get_cell_description(cell_gid_type gid) const override {
+            return cells_[gid];
+        }
+        cell_size_type num_probes(cell_gid_type) const override {
+            return 1;
+        }
+        probe_info get_probe(cell_member_type probe_id) const override {
+            return {probe_id, probe_tag(probe_id.gid), {}};
+        }
+
+    private:
+        std::vector<lif_cell> cells_;
+    };
+
+    // The events in [t0, t1) of a sorted lane.
+    pse_vector epoch_events(const pse_vector& lane, time_type t0, time_type t1) {
+        pse_vector events;
+        for (auto& e: lane) {
+            if (e.time>=t0 && e.time<t1) events.push_back(e);
+        }
+        return events;
+    }
+
+    // Reference exact solution for one cell and one epoch: returns the
+    // spike times, updating the cell state.
+    std::vector<time_type> reference_advance(lif_cell& cell, time_type& t, time_type tfinal, const pse_vector& events) {
+        std::vector<time_type> spikes;
+        for (unsigned i = 0; i<events.size(); ++i) {
+            const auto time = events[i].time;
+            double weight = events[i].weight;
+            if (time<t) continue;
+            if (time>=tfinal) break;
+            while (i+1<events.size() && events[i+1].time<=time) {
+                weight += events[++i].weight;
+            }
+            cell.V_m = cell.V_m*std::exp((double(t)-double(time))/cell.tau_m) + weight/cell.C_m;
+            t = time;
+            if (cell.V_m>=cell.V_th) {
+                spikes.push_back(t);
+                t = t+cell.t_ref;
+                cell.V_m = cell.E_L;
+            }
+        }
+        return spikes;
+    }
+
+    // Advance the group over the epochs ending at each of tfinal, with the
+    // events of each cell, returning the spikes sorted by gid and time.
+    std::vector<spike> run_group(lif_cell_group& group, const std::vector<pse_vector>& events, const std::vector<time_type>& tfinal, time_type dt) {
+        std::vector<spike> spikes;
+
+        event_lane_store lanes(events.size());
+        epoch ep;
+        for (auto t: tfinal) {
+            const auto t0 = ep.tfinal;
+            ep.advance(t);
+
+            lanes.clear();
+            for (auto i: util::make_span(events.size())) {
+                lanes.add_count(i, epoch_events(events[i], t0, t).size());
+            }
+            lanes.allocate();
+            for (auto i: util::make_span(events.size())) {
+                auto lane = epoch_events(events[i], t0, t);
+                std::copy(lane.begin(), lane.end(), lanes.lane(i).begin());
+            }
+
+            group.advance(ep, dt, lanes.subrange(0, events.size()));
+            spikes.insert(spikes.end(), group.spikes().begin(), group.spikes().end());
+            group.clear_spikes();
+        }
+
+        std::sort(spikes.begin(), spikes.end(),
+            [](const spike& a, const spike& b) { return std::tie(a.source, a.time)<std::tie(b.source, b.time); });
+        return spikes;
+    }
+
+    // Reference membrane potential of a cell with the exact solution at each
+    // of the sorted sample times, including the events at the sample time.
+    std::vector<double> reference_trace(lif_cell cell, const pse_vector& events, const std::vector<time_type>& times) {
+        std::vector<double> trace;
+        time_type t = 0;
+        std::size_t i = 0;
+        for (auto ts: times) {
+            pse_vector delivered;
+            while (i<events.size() && events[i].time<=ts) {
+                delivered.push_back(events[i++]);
+            }
+            reference_advance(cell, t, std::nextafter(ts, INFINITY), delivered);
+            trace.push_back(t>ts? cell.V_m: cell.V_m*std::exp((double(t)-double(ts))/cell.tau_m));
+        }
+        return trace;
+    }
+
+    // Samples of the membrane potential of each cell, indexed by gid.
+    struct trace_recorder {
+        std::vector<std::vector<std::pair<time_type, double>>> samples;
+
+        trace_recorder(std::size_t ncells): samples(ncells) {}
+
+        sampler_function sampler() {
+            return [this](cell_member_type probe, probe_tag tag, std::size_t n, const sample_record* recs) {
+                EXPECT_EQ(probe_tag(probe.gid), tag);
+                for (std::size_t i = 0; i<n; ++i) {
+                    samples[probe.gid].push_back({recs[i].time, *util::any_cast<const double*>(recs[i].data)});
+                }
+            };
+        }
+    };
+
+    std::vector<pse_vector> random_events(std::size_t ncells, std::size_t nevents, time_type tfinal, unsigned seed) {
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution<time_type> time_dist(0, tfinal);
+        std::uniform_real_distribution<float> weight_dist(-20, 200);
+
+        std::vector<pse_vector> events(ncells);
+        for (auto& lane: events) {
+            for (std::size_t i = 0; i<nevents; ++i) {
+                lane.push_back({{0, 0}, time_dist(gen), weight_dist(gen)});
+            }
+            // Events at the same time are delivered together.
+            lane.push_back(lane[0]);
+            util::sort(lane);
+        }
+        return events;
+    }
+}
+
+TEST(lif_cell_group, exact_batched)
+{
+    // A number of cells that is not a multiple of the SIMD width, with
+    // different parameters.
+    const std::size_t ncells = 13;
+    std::vector<lif_cell> cells(ncells);
+    for (auto i: util::make_span(ncells)) {
+        cells[i].tau_m = 5+i;
+        cells[i].V_th = 10+i%3;
+        cells[i].C_m = 10+2*i;
+        cells[i].t_ref = 1+0.25*i;
+    }
+
+    const std::vector<time_type> tfinal = {10, 20, 30, 50};
+    auto events = random_events(ncells, 200, 50, 7);
+
+    lif_cell_group group(util::assign_from(util::make_span(ncells)), lif_cells_recipe(cells));
+    auto spikes = run_group(group, events, tfinal, 0.1);
+
+    // Expected spikes from the scalar exact solution.
+    std::vector<spike> expected;
+    for (auto i: util::make_span(ncells)) {
+        auto cell = cells[i];
+        time_type t = 0, t0 = 0;
+        for (auto t1: tfinal) {
+            for (auto ts: reference_advance(cell, t, t1, epoch_events(events[i], t0, t1))) {
+                expected.push_back({{cell_gid_type(i), 0}, ts});
+            }
+            t0 = t1;
+        }
+    }
+
+    ASSERT_FALSE(expected.empty());
+    ASSERT_EQ(expected.size(), spikes.size());
+    for (auto i: util::make_span(expected.size())) {
+        EXPECT_EQ(expected[i].source, spikes[i].source);
+        EXPECT_FLOAT_EQ(expected[i].time, spikes[i].time);
+    }
+
+    // The same spikes after a reset.
+    group.reset();
+    EXPECT_EQ(spikes, run_group(group, events, tfinal, 0.1));
+}
+
+TEST(lif_cell_group, stepped)
+{
+    lif_cell cell;
+    cell.integration = lif_integration::stepped;
+    cell.t_ref = 2;
+
+    const time_type dt = 0.25;
+    lif_cell_group group(std::vector<cell_gid_type>{0}, lif_cells_recipe({cell}));
+
+    // Events are delivered at the end of the step in which they arrive, and
+    // the threshold is tested there. The second event is in the refractory
+    // period, and the last two events are summed in one step.
+    std::vector<pse_vector> events = {{
+        {{0, 0}, 1.1, 500},
+        {{0, 0}, 2.5, 500},
+        {{0, 0}, 7.3, 100},
+        {{0, 0}, 7.4, 100}
+    }};
+    auto spikes = run_group(group, events, {5, 10}, dt);
+
+    ASSERT_EQ(2u, spikes.size());
+    EXPECT_EQ(1.25f, spikes[0].time);
+    EXPECT_EQ(7.5f, spikes[1].time);
+}
+
+TEST(lif_cell_group, mixed_integration)
+{
+    // Cells integrated with time steps and with the exact solution in one
+    // group. With events on the time step grid, the stepped cells see each
+    // event one step later than the exact cells, and so fire one step later.
+    const std::size_t ncells = 6;
+    std::vector<lif_cell> cells(ncells);
+    for (auto i: util::make_span(ncells)) {
+        if (i%2) cells[i].integration = lif_integration::stepped;
+        cells[i].tau_m = 5+i/2;
+    }
+
+    const time_type dt = 0.125;
+    std::vector<pse_vector> events(ncells);
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<int> step_dist(1, 399);
+    for (auto i: util::make_span(ncells/2)) {
+        pse_vector lane;
+        for (int j = 0; j<60; ++j) {
+            lane.push_back({{0, 0}, time_type(step_dist(gen)*dt), 60.f});
+        }
+        util::sort(lane);
+        events[2*i] = lane;
+        events[2*i+1] = lane;
+    }
+
+    lif_cell_group group(util::assign_from(util::make_span(ncells)), lif_cells_recipe(cells));
+    auto spikes = run_group(group, events, {20, 50}, dt);
+
+    std::vector<time_type> exact_times[2];
+    for (auto& s: spikes) {
+        exact_times[s.source.gid%2].push_back(s.time);
+    }
+    ASSERT_FALSE(exact_times[0].empty());
+    ASSERT_EQ(exact_times[0].size(), exact_times[1].size());
+    for (auto i: util::make_span(exact_times[0].size())) {
+        EXPECT_NEAR(exact_times[0][i]+dt, exact_times[1][i], 1e-4);
+    }
+}
+
+TEST(lif_cell_group, sampling_exact)
+{
+    const std::size_t ncells = 11;
+    std::vector<lif_cell> cells(ncells);
+    for (auto i: util::make_span(ncells)) {
+        cells[i].tau_m = 5+i;
+        cells[i].C_m = 10+2*i;
+        cells[i].t_ref = 1+0.25*i;
+    }
+
+    const std::vector<time_type> tfinal = {10, 20, 30, 50};
+    auto events = random_events(ncells, 100, 50, 11);
+
+    // Sample every other cell, at times that include the times of events.
+    std::vector<time_type> times;
+    for (unsigned i = 0; i<500; ++i) {
+        times.push_back(0.1f*i);
+    }
+    times.push_back(events[0][10].time);
+    util::sort(times);
+
+    lif_cell_group group(util::assign_from(util::make_span(ncells)), lif_cells_recipe(cells));
+    trace_recorder recorder(ncells);
+    group.add_sampler(0, [](cell_member_type p) { return p.gid%2==0; },
+        explicit_schedule(times), recorder.sampler(), sampling_policy::lax);
+
+    auto spikes = run_group(group, events, tfinal, 0.1);
+    ASSERT_FALSE(spikes.empty());
+
+    for (auto i: util::make_span(ncells)) {
+        auto& samples = recorder.samples[i];
+        if (i%2) {
+            EXPECT_TRUE(samples.empty());
+            continue;
+        }
+
+        auto expected = reference_trace(cells[i], events[i], times);
+        ASSERT_EQ(times.size(), samples.size());
+        for (auto j: util::make_span(times.size())) {
+            EXPECT_EQ(times[j], samples[j].first);
+            EXPECT_NEAR(expected[j], samples[j].second, 1e-6*std::max(1., std::abs(expected[j])));
+        }
+    }
+
+    // The same samples after a reset, and none after the sampler is removed.
+    auto first_run = recorder.samples;
+    for (auto& s: recorder.samples) s.clear();
+    group.reset();
+    run_group(group, events, tfinal, 0.1);
+    EXPECT_EQ(first_run, recorder.samples);
+
+    for (auto& s: recorder.samples) s.clear();
+    group.remove_sampler(0);
+    group.reset();
+    run_group(group, events, tfinal, 0.1);
+    for (auto& s: recorder.samples) {
+        EXPECT_TRUE(s.empty());
+    }
+}
+
+TEST(lif_cell_group, bulk_sampler)
+{
+    const std::size_t ncells = 5;
+    std::vector<lif_cell> cells(ncells);
+    for (auto i: util::make_span(ncells)) {
+        cells[i].tau_m = 5+i;
+    }
+    auto events = random_events(ncells, 50, 20, 13);
+
+    std::vector<cell_member_type> probe_ids;
+    for (auto i: util::make_span(ncells)) {
+        probe_ids.push_back({cell_gid_type(i), 0});
+    }
+
+    lif_cell_group group(util::assign_from(util::make_span(ncells)), lif_cells_recipe(cells));
+    trace_recorder recorder(ncells);
+    group.add_sampler(0, all_probes, regular_schedule(0.5), recorder.sampler(), sampling_policy::lax);
+
+    columnar_recorder bulk(probe_ids, 40);
+    unsigned n_bulk_calls = 0;
+    group.add_bulk_sampler(1, all_probes, regular_schedule(0.5),
+        [&](const sample_columns& samples) {
+            ++n_bulk_calls;
+            EXPECT_EQ(ncells, samples.n_probe);
+            bulk.record(samples);
+        },
+        sampling_policy::lax);
+
+    run_group(group, events, {10, 20}, 0.1);
+    EXPECT_EQ(2u, n_bulk_calls);
+
+    for (auto i: util::make_span(ncells)) {
+        const auto& samples = recorder.samples[i];
+        const auto& columns = bulk.trace(probe_ids[i]);
+        ASSERT_EQ(40u, samples.size());
+        ASSERT_EQ(samples.size(), columns.time.size());
+        for (auto j: util::count_along(samples)) {
+            EXPECT_EQ(samples[j].first, columns.time[j]);
+            EXPECT_EQ(samples[j].second, columns.value[j]);
+        }
+    }
+}
+
+TEST(lif_cell_group, sampling_stepped)
+{
+    lif_cell cell;
+    cell.integration = lif_integration::stepped;
+    cell.t_ref = 2;
+
+    const time_type dt = 0.25;
+    lif_cell_group group(std::vector<cell_gid_type>{0}, lif_cells_recipe({cell}));
+
+    // The first event raises the potential to 5 mV at the end of its step.
+    // The second fires the cell at 4.25 ms, and the third is lost in the
+    // refractory period, which ends at 6 ms, in the second epoch.
+    std::vector<pse_vector> events = {{
+        {{0, 0}, 1.1, 100},
+        {{0, 0}, 4.1, 200},
+        {{0, 0}, 5.1, 100},
+        {{0, 0}, 6.1, 100}
+    }};
+    std::vector<time_type> times = {1.0, 1.25, 1.3, 3.0, 5.5, 6.0, 6.25, 6.5};
+    std::vector<double> expected = {0, 5, 5*std::exp(-0.005), 5*std::exp(-0.175), 0, 0, 5, 5*std::exp(-0.025)};
+
+    trace_recorder recorder(1);
+    group.add_sampler(0, all_probes, explicit_schedule(times), recorder.sampler(), sampling_policy::lax);
+    auto spikes = run_group(group, events, {5, 10}, dt);
+
+    ASSERT_EQ(1u, spikes.size());
+    EXPECT_EQ(4.25f, spikes[0].time);
+
+    auto& samples = recorder.samples[0];
+    ASSERT_EQ(times.size(), samples.size());
+    for (auto j: util::make_span(times.size())) {
+        EXPECT_EQ(times[j], samples[j].first);
+        EXPECT_NEAR(expected[j], samples[j].second, 1e-6);
+    }
+}
+
+TEST(lif_cell_group, binning)
+{
+    lif_cell cell;
+    std::vector<pse_vector> events = {{
+        {{0, 0}, 1.3, 100},
+        {{0, 0}, 2.7, 100}
+    }};
+    std::vector<time_type> times = {1.2, 2.5};
+
+    // Without binning, the first event arrives after the first sample.
+    {
+        lif_cell_group group(std::vector<cell_gid_type>{0}, lif_cells_recipe({cell}));
+        trace_recorder recorder(1);
+        group.add_sampler(0, all_probes, explicit_schedule(times), recorder.sampler(), sampling_policy::lax);
+        run_group(group, events, {5}, 0.1);
+
+        ASSERT_EQ(2u, recorder.samples[0].size());
+        EXPECT_EQ(0., recorder.samples[0][0].second);
+        EXPECT_NEAR(5*std::exp(-0.12), recorder.samples[0][1].second, 1e-6);
+    }
+
+    // With regular binning, the events are delivered at 1 and 2 ms.
+    {
+        lif_cell_group group(std::vector<cell_gid_type>{0}, lif_cells_recipe({cell}));
+        group.set_binning_policy(binning_kind::regular, 1);
+        trace_recorder recorder(1);
+        group.add_sampler(0, all_probes, explicit_schedule(times), recorder.sampler(), sampling_policy::lax);
+        run_group(group, events, {5}, 0.1);
+
+        ASSERT_EQ(2u, recorder.samples[0].size());
+        EXPECT_NEAR(5*std::exp(-0.02), recorder.samples[0][0].second, 1e-6);
+        EXPECT_NEAR((5*std::exp(-0.1)+5)*std::exp(-0.05), recorder.samples[0][1].second, 1e-6);
+    }
+}
+
+// Two LIF cells with the same generated and network input, of which only
+// the first has generators that are all countable, and a third cell that
+// provides the network input.
+class generator_recipe: public arb::recipe {
+public:
+    cell_size_type num_cells() const override {
+        return 3;
+    }
+
+    cell_kind get_cell_kind(cell_gid_type gid) const override {
+        return cell_kind::lif_neuron;
+    }
+
+    std::vector<cell_connection> connections_on(cell_gid_type gid) const override {
+        if (gid==2) {
+            return {};
+        }
+        return {cell_connection({2, 0}, {gid, 0}, 1000, 1.5)};
+    }
+
+    util::unique_any get_cell_description(cell_gid_type gid) const override {
+        return lif_cell();
+    }
+
+    cell_size_type num_sources(cell_gid_type) const override {
+        return 1;
+    }
+    cell_size_type num_targets(cell_gid_type) const override {
+        return 1;
+    }
+    cell_size_type num_probes(cell_gid_type) const override {
+        return 0;
+    }
+    probe_info get_probe(cell_member_type probe_id) const override {
+        return {};
+    }
+    std::vector<event_generator> event_generators(cell_gid_type gid) const override {
+        cell_member_type target{gid, 0};
+        if (gid==2) {
+            return {regular_generator(target, 1000, 0.3, 4.1)};
+        }
+
+        std::vector<event_generator> gens = {
+            regular_generator(target, 1000, 1, 7.3),
+            counter_poisson_generator(target, 1000, 0.5, 0.2, 17)
+        };
+        if (gid==1) {
+            gens.push_back(explicit_generator(pse_vector{}));
+        }
+        return gens;
+    }
+};
+
+TEST(lif_cell_group, generators) {
+    generator_recipe recipe;
+
+    execution_context context;
+    proc_allocation nd = local_allocation(context);
+
+    auto decomp = partition_load_balance(recipe, nd, context);
+    simulation sim(recipe, decomp, context);
+
+    std::vector<time_type> spike_times[2];
+    sim.set_global_spike_callback(
+        [&](const std::vector<spike>& spikes) {
+            for (auto& s: spikes) {
+                if (s.source.gid<2) {
+                    spike_times[s.source.gid].push_back(s.time);
+                }
+            }
+        });
+
+    sim.run(100, 0.025);
+
+    // The events of the first cell are merged directly into its event lane,
+    // and those of the second through the staging buffer.
+    EXPECT_FALSE(spike_times[0].empty());
+    util::sort(spike_times[0]);
+    util::sort(spike_times[1]);
+    EXPECT_EQ(spike_times[0], spike_times[1]);
+}
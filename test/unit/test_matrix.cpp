@@ -1,4 +1,5 @@
 #include <numeric>
+#include <random>
 #include <vector>
 
 #include "../gtest.h"
@@ -7,6 +8,8 @@
 
 #include "matrix.hpp"
 #include "backends/multicore/fvm.hpp"
+#include "backends/multicore/matrix_state.hpp"
+#include "backends/multicore/matrix_state_interleaved.hpp"
 #include "util/rangeutil.hpp"
 #include "util/span.hpp"
 
@@ -14,7 +17,9 @@
 
 using namespace arb;
 
-using matrix_type = matrix<arb::multicore::backend>;
+// Tests below manipulate the flat matrix state directly.
+using matrix_type = matrix<arb::multicore::backend,
+    arb::multicore::matrix_state<fvm_value_type, fvm_index_type>>;
 using index_type = matrix_type::index_type;
 using value_type = matrix_type::value_type;
 
@@ -177,3 +182,110 @@ TEST(matrix, zero_diagonal_assembled)
     EXPECT_TRUE(testing::seq_almost_eq<double>(expected, x));
 }
 
+
+// Compare the interleaved (SIMD across cells) state with block width W
+// against the flat state on a set of cells of mixed sizes and structures,
+// some of them repeated so that blocks of identically structured cells are
+// formed.
+template <unsigned W>
+void check_interleaved_vs_flat()
+{
+    using util::make_span;
+    using intl_type = matrix<arb::multicore::backend,
+        arb::multicore::matrix_state_interleaved<value_type, index_type, W>>;
+    using array = matrix_type::array;
+
+    std::minstd_rand R(3);
+
+    // Random tree with n nodes, each with a parent among the four preceding.
+    auto random_tree = [&R](unsigned n) {
+        std::vector<index_type> p(n, 0);
+        for (auto i: make_span(1u, n)) {
+            p[i] = std::uniform_int_distribution<index_type>(i>4? i-4: 0, i-1)(R);
+        }
+        return p;
+    };
+
+    std::vector<std::vector<index_type>> shapes;
+    for (auto n: {1u, 2u, 5u, 17u, 17u, 40u}) {
+        shapes.push_back(random_tree(n));
+    }
+
+    // Larger sets of cells span more than one chunk in assemble_and_solve().
+    for (unsigned ncell: {1u, 3u, 7u, 25u, 200u}) {
+        std::vector<index_type> p, c = {0};
+        for (auto i: make_span(ncell)) {
+            const auto& s = shapes[(i*7+i/3)%shapes.size()];
+            auto first = c.back();
+            for (auto j: s) p.push_back(first+j);
+            c.push_back(first+s.size());
+        }
+
+        const unsigned n = p.size();
+        std::uniform_real_distribution<value_type> U(0.5, 2);
+        vvec Cm(n), g(n), area(n);
+        array v(n), i(n), dt(ncell);
+        for (auto k: make_span(n)) {
+            Cm[k] = U(R);
+            g[k] = U(R);
+            area[k] = U(R);
+            v[k] = -60*U(R);
+            i[k] = 100*U(R);
+        }
+        for (auto k: make_span(ncell)) {
+            // Every fourth cell has a zero dt.
+            dt[k] = k%4==1? 0: 0.025*U(R);
+        }
+
+        matrix_type flat(p, c, Cm, g, area);
+        intl_type intl(p, c, Cm, g, area);
+
+        // Repeat to check that state is reset correctly on assembly, and
+        // compare separate assembly and solve with the fused version.
+        for (bool fused: {false, true}) {
+            if (fused) {
+                flat.assemble_and_solve(dt, v, i);
+                intl.assemble_and_solve(dt, v, i);
+            }
+            else {
+                flat.assemble(dt, v, i);
+                flat.solve();
+                intl.assemble(dt, v, i);
+                intl.solve();
+            }
+
+            const auto& s_flat = flat.solution();
+            const auto& s_intl = intl.solution();
+            vvec x_flat(s_flat.begin(), s_flat.end());
+            vvec x_intl(s_intl.begin(), s_intl.end());
+
+            // Results may differ in rounding with vectorized arithmetic.
+            ASSERT_EQ(n, x_intl.size());
+            for (auto k: make_span(n)) {
+                EXPECT_TRUE(testing::near_relative(x_flat[k], x_intl[k], 1e-12));
+            }
+        }
+    }
+}
+
+TEST(matrix, interleaved_vs_flat)
+{
+    // The native width is 1 in a build without vectorization, so also
+    // test the packing, padding and per-lane sweeps at fixed widths.
+    {
+        SCOPED_TRACE("width 1");
+        check_interleaved_vs_flat<1>();
+    }
+    {
+        SCOPED_TRACE("width 4");
+        check_interleaved_vs_flat<4>();
+    }
+    {
+        SCOPED_TRACE("width 8");
+        check_interleaved_vs_flat<8>();
+    }
+    {
+        SCOPED_TRACE("native width");
+        check_interleaved_vs_flat<simd::simd_abi::native_width<value_type>::value>();
+    }
+}
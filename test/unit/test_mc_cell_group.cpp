@@ -1,11 +1,16 @@
 #include "../gtest.h"
 
 #include <arbor/common_types.hpp>
+#include <arbor/sampling.hpp>
+#include <arbor/schedule.hpp>
+#include <arbor/simple_sampler.hpp>
 
 #include "epoch.hpp"
+#include "event_lanes.hpp"
 #include "fvm_lowered_cell.hpp"
 #include "mc_cell_group.hpp"
 #include "util/rangeutil.hpp"
+#include "util/span.hpp"
 
 #include "common.hpp"
 #include "../common_cells.hpp"
@@ -84,3 +89,265 @@ TEST(mc_cell_group, sources) {
         }
     }
 }
+
+TEST(mc_cell_group, bulk_sampler) {
+    std::vector<mc_cell> cells = {make_cell(), make_cell()};
+    cable1d_recipe rec(cells);
+
+    std::vector<cell_member_type> probe_ids;
+    for (cell_gid_type gid: {0u, 1u}) {
+        rec.add_probe(gid, 10*gid, cell_probe_address{{0, 0.}, cell_probe_address::membrane_voltage});
+        rec.add_probe(gid, 10*gid+1, cell_probe_address{{1, 0.5}, cell_probe_address::membrane_voltage});
+        probe_ids.push_back({gid, 0});
+        probe_ids.push_back({gid, 1});
+    }
+
+    mc_cell_group group{{0, 1}, rec, lowered_cell()};
+
+    // Reference traces from a simple sampler on each probe.
+    std::vector<trace_data<double>> traces(probe_ids.size());
+    for (auto i: util::count_along(probe_ids)) {
+        group.add_sampler(i, one_probe(probe_ids[i]), regular_schedule(0.1),
+            make_simple_sampler(traces[i]), sampling_policy::lax);
+    }
+
+    // One call per epoch to the bulk sampler, for all of the probes.
+    columnar_recorder bulk(probe_ids, 200);
+    unsigned n_bulk_calls = 0;
+    auto bulk_sampler = [&](const sample_columns& samples) {
+        ++n_bulk_calls;
+        EXPECT_EQ(probe_ids.size(), samples.n_probe);
+        for (std::size_t i = 0; i<samples.n_probe; ++i) {
+            EXPECT_EQ(probe_tag(10*samples.probe_id[i].gid+samples.probe_id[i].index), samples.tag[i]);
+        }
+        bulk.record(samples);
+    };
+    group.add_bulk_sampler(10, all_probes, regular_schedule(0.1), bulk_sampler, sampling_policy::lax);
+
+    // The default cell group implementation calls the bulk sampler per probe.
+    columnar_recorder per_probe(probe_ids, 200);
+    group.cell_group::add_bulk_sampler(11, all_probes, regular_schedule(0.1), per_probe.sampler(), sampling_policy::lax);
+
+    group.advance(epoch(0, 10), 0.01, {});
+    group.advance(epoch(1, 20), 0.01, {});
+    EXPECT_EQ(2u, n_bulk_calls);
+
+    for (auto i: util::count_along(probe_ids)) {
+        const auto& trace = traces[i];
+        ASSERT_FALSE(trace.empty());
+
+        for (const trace_columns* columns: {&bulk.trace(probe_ids[i]), &per_probe.trace(probe_ids[i])}) {
+            ASSERT_EQ(trace.size(), columns->time.size());
+            ASSERT_EQ(trace.size(), columns->value.size());
+            for (auto j: util::count_along(trace)) {
+                EXPECT_EQ(trace[j].t, columns->time[j]);
+                EXPECT_EQ(trace[j].v, columns->value[j]);
+            }
+        }
+    }
+
+    // Removal of a bulk sampler.
+    bulk.clear();
+    group.remove_sampler(10);
+    group.advance(epoch(2, 30), 0.01, {});
+    EXPECT_EQ(2u, n_bulk_calls);
+    EXPECT_TRUE(bulk.trace(probe_ids[0]).time.empty());
+}
+
+TEST(mc_cell_group, remove_in_callback) {
+    std::vector<mc_cell> cells = {make_cell()};
+    cable1d_recipe rec(cells);
+    rec.add_probe(0, 0, cell_probe_address{{0, 0.}, cell_probe_address::membrane_voltage});
+    std::vector<cell_member_type> probe_ids = {{0, 0}};
+
+    mc_cell_group group{{0}, rec, lowered_cell()};
+
+    // Samplers removed by a callback still receive the samples taken for
+    // them in the current epoch, and none after.
+    unsigned n_calls = 0;
+    auto remove_all = [&](cell_member_type, probe_tag, std::size_t, const sample_record*) {
+        ++n_calls;
+        group.remove_all_samplers();
+    };
+    group.add_sampler(0, all_probes, regular_schedule(0.1), remove_all, sampling_policy::lax);
+
+    columnar_recorder bulk(probe_ids, 100);
+    group.add_bulk_sampler(1, all_probes, regular_schedule(0.1), bulk.sampler(), sampling_policy::lax);
+
+    group.advance(epoch(0, 10), 0.01, {});
+    EXPECT_EQ(1u, n_calls);
+    EXPECT_EQ(100u, bulk.trace(probe_ids[0]).time.size());
+
+    bulk.clear();
+    group.advance(epoch(1, 20), 0.01, {});
+    EXPECT_EQ(1u, n_calls);
+    EXPECT_TRUE(bulk.trace(probe_ids[0]).time.empty());
+}
+
+TEST(mc_cell_group, sampling_plan) {
+    // Three cells with three probes each, sampled by associations with
+    // different schedules and probe sets, which are added and removed
+    // between epochs.
+    std::vector<mc_cell> cells = {make_cell(), make_cell(), make_cell()};
+    cable1d_recipe rec(cells);
+
+    std::vector<cell_member_type> probe_ids;
+    for (cell_gid_type gid: {0u, 1u, 2u}) {
+        rec.add_probe(gid, 0, cell_probe_address{{0, 0.}, cell_probe_address::membrane_voltage});
+        rec.add_probe(gid, 0, cell_probe_address{{1, 0.5}, cell_probe_address::membrane_current});
+        rec.add_probe(gid, 0, cell_probe_address{{1, 0.9}, cell_probe_address::membrane_voltage});
+        for (cell_lid_type i: {0u, 1u, 2u}) {
+            probe_ids.push_back({gid, i});
+        }
+    }
+
+    mc_cell_group group{{2, 0, 1}, rec, lowered_cell()};
+
+    // One association per probe, and one for all of the probes.
+    std::vector<trace_data<double>> traces(probe_ids.size());
+    for (auto i: util::count_along(probe_ids)) {
+        group.add_sampler(i, one_probe(probe_ids[i]), regular_schedule(0.5),
+            make_simple_sampler(traces[i]), sampling_policy::lax);
+    }
+
+    columnar_recorder all(probe_ids, 60);
+    group.add_bulk_sampler(100, all_probes, regular_schedule(0.5), all.sampler(), sampling_policy::lax);
+
+    // An association for the probes on cells 0 and 2, with sample times
+    // that are a subset of those above.
+    std::vector<cell_member_type> sparse_ids;
+    for (auto pid: probe_ids) {
+        if (pid.gid!=1) sparse_ids.push_back(pid);
+    }
+
+    columnar_recorder sparse(sparse_ids, 5);
+    group.add_bulk_sampler(101, [](cell_member_type pid) { return pid.gid!=1; },
+        explicit_schedule({1.f, 2.5f, 7.f, 12.f, 15.5f}), sparse.sampler(), sampling_policy::lax);
+
+    group.advance(epoch(0, 10), 0.01, {});
+    group.advance(epoch(1, 20), 0.01, {});
+
+    group.remove_sampler(101);
+    group.advance(epoch(2, 30), 0.01, {});
+
+    for (auto i: util::count_along(probe_ids)) {
+        const auto& trace = traces[i];
+        const auto& columns = all.trace(probe_ids[i]);
+
+        ASSERT_EQ(60u, trace.size());
+        ASSERT_EQ(60u, columns.time.size());
+        for (auto j: util::count_along(trace)) {
+            EXPECT_EQ(time_type(0.5*j), trace[j].t);
+            EXPECT_EQ(trace[j].t, columns.time[j]);
+            EXPECT_EQ(trace[j].v, columns.value[j]);
+        }
+    }
+
+    for (auto pid: sparse_ids) {
+        const auto& trace = traces[3*pid.gid+pid.index];
+        const auto& columns = sparse.trace(pid);
+
+        ASSERT_EQ(5u, columns.time.size());
+        for (auto j: util::count_along(columns.time)) {
+            time_type t = columns.time[j];
+            EXPECT_EQ(trace[std::size_t(2*t)].t, t);
+            EXPECT_EQ(trace[std::size_t(2*t)].v, columns.value[j]);
+        }
+    }
+}
+
+TEST(mc_cell_group, sampling_policy) {
+    // Samples of the soma voltage, with a time step of 1/16 ms.
+    const time_type dt = 0.0625;
+
+    mc_cell c = make_cell();
+    c.add_synapse({1, 0.5}, "expsyn");
+
+    cable1d_recipe rec(c);
+    rec.add_probe(0, 0, cell_probe_address{{0, 0.}, cell_probe_address::membrane_voltage});
+
+    // Interpolated samples at the start of a step are the same as lax samples,
+    // and those half way through a step are the mean of the states at either
+    // end of the step.
+    {
+        mc_cell_group group{{0}, rec, lowered_cell()};
+
+        trace_data<double> lax, interpolated;
+        group.add_sampler(0, all_probes, regular_schedule(dt), make_simple_sampler(lax), sampling_policy::lax);
+        group.add_sampler(1, all_probes, regular_schedule(dt/2), make_simple_sampler(interpolated), sampling_policy::interpolated);
+        group.advance(epoch(0, 20), dt, {});
+
+        ASSERT_EQ(320u, lax.size());
+        ASSERT_EQ(640u, interpolated.size());
+        for (unsigned j = 0; j+1<lax.size(); ++j) {
+            EXPECT_EQ(lax[j].t, interpolated[2*j].t);
+            EXPECT_EQ(lax[j].v, interpolated[2*j].v);
+
+            EXPECT_EQ(lax[j].t+dt/2, interpolated[2*j+1].t);
+            EXPECT_NEAR(0.5*(lax[j].v+lax[j+1].v), interpolated[2*j+1].v, 1e-10);
+        }
+    }
+
+    // Exact samples off the time step grid are the same as lax samples taken
+    // at the times of events, which also end integration steps. The events
+    // have zero weight, and do not otherwise change the state of the cell.
+    {
+        std::vector<time_type> times = {0.3f, 1.01f, 5.55f, 10.f, 17.3f};
+
+        mc_cell_group group{{0}, rec, lowered_cell()};
+        trace_data<double> exact;
+        group.add_sampler(0, all_probes, explicit_schedule(times), make_simple_sampler(exact), sampling_policy::exact);
+        group.advance(epoch(0, 10), dt, {});
+        group.advance(epoch(1, 20), dt, {});
+
+        mc_cell_group ref_group{{0}, rec, lowered_cell()};
+        trace_data<double> ref;
+        ref_group.add_sampler(0, all_probes, explicit_schedule(times), make_simple_sampler(ref), sampling_policy::lax);
+
+        std::vector<spike_event> events;
+        for (auto t: times) {
+            events.push_back({{0, 0}, t, 0.f});
+        }
+        std::vector<std::size_t> divs = {0, 3, 5};
+        ref_group.advance(epoch(0, 10), dt, event_lane_subrange(events.data(), divs.data(), 1));
+        ref_group.advance(epoch(1, 20), dt, event_lane_subrange(events.data(), divs.data()+1, 1));
+
+        ASSERT_EQ(times.size(), exact.size());
+        ASSERT_EQ(times.size(), ref.size());
+        for (auto j: util::count_along(times)) {
+            EXPECT_EQ(times[j], exact[j].t);
+            EXPECT_EQ(ref[j].t, exact[j].t);
+            EXPECT_EQ(ref[j].v, exact[j].v);
+        }
+    }
+}
+
+TEST(mc_cell_group, interpolated_current) {
+    // The membrane current is constant over an integration step, so
+    // interpolated samples of a current probe take the value at the start
+    // of the step, with or without fused mechanism kernels, which compute
+    // the currents of the next step at the end of each step.
+    const time_type dt = 0.0625;
+
+    for (bool fuse: {false, true}) {
+        SCOPED_TRACE(fuse? "fused": "unfused");
+
+        cable1d_recipe rec(make_cell());
+        rec.cell_global_properties().fuse_mechanism_kernels = fuse;
+        rec.add_probe(0, 0, cell_probe_address{{0, 0.5}, cell_probe_address::membrane_current});
+
+        mc_cell_group group{{0}, rec, lowered_cell()};
+
+        trace_data<double> lax, interpolated;
+        group.add_sampler(0, all_probes, regular_schedule(dt), make_simple_sampler(lax), sampling_policy::lax);
+        group.add_sampler(1, all_probes, regular_schedule(dt/2), make_simple_sampler(interpolated), sampling_policy::interpolated);
+        group.advance(epoch(0, 10), dt, {});
+
+        ASSERT_EQ(160u, lax.size());
+        ASSERT_EQ(320u, interpolated.size());
+        for (unsigned j = 0; j<lax.size(); ++j) {
+            EXPECT_EQ(lax[j].v, interpolated[2*j].v);
+            EXPECT_EQ(lax[j].v, interpolated[2*j+1].v);
+        }
+    }
+}
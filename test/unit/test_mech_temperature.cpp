@@ -16,6 +16,8 @@ using namespace arb;
 
 template <typename backend>
 void run_celsius_test() {
+    using state_type = typename backend::state_type;
+
     auto cat = make_unit_test_catalogue();
 
     // one cell, three CVs:
@@ -51,7 +53,7 @@ void run_celsius_test() {
     // expect temperature_C value in state 'c' after state update:
 
     celsius_test->nrn_state();
-    expected_c_values.assign(ncv, temperature_C);
+    expected_c_values.assign(ncv, state_type(temperature_C));
 
     EXPECT_EQ(expected_c_values, mechanism_field(celsius_test.get(), "c"));
 
@@ -64,7 +66,7 @@ void run_celsius_test() {
     celsius_test->nrn_init();
 
     celsius_test->nrn_state();
-    expected_c_values.assign(ncv, temperature_C);
+    expected_c_values.assign(ncv, state_type(temperature_C));
 
     EXPECT_EQ(expected_c_values, mechanism_field(celsius_test.get(), "c"));
 }
@@ -8,16 +8,6 @@
 #include "merge_events.hpp"
 #include "util/rangeutil.hpp"
 
-namespace arb {
-void merge_cell_events(
-    time_type t_from,
-    time_type t_to,
-    event_span old_events,
-    event_span pending,
-    std::vector<event_generator>& generators,
-    pse_vector& new_events);
-} // namespace arb
-
 using namespace arb;
 
 // Wrapper for arb::merge_cell_events.
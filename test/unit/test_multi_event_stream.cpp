@@ -4,6 +4,7 @@
 #include "backends/event.hpp"
 #include "backends/multicore/multi_event_stream.hpp"
 #include "util/rangeutil.hpp"
+#include "util/span.hpp"
 
 using namespace arb;
 
@@ -59,6 +60,38 @@ TEST(multi_event_stream, init) {
     EXPECT_TRUE(m.empty());
 }
 
+TEST(multi_event_stream, init_grouped) {
+    using multi_event_stream = multicore::multi_event_stream<deliverable_event>;
+
+    // The common events grouped by cell, as staged by a cell group, give
+    // the same streams as the time-sorted events.
+    std::vector<deliverable_event> grouped = {
+        common_events[1], // cell_1
+        common_events[2], // cell_3
+        common_events[0], // cell_2
+        common_events[3]  // cell_2
+    };
+
+    multi_event_stream m(n_cell), m_ref(n_cell);
+    m.init(grouped);
+    m_ref.init(common_events);
+
+    std::vector<time_type> t_until(n_cell, 5.f);
+    m.mark_until_after(t_until);
+    m_ref.mark_until_after(t_until);
+
+    for (cell_size_type i = 0; i<n_cell; ++i) {
+        auto evs = marked_range(m, i);
+        auto ref = marked_range(m_ref, i);
+        ASSERT_EQ(ref.size(), evs.size());
+        for (auto j: util::count_along(evs)) {
+            EXPECT_EQ(ref[j].mech_id, evs[j].mech_id);
+            EXPECT_EQ(ref[j].mech_index, evs[j].mech_index);
+            EXPECT_EQ(ref[j].weight, evs[j].weight);
+        }
+    }
+}
+
 TEST(multi_event_stream, mark) {
     using multi_event_stream = multicore::multi_event_stream<deliverable_event>;
 
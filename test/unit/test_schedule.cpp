@@ -6,6 +6,7 @@
 #include <arbor/common_types.hpp>
 #include <arbor/schedule.hpp>
 
+#include "philox.hpp"
 #include "util/partition.hpp"
 #include "util/rangeutil.hpp"
 
@@ -348,3 +349,89 @@ TEST(schedule, poisson_offset_reset) {
     run_reset_check(poisson_schedule(3.3, 9.1, G), 1, 10, 7);
 }
 
+
+TEST(schedule, philox) {
+    // Known answer tests from the Random123 distribution.
+    philox4x32::counter_type c0 = {{0u, 0u, 0u, 0u}};
+    philox4x32::key_type k0 = {{0u, 0u}};
+    philox4x32::counter_type r0 = {{0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u}};
+    EXPECT_EQ(r0, philox4x32::apply(c0, k0));
+
+    philox4x32::counter_type c1 = {{0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu}};
+    philox4x32::key_type k1 = {{0xffffffffu, 0xffffffffu}};
+    philox4x32::counter_type r1 = {{0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu}};
+    EXPECT_EQ(r1, philox4x32::apply(c1, k1));
+
+    philox4x32::counter_type c2 = {{0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u}};
+    philox4x32::key_type k2 = {{0xa4093822u, 0x299f31d0u}};
+    philox4x32::counter_type r2 = {{0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u}};
+    EXPECT_EQ(r2, philox4x32::apply(c2, k2));
+}
+
+TEST(schedule, counter_poisson_rate) {
+    constexpr double alpha = 0.01;
+    constexpr double lambda = 123.4;
+
+    schedule S = counter_poisson_schedule(lambda, 42);
+    int n = (int)time_range(S.events(0, 1)).size();
+    double cdf = poisson::poisson_cdf_approx(n, lambda);
+
+    EXPECT_GT(cdf, alpha/2);
+    EXPECT_LT(cdf, 1-alpha/2);
+}
+
+TEST(schedule, counter_poisson_uniformity) {
+    // Dispersion test as for poisson_uniformity, over many windows.
+    constexpr int N = 1001;
+    constexpr double chi2_lb = 888.56352318146696;
+    constexpr double chi2_ub = 1118.9480663231843;
+
+    schedule S = counter_poisson_schedule(.813, 7);
+    std::vector<int> bin(N);
+    for (auto t: time_range(S.events(0, N))) {
+        ++bin.at((int)t);
+    }
+    summary_stats stats = summarize(bin);
+    double test_value = N*stats.mean/stats.variance;
+    EXPECT_GT(test_value, chi2_lb);
+    EXPECT_LT(test_value, chi2_ub);
+
+    S = counter_poisson_schedule(100., 7);
+    auto events = as_vector(S.events(0, 1));
+    EXPECT_LT(ks::dn_cdf(ks::dn_statistic(events), (int)events.size()), 0.99);
+}
+
+TEST(schedule, counter_poisson_invariants) {
+    SCOPED_TRACE("counter_poisson_invariants");
+    run_invariant_checks(counter_poisson_schedule(0.81, 1), 5.1, 15.3, 7);
+    run_invariant_checks(counter_poisson_schedule(81., 2), 5.1, 15.3, 7);
+}
+
+TEST(schedule, counter_poisson_reset) {
+    SCOPED_TRACE("counter_poisson_reset");
+    run_reset_check(counter_poisson_schedule(.11, 3), 1, 10, 7);
+    run_reset_check(counter_poisson_schedule(110., 3), 1, 10, 7);
+}
+
+TEST(schedule, counter_poisson_seek) {
+    // Events drawn after a jump to a later time are those that would have
+    // been drawn by stepping through all earlier events; schedules with
+    // different seeds differ.
+    const double rate = 37.;
+    auto all = as_vector(counter_poisson_schedule(1.5, rate, 11).events(0, 200));
+    ASSERT_LT(1000u, all.size());
+
+    for (time_type t0: {1.f, 1.7f, 20.f, 123.456f}) {
+        std::vector<time_type> expected;
+        std::copy_if(all.begin(), all.end(), std::back_inserter(expected),
+            [t0](time_type t) { return t>=t0 && t<t0+10; });
+
+        schedule S = counter_poisson_schedule(1.5, rate, 11);
+        EXPECT_EQ(expected, as_vector(S.events(t0, t0+10)));
+    }
+
+    EXPECT_NE(all, as_vector(counter_poisson_schedule(1.5, rate, 12).events(0, 200)));
+
+    // No events with zero rate.
+    EXPECT_TRUE(as_vector(counter_poisson_schedule(0, 1).events(0, 100)).empty());
+}
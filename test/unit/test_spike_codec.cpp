@@ -0,0 +1,99 @@
+#include "../gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <arbor/common_types.hpp>
+#include <arbor/communication/gathered_vector.hpp>
+#include <arbor/spike.hpp>
+
+#include "communication/spike_codec.hpp"
+#include "util/span.hpp"
+
+using namespace arb;
+
+namespace {
+    std::vector<spike> random_spikes(unsigned n, time_type t0, time_type t1, unsigned seed) {
+        std::minstd_rand R(seed);
+        std::uniform_int_distribution<cell_gid_type> gid(0, 100000);
+        std::uniform_int_distribution<cell_lid_type> index(0, 3);
+        std::uniform_real_distribution<time_type> time(t0, t1);
+
+        std::vector<spike> spikes;
+        for (auto i: util::make_span(n)) {
+            (void)i;
+            spikes.push_back(spike({gid(R), index(R)}, time(R)));
+        }
+        return spikes;
+    }
+
+    gathered_vector<char> single(spike_codec::byte_vector bytes) {
+        unsigned n = bytes.size();
+        return gathered_vector<char>(std::move(bytes), {0u, n});
+    }
+}
+
+TEST(spike_codec, round_trip) {
+    // Unsorted, sorted, and with extreme values.
+    auto spikes = random_spikes(1000, 100.f, 100.5f, 1);
+    auto decoded = spike_codec::decode(single(spike_codec::encode(spikes)));
+    EXPECT_EQ(spikes, decoded.values());
+    EXPECT_EQ((std::vector<unsigned>{0u, 1000u}), decoded.partition());
+
+    std::sort(spikes.begin(), spikes.end(),
+        [](const spike& a, const spike& b) { return a.source<b.source; });
+    decoded = spike_codec::decode(single(spike_codec::encode(spikes)));
+    EXPECT_EQ(spikes, decoded.values());
+
+    const auto gid_max = std::numeric_limits<cell_gid_type>::max();
+    const auto lid_max = std::numeric_limits<cell_lid_type>::max();
+    std::vector<spike> extremes = {
+        spike({gid_max, lid_max}, 0.f),
+        spike({0, 0}, -0.f),
+        spike({gid_max, 0}, -1.5f),
+        spike({1, 1}, std::numeric_limits<time_type>::max()),
+        spike({0, lid_max}, std::numeric_limits<time_type>::denorm_min()),
+    };
+    decoded = spike_codec::decode(single(spike_codec::encode(extremes)));
+    ASSERT_EQ(extremes.size(), decoded.size());
+    for (auto i: util::make_span(extremes.size())) {
+        EXPECT_EQ(extremes[i].source, decoded.values()[i].source);
+        // Compare bit patterns, to distinguish 0 and -0.
+        EXPECT_EQ(std::signbit(extremes[i].time), std::signbit(decoded.values()[i].time));
+        EXPECT_EQ(extremes[i].time, decoded.values()[i].time);
+    }
+
+    EXPECT_TRUE(spike_codec::encode(std::vector<spike>{}).empty());
+}
+
+TEST(spike_codec, size) {
+    // Sorted spikes from one integration interval should take at most five
+    // bytes each on average.
+    auto spikes = random_spikes(10000, 1000.f, 1000.5f, 2);
+    std::sort(spikes.begin(), spikes.end(),
+        [](const spike& a, const spike& b) { return a.source<b.source; });
+
+    auto bytes = spike_codec::encode(spikes);
+    EXPECT_LE(bytes.size(), 5*spikes.size());
+}
+
+TEST(spike_codec, partitioned) {
+    // Batches with empty parts, as encoded for a point-to-point exchange;
+    // decoding the concatenation of the batches retains the partition.
+    auto spikes = random_spikes(100, 0.f, 10.f, 3);
+    std::vector<unsigned> partition = {0, 10, 10, 60, 60, 100};
+
+    std::vector<unsigned> byte_partition;
+    auto bytes = spike_codec::encode(spikes, partition, byte_partition);
+    ASSERT_EQ(partition.size(), byte_partition.size());
+    EXPECT_EQ(byte_partition[1], byte_partition[2]);
+    EXPECT_EQ(byte_partition[3], byte_partition[4]);
+    EXPECT_EQ(bytes.size(), byte_partition.back());
+
+    auto decoded = spike_codec::decode(gathered_vector<char>(std::move(bytes), std::move(byte_partition)));
+    EXPECT_EQ(partition, decoded.partition());
+    EXPECT_EQ(spikes, decoded.values());
+}
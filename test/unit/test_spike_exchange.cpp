@@ -0,0 +1,287 @@
+#include "../gtest.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <arbor/common_types.hpp>
+#include <arbor/distributed_context.hpp>
+#include <arbor/execution_context.hpp>
+#include <arbor/lif_cell.hpp>
+#include <arbor/load_balance.hpp>
+#include <arbor/recipe.hpp>
+#include <arbor/schedule.hpp>
+#include <arbor/simulation.hpp>
+#include <arbor/spike.hpp>
+#include <arbor/spike_source_cell.hpp>
+
+#include "communication/communicator.hpp"
+#include "event_lanes.hpp"
+#include "util/span.hpp"
+
+#include "mock_context.hpp"
+
+using namespace arb;
+
+TEST(mock_context, collectives) {
+    auto world = std::make_shared<mock_world>(4);
+    mock_world::run(world, [](distributed_context_handle ctx) {
+        const int rank = ctx->id();
+        EXPECT_EQ(4, ctx->size());
+        EXPECT_EQ(0, ctx->min(rank));
+        EXPECT_EQ(3, ctx->max(rank));
+        EXPECT_EQ(6, ctx->sum(rank));
+
+        auto g = ctx->gather(rank*2, 1);
+        if (rank==1) {
+            EXPECT_EQ((std::vector<int>{0, 2, 4, 6}), g);
+        }
+        else {
+            EXPECT_TRUE(g.empty());
+        }
+
+        // Rank r generates r spikes with source gid r.
+        std::vector<spike> local;
+        for (int i = 0; i<rank; ++i) {
+            local.push_back(spike({cell_gid_type(rank), cell_lid_type(i)}, 0.));
+        }
+        auto spikes = ctx->gather_spikes(local);
+        EXPECT_EQ((std::vector<unsigned>{0, 0, 1, 3, 6}), spikes.partition());
+        for (auto i: util::make_span(4)) {
+            for (auto j: util::make_span(spikes.partition()[i], spikes.partition()[i+1])) {
+                EXPECT_EQ(cell_gid_type(i), spikes.values()[j].source.gid);
+            }
+        }
+    });
+}
+
+TEST(mock_context, start_gather_spikes) {
+    auto world = std::make_shared<mock_world>(3);
+    mock_world::run(world, [](distributed_context_handle ctx) {
+        const cell_gid_type rank = ctx->id();
+
+        auto handle = ctx->start_gather_spikes({spike({rank, 0}, 1.)});
+        EXPECT_TRUE(handle.pending());
+
+        // Other collectives can be performed while the exchange is pending.
+        EXPECT_EQ(3, ctx->sum(1));
+
+        auto spikes = handle.complete();
+        EXPECT_FALSE(handle.pending());
+        ASSERT_EQ(3u, spikes.size());
+        for (auto i: util::make_span(3)) {
+            EXPECT_EQ(cell_gid_type(i), spikes.values()[i].source.gid);
+        }
+    });
+}
+
+TEST(mock_context, exchange_gids) {
+    auto world = std::make_shared<mock_world>(3);
+    mock_world::run(world, [](distributed_context_handle ctx) {
+        const cell_gid_type rank = ctx->id();
+
+        // Send (10*rank + dest) to each destination rank dest, dest+1 times.
+        std::vector<cell_gid_type> gids;
+        std::vector<unsigned> partition = {0};
+        for (cell_gid_type dest: {0u, 1u, 2u}) {
+            for (unsigned i = 0; i<=dest; ++i) {
+                gids.push_back(10*rank+dest);
+            }
+            partition.push_back(gids.size());
+        }
+
+        auto received = ctx->exchange_gids(gids, partition);
+        const unsigned n = rank+1;
+        EXPECT_EQ((std::vector<unsigned>{0, n, 2*n, 3*n}), received.partition());
+        for (auto src: util::make_span(3)) {
+            for (auto j: util::make_span(received.partition()[src], received.partition()[src+1])) {
+                EXPECT_EQ(10*src+rank, received.values()[j]);
+            }
+        }
+    });
+}
+
+namespace {
+    // Spike sources, each with connections from randomly chosen cells
+    // within a window of nearby gids, so that each domain requires spikes
+    // only from a few others.
+    class local_recipe: public recipe {
+    public:
+        local_recipe(cell_size_type size, cell_size_type window, cell_size_type fan_in):
+            size_(size), window_(window), fan_in_(fan_in)
+        {}
+
+        cell_size_type num_cells() const override { return size_; }
+
+        util::unique_any get_cell_description(cell_gid_type) const override { return {}; }
+
+        cell_kind get_cell_kind(cell_gid_type) const override { return cell_kind::spike_source; }
+
+        cell_size_type num_sources(cell_gid_type) const override { return 1; }
+        cell_size_type num_targets(cell_gid_type) const override { return fan_in_; }
+        cell_size_type num_probes(cell_gid_type) const override { return 0; }
+
+        std::vector<cell_connection> connections_on(cell_gid_type gid) const override {
+            std::minstd_rand R(gid);
+            std::uniform_int_distribution<cell_gid_type> offset(0, window_-1);
+
+            std::vector<cell_connection> cons;
+            for (auto i: util::make_span(fan_in_)) {
+                cell_gid_type src = (gid+offset(R))%size_;
+                cons.push_back(cell_connection({src, 0}, {gid, i}, float(i), 1.0f));
+            }
+            return cons;
+        }
+
+    private:
+        cell_size_type size_;
+        cell_size_type window_;
+        cell_size_type fan_in_;
+    };
+}
+
+// Events generated after sparse exchange should be the same as those
+// generated after the global spike gather, and in the same order.
+TEST(communicator, sparse_exchange) {
+    const int n_ranks = 5;
+    auto world = std::make_shared<mock_world>(n_ranks);
+
+    mock_world::run(world, [](distributed_context_handle dist) {
+        execution_context ctx;
+        ctx.distributed = dist;
+        ctx.thread_pool = make_thread_pool(1);
+
+        auto R = local_recipe(500, 40, 10);
+        const auto D = partition_load_balance(R, local_allocation(ctx), ctx);
+
+        communicator all(R, D, ctx);
+        dist->set_spike_exchange(spike_exchange_mode::sparse);
+        communicator sparse(R, D, ctx);
+
+        EXPECT_TRUE(all.exchanges_all_spikes());
+        EXPECT_FALSE(sparse.exchanges_all_spikes());
+
+        // Every third cell spikes, twice.
+        std::vector<spike> local_spikes;
+        for (const auto& g: D.groups) {
+            for (auto gid: g.gids) {
+                if (gid%3==0) {
+                    local_spikes.push_back(spike({gid, 0}, 1.0+gid%5));
+                    local_spikes.push_back(spike({gid, 0}, 2.0+gid%7));
+                }
+            }
+        }
+
+        auto all_spikes = all.exchange(local_spikes);
+        auto sparse_spikes = sparse.exchange(local_spikes);
+
+        EXPECT_LT(sparse_spikes.size(), all_spikes.size());
+
+        // The sparse mode counts the global spikes only when reduced.
+        EXPECT_EQ(0u, sparse.num_spikes());
+        sparse.reduce_num_spikes();
+        EXPECT_EQ(all.num_spikes(), sparse.num_spikes());
+        EXPECT_EQ(all_spikes.size(), sparse.gather_spikes(local_spikes).size());
+
+        event_lane_store all_queues(all.num_local_cells());
+        event_lane_store sparse_queues(sparse.num_local_cells());
+        all.make_event_queues(all_spikes, all_queues);
+        sparse.make_event_queues(sparse_spikes, sparse_queues);
+
+        ASSERT_EQ(all_queues.num_events(), sparse_queues.num_events());
+        for (auto i: util::make_span(all_queues.size())) {
+            auto a = all_queues[i];
+            auto b = sparse_queues[i];
+            EXPECT_TRUE(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+        }
+
+        // An exchange that is started and later completed gives the same
+        // result as the blocking exchange.
+        sparse.start_exchange(local_spikes);
+        EXPECT_EQ(dist->size(), dist->sum(1));
+        auto deferred_spikes = sparse.complete_exchange();
+        EXPECT_EQ(sparse_spikes.partition(), deferred_spikes.partition());
+        sparse.reduce_num_spikes();
+        EXPECT_EQ(2*all.num_spikes(), sparse.num_spikes());
+    });
+}
+
+namespace {
+    // A spike source (gid 0) that spikes once at t=0, driving a ring of
+    // LIF cells with gids 1..n.
+    class lif_ring_recipe: public recipe {
+    public:
+        explicit lif_ring_recipe(cell_size_type n): n_(n) {}
+
+        cell_size_type num_cells() const override { return n_+1; }
+
+        cell_kind get_cell_kind(cell_gid_type gid) const override {
+            return gid? cell_kind::lif_neuron: cell_kind::spike_source;
+        }
+
+        util::unique_any get_cell_description(cell_gid_type gid) const override {
+            if (!gid) {
+                return spike_source_cell{explicit_schedule({0.f})};
+            }
+            return lif_cell();
+        }
+
+        std::vector<cell_connection> connections_on(cell_gid_type gid) const override {
+            if (!gid) return {};
+            return {cell_connection({gid-1, 0}, {gid, 0}, 1000.f, 1.f)};
+        }
+
+        cell_size_type num_sources(cell_gid_type) const override { return 1; }
+        cell_size_type num_targets(cell_gid_type) const override { return 1; }
+        cell_size_type num_probes(cell_gid_type) const override { return 0; }
+
+    private:
+        cell_size_type n_;
+    };
+}
+
+// The simulation overlaps the spike exchange with the cell update; the
+// spikes propagate around the ring with either exchange mode.
+TEST(simulation, mock_ranks) {
+    const cell_size_type n_cells = 40;
+
+    for (auto mode: {spike_exchange_mode::allgather, spike_exchange_mode::sparse}) {
+        auto world = std::make_shared<mock_world>(3);
+        std::vector<std::vector<spike>> exported(world->size());
+
+        mock_world::run(world, [&](distributed_context_handle dist) {
+            dist->set_spike_exchange(mode);
+
+            execution_context ctx;
+            ctx.distributed = dist;
+            ctx.thread_pool = make_thread_pool(1);
+
+            auto R = lif_ring_recipe(n_cells);
+            auto D = partition_load_balance(R, local_allocation(ctx), ctx);
+            simulation sim(R, D, ctx);
+
+            auto& out = exported[dist->id()];
+            if (dist->id()==1) {
+                sim.set_global_spike_callback(
+                    [&out](const std::vector<spike>& spikes) {
+                        out.insert(out.end(), spikes.begin(), spikes.end());
+                    });
+            }
+
+            sim.run(n_cells+0.5, 0.01);
+            EXPECT_EQ(n_cells+1, sim.num_spikes());
+        });
+
+        EXPECT_TRUE(exported[0].empty());
+        EXPECT_TRUE(exported[2].empty());
+
+        auto& spikes = exported[1];
+        ASSERT_EQ(n_cells+1, spikes.size());
+        std::sort(spikes.begin(), spikes.end(),
+            [](const spike& a, const spike& b) { return a.source<b.source; });
+        for (auto& s: spikes) {
+            EXPECT_EQ(time_type(s.source.gid), s.time);
+        }
+    }
+}
@@ -1,91 +1,78 @@
 #include "../gtest.h"
 
+#include <algorithm>
+#include <random>
+#include <vector>
+
 #include <arbor/spike.hpp>
 #include <arbor/execution_context.hpp>
 
-#include "thread_private_spike_store.hpp"
+#include "group_spike_store.hpp"
+#include "threading/threading.hpp"
 
 using arb::spike;
 
-TEST(spike_store, insert)
+TEST(spike_store, group_sinks)
 {
-    using store_type = arb::thread_private_spike_store;
-
-    arb::execution_context context;
-    store_type store(context.thread_pool);
-
-    // insert 3 spike events and check that they were inserted correctly
-    store.insert({
-        {{0,0}, 0.0f},
-        {{1,2}, 0.5f},
-        {{2,4}, 1.0f}
-    });
-
-    {
-        EXPECT_EQ(store.get().size(), 3u);
-        auto i = 0u;
-        for (auto& spike : store.get()) {
-            EXPECT_EQ(spike.source.gid,   i);
-            EXPECT_EQ(spike.source.index, 2*i);
-            EXPECT_EQ(spike.time, float(i)/2.f);
-            ++i;
-        }
-    }
+    auto pool = arb::make_thread_pool(4);
+    arb::group_spike_store store(3, pool);
 
-    // insert another 3 events, then check that they were appended to the
-    // original three events correctly
-    store.insert({
-        {{3,6},  1.5f},
-        {{4,8},  2.0f},
-        {{5,10}, 2.5f}
-    });
-
-    {
-        EXPECT_EQ(store.get().size(), 6u);
-        auto i = 0u;
-        for (auto& spike : store.get()) {
-            EXPECT_EQ(spike.source.gid,   i);
-            EXPECT_EQ(spike.source.index, 2*i);
-            EXPECT_EQ(spike.time, float(i)/2.f);
-            ++i;
-        }
+    store.sink(0) = {{{4,0}, 1.0f}, {{2,0}, 3.0f}, {{2,0}, 2.0f}};
+    store.sink(2) = {{{3,1}, 0.5f}, {{0,0}, 0.5f}};
+    for (auto i: {0, 1, 2}) {
+        store.sort(i);
     }
-}
 
-TEST(spike_store, clear)
-{
-    using store_type = arb::thread_private_spike_store;
+    std::vector<spike> expected =
+        {{{0,0}, 0.5f}, {{2,0}, 2.0f}, {{2,0}, 3.0f}, {{3,1}, 0.5f}, {{4,0}, 1.0f}};
+    EXPECT_EQ(expected, store.gather());
 
-    arb::execution_context context;
-    store_type store(context.thread_pool);
+    arb::spike_volume_stats stats;
+    store.record(stats);
+    EXPECT_EQ(1u, stats.num_intervals);
+    EXPECT_EQ(5u, stats.num_spikes);
+    EXPECT_EQ(5u, stats.max_interval_spikes);
+    EXPECT_EQ(3u, stats.max_group_interval_spikes);
 
-    // insert 3 spike events
-    store.insert({
-        {{0,0}, 0.0f}, {{1,2}, 0.5f}, {{2,4}, 1.0f}
-    });
-    EXPECT_EQ(store.get().size(), 3u);
+    // Sinks keep their capacity when cleared.
+    auto capacity = store.sink(0).capacity();
     store.clear();
-    EXPECT_EQ(store.get().size(), 0u);
+    EXPECT_TRUE(store.gather().empty());
+    EXPECT_EQ(capacity, store.sink(0).capacity());
+
+    store.sink(1) = {{{7,0}, 1.0f}};
+    store.record(stats);
+    EXPECT_EQ(2u, stats.num_intervals);
+    EXPECT_EQ(6u, stats.num_spikes);
+    EXPECT_EQ(5u, stats.max_interval_spikes);
 }
 
-TEST(spike_store, gather)
+TEST(spike_store, group_gather_sorted)
 {
-    using store_type = arb::thread_private_spike_store;
-
-    arb::execution_context context;
-    store_type store(context.thread_pool);
-
-    std::vector<spike> spikes =
-        { {{0,0}, 0.0f}, {{1,2}, 0.5f}, {{2,4}, 1.0f} };
+    // Enough spikes for the sinks to be merged in parallel parts.
+    auto pool = arb::make_thread_pool(4);
+
+    const int ngroup = 200;
+    arb::group_spike_store store(ngroup, pool);
+
+    std::vector<spike> expected;
+    for (int i = 0; i<ngroup; ++i) {
+        std::minstd_rand R(i);
+        std::uniform_int_distribution<arb::cell_gid_type> gid(0, 5000);
+        std::uniform_int_distribution<int> time(0, 10);
+        for (int j = 0; j<500; ++j) {
+            store.sink(i).push_back({{gid(R), 0}, 0.25f*time(R)});
+        }
+        expected.insert(expected.end(), store.sink(i).begin(), store.sink(i).end());
+    }
 
-    store.insert(spikes);
-    auto gathered_spikes = store.gather();
+    arb::threading::parallel_for::apply(0, ngroup, 1, pool.get(),
+        [&](int i) { store.sort(i); });
 
-    EXPECT_EQ(gathered_spikes.size(), spikes.size());
+    std::sort(expected.begin(), expected.end(),
+        [](const spike& l, const spike& r) {
+            return l.source<r.source || (l.source==r.source && l.time<r.time);
+        });
 
-    for(auto i=0u; i<spikes.size(); ++i) {
-        EXPECT_EQ(spikes[i].source.gid, gathered_spikes[i].source.gid);
-        EXPECT_EQ(spikes[i].source.index, gathered_spikes[i].source.index);
-        EXPECT_EQ(spikes[i].time, gathered_spikes[i].time);
-    }
+    EXPECT_EQ(expected, store.gather());
 }
@@ -1,10 +1,16 @@
 #include "../gtest.h"
 
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <arbor/math.hpp>
 #include <arbor/spike.hpp>
 
 #include <backends/multicore/fvm.hpp>
 #include <memory/memory.hpp>
 #include <util/rangeutil.hpp>
+#include <util/span.hpp>
 
 using namespace arb;
 
@@ -155,3 +161,98 @@ TEST(SPIKES_TEST_CLASS, threshold_watcher) {
     EXPECT_FALSE(watch.is_crossed(2));
 }
 
+
+TEST(SPIKES_TEST_CLASS, threshold_watcher_many) {
+    using value_type = backend::value_type;
+    using index_type = backend::index_type;
+    using array = backend::array;
+    using iarray = backend::iarray;
+
+    // Watch 13 of 20 values, some more than once, on two cells, and compare
+    // the crossings over a sequence of random values against a scalar
+    // implementation of the detector state machine.
+    execution_context context;
+    const unsigned n = 20;
+    const unsigned n_watch = 13;
+
+    std::vector<index_type> index;
+    std::vector<value_type> thresh;
+    for (unsigned k = 0; k<n_watch; ++k) {
+        index.push_back((7*k)%n);
+        thresh.push_back(0.1*k-0.6);
+    }
+
+    iarray cell_index(n, 0);
+    for (unsigned i = n/2; i<n; ++i) {
+        cell_index[i] = 1;
+    }
+
+    std::minstd_rand gen;
+    std::uniform_real_distribution<value_type> dist(-1., 1.);
+
+    std::vector<value_type> v(n);
+    for (auto& x: v) x = dist(gen);
+
+    array values(n, 0);
+    for (unsigned i = 0; i<n; ++i) {
+        values[i] = v[i];
+    }
+    array time_before(2, 0.);
+    array time_after(2, 0.);
+
+    backend::threshold_watcher watch(cell_index.data(), time_before.data(), time_after.data(), values.data(), index, thresh, context);
+
+    std::vector<value_type> v_prev;
+    std::vector<bool> crossed;
+    for (unsigned k = 0; k<n_watch; ++k) {
+        v_prev.push_back(v[index[k]]);
+        crossed.push_back(v[index[k]]>=thresh[k]);
+        EXPECT_EQ(crossed[k], watch.is_crossed(k));
+    }
+
+    std::vector<threshold_crossing> expected;
+    value_type t_before[2] = {0., 0.};
+    for (unsigned step = 1; step<=50; ++step) {
+        value_type t_after[2] = {0.1*step, 0.1*step+0.05};
+        time_after[0] = t_after[0];
+        time_after[1] = t_after[1];
+
+        for (unsigned i = 0; i<n; ++i) {
+            v[i] = dist(gen);
+            values[i] = v[i];
+        }
+        watch.test();
+
+        for (unsigned k = 0; k<n_watch; ++k) {
+            auto x = v[index[k]];
+            if (!crossed[k] && x>=thresh[k]) {
+                auto pos = (thresh[k]-v_prev[k])/(x-v_prev[k]);
+                auto cell = index[k]<(index_type)n/2? 0: 1;
+                expected.push_back({k, math::lerp(t_before[cell], t_after[cell], pos)});
+            }
+            crossed[k] = x>=thresh[k];
+            v_prev[k] = x;
+            EXPECT_EQ(crossed[k], watch.is_crossed(k));
+        }
+
+        t_before[0] = t_after[0];
+        t_before[1] = t_after[1];
+        time_before[0] = t_after[0];
+        time_before[1] = t_after[1];
+    }
+
+    auto by_index_time = [](const threshold_crossing& a, const threshold_crossing& b) {
+        return a.index<b.index || (a.index==b.index && a.time<b.time);
+    };
+
+    std::vector<threshold_crossing> crossings(watch.crossings().begin(), watch.crossings().end());
+    std::sort(expected.begin(), expected.end(), by_index_time);
+    std::sort(crossings.begin(), crossings.end(), by_index_time);
+
+    ASSERT_EQ(expected.size(), crossings.size());
+    ASSERT_LT(20u, crossings.size());
+    for (auto i: util::count_along(expected)) {
+        EXPECT_EQ(expected[i].index, crossings[i].index);
+        EXPECT_DOUBLE_EQ(expected[i].time, crossings[i].time);
+    }
+}
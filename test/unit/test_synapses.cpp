@@ -160,7 +160,8 @@ TEST(synapses, syn_basic_state) {
     EXPECT_TRUE(factor>1.);
     fvec expected = {2.71f*factor, 0, 0.07f*factor, 0};
 
-    EXPECT_TRUE(testing::seq_almost_eq<fvm_value_type>(expected, mechanism_field(exp2syn, "A")));
-    EXPECT_TRUE(testing::seq_almost_eq<fvm_value_type>(expected, mechanism_field(exp2syn, "B")));
+    // Compare with the precision in which the state is stored.
+    EXPECT_TRUE(testing::seq_almost_eq<fvm_state_type>(expected, mechanism_field(exp2syn, "A")));
+    EXPECT_TRUE(testing::seq_almost_eq<fvm_state_type>(expected, mechanism_field(exp2syn, "B")));
 }
 
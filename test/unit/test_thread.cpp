@@ -2,8 +2,17 @@
 #include "common.hpp"
 #include <arbor/execution_context.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <numeric>
 #include <ostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
 // (Pending abstraction of threading interface)
 #include <arbor/version.hpp>
 
@@ -86,28 +95,69 @@ TEST(task_system, test_move) {
     reset();
 }
 
-TEST(notification_queue, test_copy) {
-    notification_queue q;
+TEST(work_stealing_deque, push_pop_steal) {
+    // Owner pops LIFO, thieves steal FIFO.
+    work_stealing_deque<int> d(4);
+    std::vector<int> v(10);
+    std::iota(v.begin(), v.end(), 0);
 
-    ftor f;
-    q.push(f);
+    EXPECT_TRUE(d.empty());
+    EXPECT_EQ(nullptr, d.pop());
+    EXPECT_EQ(nullptr, d.steal());
 
-    // Copy into new ftor and move ftor into a task (std::function<void()>)
-    EXPECT_EQ(1, nmove);
-    EXPECT_EQ(1, ncopy);
-    reset();
+    // Push more than the initial capacity to force growth.
+    for (auto& x: v) d.push(&x);
+    EXPECT_FALSE(d.empty());
+
+    EXPECT_EQ(&v[0], d.steal());
+    EXPECT_EQ(&v[1], d.steal());
+    EXPECT_EQ(&v[9], d.pop());
+    EXPECT_EQ(&v[8], d.pop());
+
+    for (int i = 2; i < 8; ++i) {
+        EXPECT_EQ(&v[i], d.steal());
+    }
+    EXPECT_TRUE(d.empty());
+    EXPECT_EQ(nullptr, d.pop());
 }
 
-TEST(notification_queue, test_move) {
-    notification_queue q;
+TEST(work_stealing_deque, concurrent_steal) {
+    // Every pushed element must be taken exactly once, by either the
+    // owner or one of the thieves.
+    const int n = 100000;
+    const int nthieves = 3;
+
+    work_stealing_deque<int> d(16);
+    std::vector<int> v(n, 0);
+    std::vector<std::atomic<int>> taken(n);
+    for (auto& t: taken) t = 0;
+
+    std::atomic<bool> done{false};
+    auto take = [&](int* x) { ++taken[x-v.data()]; };
+
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < nthieves; ++t) {
+        thieves.emplace_back([&] {
+            while (!done) {
+                if (auto x = d.steal()) take(x);
+            }
+        });
+    }
 
-    ftor f;
+    for (int i = 0; i < n; ++i) {
+        d.push(&v[i]);
+        if (i%3==0) {
+            if (auto x = d.pop()) take(x);
+        }
+    }
+    while (auto x = d.pop()) take(x);
 
-    // Move into new ftor and move ftor into a task (std::function<void()>)
-    q.push(std::move(f));
-    EXPECT_LE(nmove, 2);
-    EXPECT_LE(ncopy, 1);
-    reset();
+    done = true;
+    for (auto& t: thieves) t.join();
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(1, taken[i]) << "element " << i;
+    }
 }
 
 TEST(task_group, test_copy) {
@@ -118,7 +168,7 @@ TEST(task_group, test_copy) {
     g.run(f);
     g.wait();
 
-    // Copy into "wrap" and move wrap into a task (std::function<void()>)
+    // Copy into "wrap" and move wrap into a task node
     EXPECT_EQ(1, nmove);
     EXPECT_EQ(1, ncopy);
     reset();
@@ -132,7 +182,7 @@ TEST(task_group, test_move) {
     g.run(std::move(f));
     g.wait();
 
-    // Move into wrap and move wrap into a task (std::function<void()>)
+    // Move into wrap and move wrap into a task node
     EXPECT_LE(nmove, 2);
     EXPECT_LE(ncopy, 1);
     reset();
@@ -194,6 +244,106 @@ TEST(task_group, nested_parallel_for) {
     }
 }
 
+TEST(task_group, reuse) {
+    // Task storage is recycled between waits; tasks larger than an arena
+    // block are also supported.
+    task_system ts;
+    task_group g(&ts);
+
+    std::atomic<int> count{0};
+    std::array<char, 10000> big;
+    big.fill(1);
+
+    for (int round = 0; round < 4; ++round) {
+        count = 0;
+        for (int i = 0; i < 1000; ++i) {
+            g.run([&count] { ++count; });
+        }
+        g.run([&count, big] { count += big[0]; });
+        g.wait();
+        EXPECT_EQ(1001, count);
+    }
+}
+
+TEST(task_group, foreign_thread) {
+    // Tasks submitted from a thread outside the task system.
+    task_system ts;
+    std::vector<int> v(1000, -1);
+
+    std::thread t([&] {
+        parallel_for::apply(0, v.size(), &ts, [&](int i) {v[i] = i;});
+    });
+    t.join();
+
+    for (int i = 0; i < (int)v.size(); i++) {
+        EXPECT_EQ(i, v[i]);
+    }
+}
+
+TEST(task_group, parallel_for_grain) {
+    task_system ts;
+    for (int grain: {1, 3, 64, 1000}) {
+        for (int n = 0; n < 10000; n=!n?1:3*n) {
+            std::vector<std::atomic<int>> count(n);
+            for (auto& c: count) c = 0;
+
+            std::atomic<bool> oversize{false};
+            parallel_for::apply_range(0, n, grain, &ts, [&](int first, int last) {
+                if (last-first>grain) oversize = true;
+                for (int i = first; i < last; ++i) ++count[i];
+            });
+
+            EXPECT_FALSE(oversize);
+            for (int i = 0; i < n; i++) {
+                EXPECT_EQ(1, count[i]) << "grain " << grain << " index " << i;
+            }
+        }
+    }
+}
+
+TEST(task_group, parallel_reduce) {
+    task_system ts;
+    for (int n = 0; n < 100000; n=!n?1:7*n) {
+        long expected = long(n)*(n-1)/2;
+        auto sum = parallel_reduce::apply(0, n, &ts, 0l,
+            [](int i) { return long(i); },
+            [](long a, long b) { return a+b; });
+        EXPECT_EQ(expected, sum);
+
+        sum = parallel_reduce::apply(0, n, 5, &ts, 0l,
+            [](int i) { return long(i); },
+            [](long a, long b) { return a+b; });
+        EXPECT_EQ(expected, sum);
+    }
+
+    // Non-commutative op: the order of the partial results is preserved.
+    std::string s = parallel_reduce::apply(0, 26, 2, &ts, std::string(),
+        [](int i) { return std::string(1, char('a'+i)); },
+        [](const std::string& a, const std::string& b) { return a+b; });
+    EXPECT_EQ("abcdefghijklmnopqrstuvwxyz", s);
+}
+
+TEST(task_group, parallel_sort) {
+    task_system ts;
+    std::mt19937 gen;
+    std::uniform_int_distribution<int> dist(0, 1000);
+
+    for (int n: {0, 1, 10, 5000, 100000}) {
+        std::vector<int> v(n);
+        for (auto& x: v) x = dist(gen);
+
+        auto expected = v;
+        std::sort(expected.begin(), expected.end());
+
+        parallel_sort::apply(v, &ts);
+        EXPECT_EQ(expected, v);
+
+        parallel_sort::apply(v.begin(), v.end(), &ts, std::greater<int>());
+        std::reverse(expected.begin(), expected.end());
+        EXPECT_EQ(expected, v);
+    }
+}
+
 TEST(enumerable_thread_specific, test) {
     task_system_handle ts = task_system_handle(new task_system);
     enumerable_thread_specific<int> buffers(ts);
@@ -5,6 +5,7 @@
 
 #include <nlohmann/json.hpp>
 
+#include <arbor/fvm_types.hpp>
 #include <arbor/sampling.hpp>
 #include <arbor/simple_sampler.hpp>
 #include <arbor/simulation.hpp>
@@ -14,6 +15,7 @@
 #include "../gtest.h"
 
 #include "trace_analysis.hpp"
+#include "util.hpp"
 #include "validation_data.hpp"
 
 namespace arb {
@@ -52,6 +54,13 @@ public:
         run_validation_(false),
         meta_(meta)
     {
+        // Record the precision of the mechanism state, which is single
+        // precision on the multicore back end when built with ARB_FLOAT_STATE,
+        // so that its effect on the convergence can be compared across builds.
+        bool single = sizeof(fvm_state_type)<sizeof(fvm_value_type) &&
+            meta_.count("backend_kind") && meta_["backend_kind"]==::to_string(backend_kind::multicore);
+        meta_["state_precision"] = single? "single": "double";
+
         using std::begin;
         using std::end;
 